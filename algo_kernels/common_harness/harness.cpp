@@ -11,6 +11,7 @@
 #include "graph_io_util.h"
 #include "graph.h"
 #include "graph_common.h"
+#include "query_server.h"
 
 // Kernel harness header.
 #include "kernel_harness.h"
@@ -18,13 +19,17 @@
 #include "TaskqHandler.h"
 #include "TaskUtil.h"
 
+/**
+ * Load the vertex data of the local vertices, return their ids.
+ */
 template<typename GraphTileType>
-void loadVertexData(Ptr<GraphTileType> graph, const string& vertexDataFileName) {
+std::vector<uint64_t> loadVertexData(Ptr<GraphTileType> graph, const string& vertexDataFileName) {
     std::ifstream infile(vertexDataFileName, std::ifstream::in);
     if (!infile.is_open()) {
         throw FileException(vertexDataFileName);
     }
     string line;
+    std::vector<uint64_t> vids;
     // int cnt = 0;
     while (GraphGASLite::GraphIOUtil::nextEffectiveLine(infile, line)) {
         // printf("line %d\n", cnt);
@@ -39,12 +44,14 @@ void loadVertexData(Ptr<GraphTileType> graph, const string& vertexDataFileName)
             // Local destination.
             auto v = graph->vertex(vid);
             readVertexDataLine(iss, v->data());
+            vids.push_back(vid);
         }
         // } else {
         //     printf("%lld\n", vid);
         //     throw FileException(vertexDataFileName);
         // }
     }
+    return vids;
 }
 
 int main(int argc, char* argv[]) {
@@ -66,12 +73,13 @@ int main(int argc, char* argv[]) {
     std::string outputFile;
     std::string setting;
     std::string GNNConfigFile;
+    std::string edgeDeltaFile;
 
     AppArgs appArgs;
 
     int argRet = algoKernelArgs(argc, argv,
             threadCount, graphTileCount, tileIndex, maxIters, numParts, setting, noPreprocess, isCluster, isNoDummyEdge, undirected,
-            edgelistFile, vertexlistFile, partitionFile, outputFile, GNNConfigFile, appArgs);
+            edgeDeltaFile, edgelistFile, vertexlistFile, partitionFile, outputFile, GNNConfigFile, appArgs);
 
     if (argRet) {
         algoKernelArgsPrintHelp(appName, appArgs);
@@ -114,8 +122,31 @@ int main(int argc, char* argv[]) {
     kernel->numPartsIs(numParts);
     kernel->tidMapIs(tidMap);
     kernel->curTidIs(tileIndex);
+    kernel->edgeDeltaFileIs(edgeDeltaFile, undirected);
     engine.algoKernelNew(kernel);
 
+    // Serving answers queries from the predictions of the scoring pass.
+    const bool isServing = !gnnParam.serve_socket.empty();
+    // Incremental inference reuses the activations of the last forward pass.
+    const bool isIncremental = !gnnParam.feature_delta_file.empty();
+    Ptr<Kernel::Session> session;
+    if (gnnParam.score_after_train || isServing || isIncremental) {
+        session = Ptr<Kernel::Session>(new Kernel::Session());
+        kernel->sessionIs(session);
+    }
+    if (gnnParam.score_after_train || isServing || (isIncremental && maxIters != gnnParam.num_layers)) {
+        // Score with the trained weights right after training, in the same session,
+        // with a forward pass only.
+        auto scoreKernel = appArgs.algoKernel<Kernel>(appName);
+        scoreKernel->verboseIs(true);
+        scoreKernel->maxItersIs(gnnParam.num_layers);
+        scoreKernel->numPartsIs(numParts);
+        scoreKernel->tidMapIs(tidMap);
+        scoreKernel->curTidIs(tileIndex);
+        scoreKernel->sessionIs(session);
+        engine.algoKernelNew(scoreKernel);
+    }
+
     CryptoUtil& cryptoUtil = CryptoUtil::getInstance();
     cryptoUtil.tileIndexIs(tileIndex);
     cryptoUtil.setUpPaillierCipher();
@@ -177,8 +208,36 @@ int main(int argc, char* argv[]) {
 
     /* Run. */
 
+    // The incremental run keeps the channels of the first one.
+    if (isIncremental) engine.sessionOpen();
     engine();
 
+    if (isIncremental) {
+        // Load the new features of the changed vertices only after the first run
+        // shared the old ones, then recompute their frontier.
+        auto deltaKernel = appArgs.algoKernel<Kernel>(appName);
+        deltaKernel->verboseIs(true);
+        deltaKernel->maxItersIs(gnnParam.num_layers);
+        deltaKernel->numPartsIs(numParts);
+        deltaKernel->tidMapIs(tidMap);
+        deltaKernel->curTidIs(tileIndex);
+        deltaKernel->sessionIs(session);
+        deltaKernel->changedVerticesIs(loadVertexData<Graph>(engine.graphTile(tileIndex), gnnParam.feature_delta_file));
+        while (engine.algoKernelCount() != 0) engine.algoKernelDel(engine.algoKernelIter());
+        engine.algoKernelNew(deltaKernel);
+        engine();
+        engine.sessionClose();
+    }
+
+    if (isServing) {
+        // One endpoint per party, they may share the host. All kernels of the
+        // session serve the same predictions.
+        GraphGASLite::QueryServer server(gnnParam.serve_socket + "." + std::to_string(tileIndex));
+        std::cout << "Serve queries on " << gnnParam.serve_socket << "." << tileIndex << "." << std::endl;
+        kernel->serveQueries(server, gnnParam.serve_window_ms);
+        server.statsPrint();
+    }
+
     /* Output. */
 #ifdef VDATA
     if (!outputFile.empty()) {
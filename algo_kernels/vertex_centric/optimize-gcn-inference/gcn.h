@@ -49,6 +49,9 @@
 struct GCNData {
     // # Feature
     std::vector<double> feature;
+    // # Sparse feature (nonzero columns and values), used instead of feature with sparse_feature
+    std::vector<uint32_t> featureIdx;
+    std::vector<double> featureVal;
     int label;
 
     // GraphGASLite::IterCount activeIter;
@@ -61,21 +64,59 @@ struct GCNData {
 
     GCNData(const GraphGASLite::VertexIdx&) {}
 
+    // Split into two shares written in place. The plaintext features are released
+    // once split, so only the shares stay resident.
     void intoShareVec(ShareVec& sv0, ShareVec& sv1) {
-        std::vector<uint64_t> feature_share0, feature_share1;
+        GNNParam& gnnParam = GNNParam::getGNNParam();
+        if (gnnParam.sparse_feature) {
+            // Zero entries still need random shares, but are never materialized as doubles.
+            size_t feature_length = gnnParam.input_dim;
+            sv0.resize(feature_length);
+            sv1.resize(feature_length);
+            size_t k = 0;
+            for (uint32_t i=0; i<feature_length; ++i) {
+                double x = (k < featureIdx.size() && featureIdx[k] == i)? featureVal[k++] : 0.0;
+                CryptoUtil::intoShares(x, sv0[i], sv1[i]);
+            }
+            featureDel();
+            return;
+        }
+
         size_t feature_length = feature.size();
-        feature_share0.resize(feature_length);
-        feature_share1.resize(feature_length);
+        sv0.resize(feature_length);
+        sv1.resize(feature_length);
         for (int i=0; i<feature_length; ++i) {
-            CryptoUtil::intoShares(feature[i], feature_share0[i], feature_share1[i]);
+            CryptoUtil::intoShares(feature[i], sv0[i], sv1[i]);
         }
+        featureDel();
+    }
 
-        sv0.swap(feature_share0);
-        sv1.swap(feature_share1);
+    void featureDel() {
+        std::vector<double>().swap(feature);
+        std::vector<uint32_t>().swap(featureIdx);
+        std::vector<double>().swap(featureVal);
     }
 
-    void fromShareVec(const ShareVec& sv0, const ShareVec& sv1) {
+    void intoPlainShareVec(ShareVec& sv) const {
+        GNNParam& gnnParam = GNNParam::getGNNParam();
+        if (gnnParam.sparse_feature) {
+            sv.assign(gnnParam.input_dim, 0);
+            for (size_t k=0; k<featureIdx.size(); ++k) {
+                sv[featureIdx[k]] = CryptoUtil::encodeDoubleAsFixedPoint(featureVal[k]);
+            }
+            return;
+        }
+
         size_t feature_length = feature.size();
+        sv.resize(feature_length);
+        for (int i=0; i<feature_length; ++i) {
+            sv[i] = CryptoUtil::encodeDoubleAsFixedPoint(feature[i]);
+        }
+    }
+
+    void fromShareVec(const ShareVec& sv0, const ShareVec& sv1) {
+        size_t feature_length = sv0.size();
+        feature.resize(feature_length);
         for (int i=0; i<feature_length; ++i) {
             feature[i] = CryptoUtil::mergeShareAsDouble(sv0[i], sv1[i]);
         }
@@ -167,7 +208,8 @@ protected:
     typedef typename GraphTileType::VertexType VertexType;
     typedef typename GraphTileType::EdgeType::WeightType EdgeWeightType;
     typedef typename GraphGASLite::SSEdgeCentricAlgoKernel<GraphTileType>::GraphSummary GraphSummary; 
-    typedef typename GraphGASLite::SSEdgeCentricAlgoKernel<GraphTileType>::TensorVecMap TensorVecMap; 
+    typedef GraphGASLite::ActivationStore ActivationStore;
+    typedef GraphGASLite::ActivationKind ActivationKind;
 
     std::pair<UpdateType, bool> scatter(const GraphGASLite::IterCount& iter, Ptr<VertexType>& src, EdgeWeightType& weight) const {
         return std::make_pair(GCNUpdate(), false);
@@ -215,38 +257,63 @@ protected:
         bool isClient = (party == sci::ALICE);
 
         size_t length = vertexSvv.size();
-        std::vector<uint64_t> normalizer(length);
-        for (int i = 0; i < length; ++i) {
-            normalizer[i] = vertexOutDeg[i] == 0 ? 0 : CryptoUtil::encodeDoubleAsFixedPoint(pow((double)vertexOutDeg[i] + 1, -0.5));
-        }
 
         if (isForward) { // FORWARD
             const ShareTensor& weight = isClient? gs.localWeight[coForwardLayer]:gs.remoteWeight[coForwardLayer];
-            TensorVecMap& vertexInterData = isClient? gs.localVertexInterDataTVs[coForwardLayer]:gs.remoteVertexInterDataTVs[coForwardLayer];
+            ActivationStore& acts = isClient? gs.localActivations : gs.remoteActivations;
 
             TaskComm& clientTaskComm = TaskComm::getClientInstance();
             size_t tileNum = clientTaskComm.getTileNum();
             size_t tileIndex = clientTaskComm.getTileIndex();
-            if (isClient && coTid == (tileIndex + 1) % tileNum) vertexInterData["h_t"] = {transpose(vertexSvv)};
-            if ((!isClient) && (coTid + 1) % tileNum == tileIndex) vertexInterData["h_t"] = {transpose(vertexSvv)};
+            if (gs.isFrontierOnly) {
+                // Only the frontier rows of the layer input are computed, the other rows
+                // of the scaled matmul output are those of the cache.
+                const std::vector<uint64_t>& rows = this->frontierRowsOf(gs, coForwardLayer, isClient);
+                ShareTensor& cached = acts.tensor(coForwardLayer, ActivationKind::HW);
+                if (!rows.empty()) {
+                    ShareTensor sub;
+                    ShareTensor subOut;
+                    GraphGASLite::gatherRows(vertexSvv, rows, sub);
+                    if ((iter % epochLayerNum) == 0) {
+                        this->secureInputMatMul(gs, sub, weight, subOut, false, &rows, coTid, party);
+                    } else {
+                        this->secureMatMul(gs, sub, weight, subOut, coTid, party);
+                    }
+                    GraphGASLite::scatterRows(subOut, rows, cached);
+                }
+                scaledVertexSvv = cached;
+                return;
+            }
 
-            sci::twoPartyGCNMatMul(
-                vertexSvv, 
-                weight, 
-                scaledVertexSvv,
-                coTid,
-                party
-            );
-        }
-        // The feature is scaled, take care during back layer 
+            // The transposed first layer input is constant and kept in the execution plan.
+            if ((iter % epochLayerNum) != 0) {
+                if (isClient && coTid == (tileIndex + 1) % tileNum) acts.tensor(coForwardLayer, ActivationKind::HT) = transpose(vertexSvv);
+                if ((!isClient) && (coTid + 1) % tileNum == tileIndex) acts.tensor(coForwardLayer, ActivationKind::HT) = transpose(vertexSvv);
+            }
 
-        if ((iter % epochLayerNum) == 0) { // Is the first forward layer
+            if ((iter % epochLayerNum) == 0) {
+                // With plain_input_layer the owner multiplies its plaintext X itself.
+                this->secureInputMatMul(gs, vertexSvv, weight, scaledVertexSvv, false, nullptr, coTid, party);
+            } else {
+                this->secureMatMul(
+                    gs,
+                    vertexSvv, 
+                    weight, 
+                    scaledVertexSvv,
+                    coTid,
+                    party
+                );
+            }
+        }
+        // The forward source scale is folded into the previous layer, see getAggregationNormalizer.
+        if (isForward) {
+            keepScatterSource(gs, coForwardLayer, scaledVertexSvv, isClient);
             return;
         }
 
         sci::twoPartyGCNVectorScale(
             vertexSvv, 
-            normalizer, 
+            *getAggregationNormalizer(gs, iter, length, party), 
             scaledVertexSvv, 
             true,
             coTid, 
@@ -254,6 +321,13 @@ protected:
         );
     }
 
+    // Keep the scatter source of a forward layer for incremental inference to reuse.
+    void keepScatterSource(GraphSummary& gs, uint32_t layer, const ShareTensor& scaledVertexSvv, bool isClient) const {
+        if (GNNParam::getGNNParam().feature_delta_file.empty()) return;
+        ActivationStore& acts = isClient? gs.localActivations : gs.remoteActivations;
+        acts.tensor(layer, ActivationKind::HW) = scaledVertexSvv;
+    }
+
     void ScatterComp(
         ShareVecVec& updateSrcSvv, 
         std::vector<uint64_t>& updateSrcOutDeg, 
@@ -297,7 +371,8 @@ protected:
         //     coTid, 
         //     party
         // );
-        duplicatedUpdateSvv = updateSrcSvv;
+        // The update source is not read after scatter, hand over its buffer.
+        duplicatedUpdateSvv.swap(updateSrcSvv);
 
 #ifdef GCN_LOG
         // printf(">>>>> Scatter Comp duplicatedUpdateSvv: party id %d role %d\n", tileIndex, party);
@@ -373,6 +448,7 @@ protected:
     }
 
     void GatherComp(
+        GraphSummary& gs,
         ShareVecVec& vertexSvv, 
         ShareVecVec& updateSvv, 
         std::vector<bool>& isGatherDstVertexDummy, 
@@ -451,8 +527,7 @@ protected:
         // vertexSvv
         // updateSvv
         // isGatherDstVertexDummy
-        std::vector<bool> cond = isGatherDstVertexDummy;
-        for (int i = 0; i < cond.size(); ++i) cond[i] = !cond[i];
+        std::vector<bool>& cond = (party == sci::ALICE)? gs.plan.localGatherCond[updateSrcTid] : gs.plan.trueVec(vertexSvv.size());
         sci::twoPartyGCNCondVectorAddition(
             vertexSvv, 
             updateSvv, 
@@ -467,15 +542,10 @@ protected:
         // Scale as we have Gathered updates from all parties.
         t_tmp = std::chrono::high_resolution_clock::now();
 
-        if (updateSrcTid == tileNum - 1 && (iter + 1) % epochLayerNum != 0) {
-            std::vector<uint64_t> normalizer(length);
-            for (int i = 0; i < length; ++i) {
-                normalizer[i] = localVertexInDeg[i] == 0 ? 0 : CryptoUtil::encodeDoubleAsFixedPoint(pow((double)localVertexInDeg[i] + 1, -0.5));
-            }
-
+        if (updateSrcTid == tileNum - 1 && isForward) {
             sci::twoPartyGCNVectorScale(
                 vertexSvv, 
-                normalizer, 
+                *getAggregationNormalizer(gs, iter, length, party), 
                 vertexSvv, 
                 isSigned,
                 coTid, 
@@ -493,6 +563,129 @@ protected:
 #endif
     }
 
+    void GatherAllComp(
+        GraphSummary& gs,
+        ShareVecVec& vertexSvv, 
+        std::vector<ShareVecVec>& updateSvvs, 
+        std::vector<uint64_t>& localVertexInDeg,
+        uint64_t iter,
+        uint64_t coTid, 
+        int party
+    ) const {
+        bool isClient = (party == sci::ALICE);
+        size_t sourceNum = updateSvvs.size();
+        std::vector<const std::vector<bool>*> conds(sourceNum);
+        if (!gs.isFrontierOnly) {
+            size_t length = vertexSvv.size();
+            for (size_t j = 0; j < sourceNum; ++j) conds[j] = isClient? &gs.plan.localGatherCond[j] : &gs.plan.trueVec(length);
+            gatherSources(vertexSvv, updateSvvs, conds, *getAggregationNormalizer(gs, iter, length, party), iter, coTid, party);
+            return;
+        }
+
+        // Only the frontier rows are aggregated, the others keep the cached
+        // pre-activation.
+        uint32_t layer = iter % getEpochLayerNum();
+        const std::vector<uint64_t>& rows = this->frontierRowsOf(gs, layer + 1, isClient);
+        ShareVecVec subVertexSvv;
+        GraphGASLite::gatherRows(vertexSvv, rows, subVertexSvv);
+        std::vector<ShareVecVec> subUpdateSvvs(sourceNum);
+        std::vector<std::vector<bool>> subConds(sourceNum, std::vector<bool>(rows.size(), true));
+        std::vector<uint64_t> subNormalizer(rows.size(), 0);
+        for (size_t j = 0; j < sourceNum; ++j) {
+            GraphGASLite::gatherRows(updateSvvs[j], rows, subUpdateSvvs[j]);
+            if (isClient) {
+                for (size_t k = 0; k < rows.size(); ++k) subConds[j][k] = gs.plan.localGatherCond[j][rows[k]];
+            }
+            conds[j] = &subConds[j];
+        }
+        if (isClient) {
+            const std::vector<uint64_t>& normalizer = *getAggregationNormalizer(gs, iter, vertexSvv.size(), party);
+            for (size_t k = 0; k < rows.size(); ++k) subNormalizer[k] = normalizer[rows[k]];
+        }
+        gatherSources(subVertexSvv, subUpdateSvvs, conds, subNormalizer, iter, coTid, party);
+
+        ActivationStore& acts = isClient? gs.localActivations : gs.remoteActivations;
+        vertexSvv = acts.tensor(layer, ActivationKind::Z);
+        GraphGASLite::scatterRows(subVertexSvv, rows, vertexSvv);
+    }
+
+    // Sum the vertex data and the selected updates of all sources, then scale.
+    void gatherSources(
+        ShareVecVec& vertexSvv, 
+        std::vector<ShareVecVec>& updateSvvs, 
+        const std::vector<const std::vector<bool>*>& conds,
+        std::vector<uint64_t>& normalizer,
+        uint64_t iter,
+        uint64_t coTid, 
+        int party
+    ) const {
+        uint32_t epochLayerNum = getEpochLayerNum();
+        bool isForward = ((iter % epochLayerNum) < getForwardLayerNum());
+        size_t length = vertexSvv.size();
+        if (length == 0) return;
+        size_t dim = vertexSvv[0].size();
+        bool isSigned = true;
+
+        auto t_tmp = std::chrono::high_resolution_clock::now();
+
+        // Stack the updates of all sources so one conditional addition selects them
+        // all. The first block adds onto the vertex data, the others onto zeros, and
+        // the blocks are then summed locally.
+        size_t sourceNum = updateSvvs.size();
+        ShareVecVec base(length * sourceNum);
+        ShareVecVec stacked(length * sourceNum);
+        std::vector<bool> cond(length * sourceNum);
+        for (size_t j = 0; j < sourceNum; ++j) {
+            const std::vector<bool>& sourceCond = *conds[j];
+            for (size_t m = 0; m < length; ++m) {
+                size_t row = j * length + m;
+                if (j == 0) base[row].swap(vertexSvv[m]);
+                else base[row].assign(dim, 0);
+                stacked[row].swap(updateSvvs[j][m]);
+                cond[row] = sourceCond[m];
+            }
+        }
+        sci::twoPartyGCNCondVectorAddition(
+            base, 
+            stacked, 
+            cond, 
+            base,
+            coTid, 
+            party
+        );
+        // Leave the update buffers as they were.
+        for (size_t j = 0; j < sourceNum; ++j) {
+            for (size_t m = 0; m < length; ++m) updateSvvs[j][m].swap(stacked[j * length + m]);
+        }
+        ShareVecVec().swap(stacked);
+        for (size_t m = 0; m < length; ++m) {
+            vertexSvv[m].swap(base[m]);
+            for (size_t j = 1; j < sourceNum; ++j) {
+                const ShareVec& sv = base[j * length + m];
+                for (size_t k = 0; k < dim; ++k) vertexSvv[m][k] += sv[k];
+            }
+        }
+        ShareVecVec().swap(base);
+
+        if (party == sci::ALICE) print_duration(t_tmp, "vertex-update-cond-addition");
+        t_tmp = std::chrono::high_resolution_clock::now();
+
+        // One scale, and so one truncation, for the sum of all sources. The backward
+        // pass scales before the aggregation only, see getAggregationNormalizer.
+        if (isForward) {
+            sci::twoPartyGCNVectorScale(
+                vertexSvv, 
+                normalizer, 
+                vertexSvv, 
+                isSigned,
+                coTid, 
+                party
+            );
+        }
+
+        if (party == sci::ALICE) print_duration(t_tmp, "vertex-plus-update-svv-scale");
+    }
+
     void writeGatherTaskResult(const Task& task, ShareVec& dst) const {
         if (!task.finished) {
             throw ResultNotReadyException("Task result not ready yet!\n");
@@ -532,21 +725,27 @@ protected:
         if (isClient) party = sci::ALICE;
         else party = sci::BOB; 
 
-        size_t length = localVertexInDeg.size();
-        std::vector<uint64_t> normalizer(length);
-        for (int i = 0; i < length; ++i) {
-            normalizer[i] = localVertexInDeg[i] == 0 ? 0 : CryptoUtil::encodeDoubleAsFixedPoint(pow((double)localVertexInDeg[i] + 1, -0.5));
-        }
-
         if (isForward) { // FORWARD
             const ShareTensor& weight = isClient? gs.localWeight[coForwardLayer]:gs.remoteWeight[coForwardLayer];
-            TensorVecMap& vertexInterData = isClient? gs.localVertexInterDataTVs[coForwardLayer]:gs.remoteVertexInterDataTVs[coForwardLayer];
+            ActivationStore& acts = isClient? gs.localActivations : gs.remoteActivations;
 
             // printf("H1.2\n");
             if (iter % epochLayerNum != forwardLayerNum - 1) { // GCN_FORWARD_NN
-                vertexInterData["z"] = {vertexDataVec};
+                acts.tensor(coForwardLayer, ActivationKind::Z) = vertexDataVec;
                 ShareTensor new_h;
-                sci::twoPartyGCNRelu(vertexDataVec, new_h, dstTid, party);
+                if (gs.isFrontierOnly) {
+                    // Rows off the frontier are not read, the next layer takes their
+                    // scaled matmul output from the cache.
+                    const std::vector<uint64_t>& rows = this->frontierRowsOf(gs, coForwardLayer + 1, isClient);
+                    ShareTensor z;
+                    ShareTensor h;
+                    GraphGASLite::gatherRows(vertexDataVec, rows, z);
+                    if (!rows.empty()) sci::twoPartyGCNRelu(z, h, dstTid, party);
+                    new_h.assign(vecSize, ShareVec(vecSize == 0? 0 : vertexDataVec[0].size(), 0));
+                    GraphGASLite::scatterRows(h, rows, new_h);
+                } else {
+                    sci::twoPartyGCNRelu(vertexDataVec, new_h, dstTid, party);
+                }
 
 #ifdef GCN_LOG
                 printf(">>>>> Apply Comp forward, z, new_h: party id %d role %d\n", tileIndex, party);
@@ -565,17 +764,36 @@ protected:
                 printf(">> valSetSize %lu\n", valSetSize);
                 printf(">> testSetSize %lu\n", testSetSize);
 #endif
-                vertexInterData["z"] = {vertexDataVec};
-                vertexInterData["p"] = std::vector<ShareTensor>(1);
+                acts.tensor(coForwardLayer, ActivationKind::Z) = vertexDataVec;
                 ShareTensor p;
                 ShareTensor p_minus_y;
-                if (isClient) {
+                // Only the frontier rows are predicted when restricted to them.
+                const std::vector<uint64_t>* frontierRows = gs.isFrontierOnly? &this->frontierRowsOf(gs, coForwardLayer + 1, isClient) : nullptr;
+                ShareTensor frontierLogits;
+                if (frontierRows != nullptr) GraphGASLite::gatherRows(vertexDataVec, *frontierRows, frontierLogits);
+                const ShareTensor& logits = (frontierRows != nullptr)? frontierLogits : vertexDataVec;
+                uint64_t logitNum = logits.size();
+                // Scoring only needs the logits or the class decision, so the softmax
+                // protocols are skipped and nothing is propagated backward.
+                bool isSoftmax = (gnnParam.inference_output == "prob");
+                bool isArgmax = (gnnParam.inference_output == "argmax");
+                if (logitNum == 0) {
+                    // No row changed.
+                } else if (!isSoftmax) {
+                    if (isArgmax) {
+                        GraphGASLite::twoPartySecureArgmax(logits, p, dstTid, party);
+                    } else {
+                        p = logits;
+                    }
+                    p_minus_y.assign(logitNum, ShareVec(gnnParam.num_labels, 0));
+                } else if (isClient) {
                     ShareVecVec label;
-                    for (int i=0; i<vecSize; ++i) {
-                        label.push_back(toShareVec(gs.localVertexVec[i]->data().label, gnnParam.num_labels));
+                    for (int i=0; i<logitNum; ++i) {
+                        uint64_t row = (frontierRows != nullptr)? (*frontierRows)[i] : i;
+                        label.push_back(toShareVec(gs.localVertexVec[row]->data().label, gnnParam.num_labels));
                         // printf("vid %lu\n", (uint64_t)gs.localVertexVec[i]->vid());
                     }
-                    sci::twoPartyGCNForwardNNPredictionWithoutWeight(vertexDataVec, label, p, p_minus_y, dstTid, party);
+                    sci::twoPartyGCNForwardNNPredictionWithoutWeight(logits, label, p, p_minus_y, dstTid, party);
 #ifdef GCN_LOG
                     printf(">>>>> Apply Comp prediction, input, weight, p: party id %d role %d\n", tileIndex, party);
                     sci::printShareVecVec(vertexDataVec, dstTid, party);
@@ -587,8 +805,8 @@ protected:
 #endif
                 } else {
                     ShareVecVec zero_label;
-                    zero_label.resize(vecSize, std::vector<uint64_t>(gnnParam.num_labels, 0));
-                    sci::twoPartyGCNForwardNNPredictionWithoutWeight(vertexDataVec, zero_label, p, p_minus_y, dstTid, party);
+                    zero_label.resize(logitNum, std::vector<uint64_t>(gnnParam.num_labels, 0));
+                    sci::twoPartyGCNForwardNNPredictionWithoutWeight(logits, zero_label, p, p_minus_y, dstTid, party);
 #ifdef GCN_LOG
                     printf(">>>>> Apply Comp prediction, input, weight, p: party id %d role %d\n", tileIndex, party);
                     sci::printShareVecVec(vertexDataVec, dstTid, party);
@@ -600,8 +818,24 @@ protected:
 #endif
                 }
 
+                if (frontierRows != nullptr) {
+                    // The other rows keep the cached predictions.
+                    ShareTensor cachedP = acts.tensor(coForwardLayer, ActivationKind::P);
+                    GraphGASLite::scatterRows(p, *frontierRows, cachedP);
+                    p.swap(cachedP);
+                    p_minus_y.assign(vecSize, ShareVec(gnnParam.num_labels, 0));
+                }
+
+                // The accuracies only need the class decision, so of logits only their
+                // argmax is revealed.
                 DoubleTensor plainP;
-                sci::getPlainShareVecVec(p, plainP, dstTid, party);
+                if (!isSoftmax && !isArgmax && vecSize != 0) {
+                    ShareTensor decision;
+                    GraphGASLite::twoPartySecureArgmax(p, decision, dstTid, party);
+                    sci::getPlainShareVecVec(decision, plainP, dstTid, party);
+                } else {
+                    sci::getPlainShareVecVec(p, plainP, dstTid, party);
+                }
                 if (isClient) {
 #ifdef GCN_LOG
                     printf(">>>>> Apply Comp prediction, y, loss, accuracy: party id %d role %d\n", tileIndex, party);
@@ -611,13 +845,14 @@ protected:
                     DoubleTensor y(vecSize, std::vector<double>(gnnParam.num_labels, 0.0));
                     for (int i=0; i<vecSize; ++i) {
                         y[i][gs.localVertexVec[i]->data().label] = 1.0;
+                        if (!isSoftmax) continue;
                         for (int j=0; j<gnnParam.num_labels; ++j) {
                             if (plainP[i][j] == 0) plainP[i][j] = 0.001;
                         }
                     }
                     // sci::print_vector_of_vector(y);
                     printf("--------\n");
-                    printf("cross-entropy-loss = %lf\n", sci::cross_entropy_loss(y, plainP));
+                    if (isSoftmax) printf("cross-entropy-loss = %lf\n", sci::cross_entropy_loss(y, plainP));
                     DoubleTensor trainingY = DoubleTensor(y.begin(), y.begin() + trainSetSize);
                     DoubleTensor testY = DoubleTensor(y.begin() + trainSetSize + valSetSize, y.end());
                     DoubleTensor trainingPlainP = DoubleTensor(plainP.begin(), plainP.begin() + trainSetSize);
@@ -633,24 +868,30 @@ protected:
                     // printf("<<<<< Apply Comp prediction, y, loss, accuracy: party id %d role %d\n", tileIndex, party);
                 }
 
-                vertexInterData["p"][0].swap(p);
+                acts.tensor(coForwardLayer, ActivationKind::P).swap(p);
                 // Preserve the gradients of training set only
                 // printf("trainSetSize %lu, vecSize %lu\n", trainSetSize, vecSize);
                 for (int i=trainSetSize; i<vecSize; ++i) {
                     p_minus_y[i] = std::vector<uint64_t>(p_minus_y[0].size(), 0);
                 }
                 dstVec.swap(p_minus_y);   
+
+                // Lower layers stay cold until backward reaches them again.
+                for (uint32_t layer = 0; layer + 1 < forwardLayerNum; ++layer) acts.spill(layer);
+#ifdef GCN_LOG
+                acts.printUsage(std::to_string(tileIndex) + (isClient? " local" : " remote"));
+#endif
             }
         } else { // BACKWARD
             ShareTensor weightT = isClient? gs.localWeight[coForwardLayer]:gs.remoteWeight[coForwardLayer];
             ShareTensor& weightRef = isClient? gs.localWeight[coForwardLayer]:gs.remoteWeight[coForwardLayer];
             ShareTensor& coWeightRef = isClient? gs.remoteWeight[coForwardLayer]:gs.localWeight[coForwardLayer];
             weightT = transpose(weightT);
-            TensorVecMap& vertexInterData = isClient? gs.localVertexInterDataTVs[coForwardLayer]:gs.remoteVertexInterDataTVs[coForwardLayer];
-            TensorVecMap& coVertexInterData = isClient? gs.remoteVertexInterDataTVs[coForwardLayer]:gs.localVertexInterDataTVs[coForwardLayer];
+            ActivationStore& acts = isClient? gs.localActivations : gs.remoteActivations;
+            ActivationStore& coActs = isClient? gs.remoteActivations : gs.localActivations;
             bool isFirstOfTwo = (((iter % epochLayerNum) - forwardLayerNum) % 2 == 0);
+            ShareTensor& h_t = (coForwardLayer != 0)? acts.tensor(coForwardLayer, ActivationKind::HT) : (isClient? gs.plan.localInputT : gs.plan.remoteInputT);
             if (coForwardLayer == forwardLayerNum - 1) { // two layers of GCN_BACKWARD_NN_INIT
-                vertexInterData["d"] = std::vector<ShareTensor>(1);
                 ShareTensor d;
                 ShareTensor g;
 #ifdef GCN_LOG
@@ -662,33 +903,33 @@ protected:
                 printf("<<<<< Apply Comp weight_t: party id %d role %d\n", tileIndex, party);
 #endif
                 if (isFirstOfTwo) {
-                    sci::twoPartyGCNMatMul(vertexDataVec, weightT, g, dstTid, party);
-                    vertexInterData["g"] = {g};
+                    this->secureMatMul(gs, vertexDataVec, weightT, g, dstTid, party);
+                    acts.tensor(coForwardLayer, ActivationKind::G).swap(g);
                     dstVec = vertexDataVec;
                     return;
                 }
 
-                sci::twoPartyGCNMatMul(vertexInterData["h_t"][0], vertexDataVec, d , dstTid, party);
+                if (coForwardLayer == 0) {
+                    this->secureInputMatMul(gs, h_t, vertexDataVec, d, true, nullptr, dstTid, party);
+                } else {
+                    this->secureMatMul(gs, h_t, vertexDataVec, d, dstTid, party);
+                }
 
                 uint64_t trainSetSize = (uint64_t)(vecSize * gnnParam.train_ratio);
                 double gradientScaler = (double) 1 / trainSetSize;
                 // double gradientScaler = 1.0;
-                sci::twoPartyGCNMatrixScale(d, static_cast<uint64_t>(gradientScaler * (1<<SCALER_BIT_LENGTH)), d, dstTid, party);
-
-                sci::twoPartyGCNApplyGradient(weightRef, d, static_cast<uint64_t>(gs.learningRate * (1<<SCALER_BIT_LENGTH)), weightRef, dstTid, party);
+                GraphGASLite::twoPartyGradientStep(weightRef, d, gradientScaler, {gs.learningRate}, dstTid, party);
 
                 double weightScaler = (double) 1 / tileNum;
                 sci::twoPartyGCNMatrixScale(weightRef, static_cast<uint64_t>(weightScaler * (1<<SCALER_BIT_LENGTH)), weightRef, dstTid, party);
 
-                vertexInterData["d"][0].swap(d);
-                dstVec.swap(vertexInterData["g"][0]);
+                dstVec.swap(acts.tensor(coForwardLayer, ActivationKind::G));
 #ifdef GCN_LOG
                 printf(">>>>> Apply Comp d: party id %d role %d\n", tileIndex, party);
-                sci::printShareVecVec(vertexInterData["d"][0], dstTid, party);
+                sci::printShareVecVec(d, dstTid, party);
                 printf("<<<<< Apply Comp d: party id %d role %d\n", tileIndex, party);
 #endif
             } else { // GCN_BACKWARD_NN
-                vertexInterData["d"] = std::vector<ShareTensor>(1);
                 ShareTensor d;
                 ShareTensor g;
 #ifdef GCN_LOG
@@ -702,41 +943,42 @@ protected:
                 bool isFirstLayer = false;
                 if (coForwardLayer == 0) isFirstLayer = true; 
                 if (isFirstOfTwo) {
-                    sci::twoPartyGCNBackwardNNWithoutAH(vertexDataVec, vertexInterData["z"][0], weightT, dstVec, g, isFirstLayer, dstTid, party);
-                    vertexInterData["g"] = {g};
+                    sci::twoPartyGCNBackwardNNWithoutAH(vertexDataVec, acts.tensor(coForwardLayer, ActivationKind::Z), weightT, dstVec, g, isFirstLayer, dstTid, party);
+                    acts.tensor(coForwardLayer, ActivationKind::G).swap(g);
                     return;
                 }
 
-                sci::twoPartyGCNMatMul(vertexInterData["h_t"][0], vertexDataVec, d , dstTid, party);
+                if (coForwardLayer == 0) {
+                    this->secureInputMatMul(gs, h_t, vertexDataVec, d, true, nullptr, dstTid, party);
+                } else {
+                    this->secureMatMul(gs, h_t, vertexDataVec, d, dstTid, party);
+                }
 #ifdef GCN_LOG
                 printf(">>>>> Apply Comp d: party id %d role %d\n", tileIndex, party);
                 sci::printShareVecVec(d, dstTid, party);
                 printf("<<<<< Apply Comp d: party id %d role %d\n", tileIndex, party);
                 printf(">>>>> Apply Comp g: party id %d role %d\n", tileIndex, party);
-                sci::printShareVecVec(vertexInterData["g"][0], dstTid, party);
+                sci::printShareVecVec(acts.tensor(coForwardLayer, ActivationKind::G), dstTid, party);
                 printf("<<<<< Apply Comp g: party id %d role %d\n", tileIndex, party);
 #endif
 
                 uint64_t trainSetSize = (uint64_t)(vecSize * gnnParam.train_ratio);
                 double gradientScaler = (double) 1 / trainSetSize;
                 // double gradientScaler = 1.0;
-                sci::twoPartyGCNMatrixScale(d, static_cast<uint64_t>(gradientScaler * (1<<SCALER_BIT_LENGTH)), d, dstTid, party);
-
 #ifdef GCN_LOG
                 printf(">>>>> Apply Comp weight, d, new weight: party id %d role %d\n", tileIndex, party);
                 sci::printShareVecVec(weightRef, dstTid, party);
                 printf("---------\n");
 #endif
-                sci::twoPartyGCNApplyGradient(weightRef, d, static_cast<uint64_t>(gs.learningRate * (1<<SCALER_BIT_LENGTH)), weightRef, dstTid, party);
+                GraphGASLite::twoPartyGradientStep(weightRef, d, gradientScaler, {gs.learningRate}, dstTid, party);
 
                 double weightScaler = (double) 1 / tileNum;
                 sci::twoPartyGCNMatrixScale(weightRef, static_cast<uint64_t>(weightScaler * (1<<SCALER_BIT_LENGTH)), weightRef, dstTid, party);
 
-                vertexInterData["d"][0].swap(d);
-                dstVec.swap(vertexInterData["g"][0]);
+                dstVec.swap(acts.tensor(coForwardLayer, ActivationKind::G));
 
 #ifdef GCN_LOG
-                sci::printShareVecVec(vertexInterData["d"][0], dstTid, party);
+                sci::printShareVecVec(d, dstTid, party);
                 printf("---------\n");
                 sci::printShareVecVec(weightRef, dstTid, party);
                 printf("---------\n");
@@ -744,6 +986,9 @@ protected:
 #endif
             }
 
+            // The layer is not read again until the next forward pass rewrites it.
+            acts.release(coForwardLayer);
+
             Semaphore& remote_weight_ready_smp = serverTaskComm.getRemoteWeightReadySmp();
             Semaphore& weight_avg_finished_smp = clientTaskComm.getWeightAvgFinishedSmp();
             if (isClient) {
@@ -758,7 +1003,7 @@ protected:
                             sci::plaintext_add_matrix_in_place(weightRef, weightFromTheOtherParties[i]);
                         }
                     }
-                    // debugD = sci::plaintext_add_matrix(vertexInterData["d"][0], coVertexInterData["d"][0]);
+                    // debugD = sci::plaintext_add_matrix(acts.tensor(coForwardLayer, ActivationKind::D), coActs.tensor(coForwardLayer, ActivationKind::D));
                     sci::plaintext_add_matrix_in_place(weightRef, coWeightRef);
                     coWeightRef = weightRef;
                     for (int i = 0; i < tileNum; ++i) {
@@ -787,7 +1032,7 @@ protected:
             } else {
                 remote_weight_ready_smp.release();
                 weight_avg_finished_smp.acquire();
-                // ShareVecVec debugD = sci::plaintext_add_matrix(vertexInterData["d"][0], coVertexInterData["d"][0]);
+                // ShareVecVec debugD = sci::plaintext_add_matrix(acts.tensor(coForwardLayer, ActivationKind::D), coActs.tensor(coForwardLayer, ActivationKind::D));
 #ifdef GCN_LOG
                 // printf(">>>>> Apply Comp added d: party id %d role %d\n", tileIndex, party);
                 // sci::printShareVecVec(debugD, dstTid, party);
@@ -810,25 +1055,234 @@ protected:
     void writeApplyTaskVecResult(GraphSummary& gs, uint64_t iter, const std::vector<Task>& taskVec, std::vector<ShareVec>& dstVec, bool isClient) const {
     }
 
-    void onAlgoKernelStart(Ptr<GraphTileType>& graph) const {
+    void onExecutionPlanBuild(GraphSummary& gs) const {
+        TaskComm& clientTaskComm = TaskComm::getClientInstance();
+        size_t tileNum = clientTaskComm.getTileNum();
+        size_t tileIndex = clientTaskComm.getTileIndex();
+
+        size_t length = gs.localVertexInDeg.size();
+        gs.plan.localNormalizer.resize(length);
+        gs.plan.localSquaredNormalizer.resize(length);
+        GraphGASLite::parallel_for(0, length, GraphGASLite::VERTEX_LOOP_GRAIN, [&gs](uint64_t begin, uint64_t end) {
+            for (uint64_t i = begin; i < end; ++i) {
+                gs.plan.localNormalizer[i] = gs.localVertexInDeg[i] == 0 ? 0 : CryptoUtil::encodeDoubleAsFixedPoint(pow((double)gs.localVertexInDeg[i] + 1, -0.5));
+                gs.plan.localSquaredNormalizer[i] = gs.localVertexInDeg[i] == 0 ? 0 : CryptoUtil::encodeDoubleAsFixedPoint(1.0 / ((double)gs.localVertexInDeg[i] + 1));
+            }
+        });
+
+        if (gs.localFeatureCsr.rowCount() != 0) {
+            // Plaintext sparse input: scatter the nonzeros straight into X^T.
+            gs.localFeatureCsr.transposeEncode(gs.plan.localPlainInputT);
+        } else if (gs.isOneSidedInput) {
+            gs.plan.localPlainInputT = transpose(gs.localPlainInput);
+        }
+        gs.plan.localInputT = transpose(gs.localInputSvv);
+        gs.plan.remoteInputT = transpose(gs.remoteInputSvv);
+
+        GNNParam& gnnParam = GNNParam::getGNNParam();
+        if (!gnnParam.activation_spill_dir.empty()) {
+            std::string prefix = gnnParam.activation_spill_dir + "/cognn_act_" + std::to_string(tileIndex);
+            gs.localActivations.spillFileIs(prefix + "_local.bin");
+            gs.remoteActivations.spillFileIs(prefix + "_remote.bin");
+        }
+    }
+
+    std::vector<GraphGASLite::MatMulShape> getIterMatMulShapes(GraphSummary& gs, uint64_t iter) const {
+        uint32_t epochLayerNum = getEpochLayerNum();
+        uint32_t forwardLayerNum = getForwardLayerNum();
+        uint64_t step = iter % epochLayerNum;
+        uint64_t n = gs.localVertexVec.size();
+        uint32_t layer = (step < forwardLayerNum)? step : forwardLayerNum - 1 - ((step - forwardLayerNum) / 2);
+        const bool isInput = (layer == 0 && gs.isOneSidedInput);
+        if (gs.isFrontierOnly) {
+            // Only the frontier rows go through the matmul, if any, a one-sided input
+            // triple covers all rows and the frontier ones are taken from it.
+            if (gs.localFrontierRows[layer].empty()) return std::vector<GraphGASLite::MatMulShape>();
+            if (!isInput) n = gs.localFrontierRows[layer].size();
+        }
+        uint64_t in = gs.localWeight[layer].size();
+        uint64_t out = gs.localWeight[layer].empty()? 0 : gs.localWeight[layer][0].size();
+        // H * W forward, then G * W^T at the top layer and H^T * G for every layer backward.
+        if (step < forwardLayerNum) {
+            return {{n, in, out, isInput? GraphGASLite::MatMulOperand::Input : GraphGASLite::MatMulOperand::Shared}};
+        }
+        bool isFirstOfTwo = ((step - forwardLayerNum) % 2 == 0);
+        if (!isFirstOfTwo) {
+            return {{in, n, out, isInput? GraphGASLite::MatMulOperand::InputT : GraphGASLite::MatMulOperand::Shared}};
+        }
+        if (layer == forwardLayerNum - 1) return {{n, out, in}};
+        return std::vector<GraphGASLite::MatMulShape>();
+    }
+
+    bool getOneSidedVertexDataVector(GraphSummary& gs, ShareVecVec& vertexSvv) const {
+        GNNParam& gnnParam = GNNParam::getGNNParam();
+        // Hybrid inference reads the owner's plaintext input for its local fields.
+        if (!gnnParam.plain_input_layer && !gnnParam.hybrid_inference) return false;
+        vertexSvv.resize(gs.localVertexVec.size());
+        if (gnnParam.sparse_feature) {
+            // Move the per-vertex rows into one CSR matrix in local vertex order.
+            gs.localFeatureCsr.clear();
+            gs.localFeatureCsr.dimIs(gnnParam.input_dim);
+            for (uint64_t i=0; i<gs.localVertexVec.size(); ++i) {
+                auto& data = gs.localVertexVec[i]->data();
+                gs.localFeatureCsr.rowNew(data.featureIdx, data.featureVal);
+                data.featureDel();
+                gs.localFeatureCsr.rowEncode(i, vertexSvv[i]);
+            }
+            return true;
+        }
+        for (uint64_t i=0; i<gs.localVertexVec.size(); ++i) {
+            gs.localVertexVec[i]->data().intoPlainShareVec(vertexSvv[i]);
+        }
+        return true;
     }
 
-    static std::vector<double> normalizeFeatureVec(const std::vector<double>& raw, double inDeg) {
-        // Compute the sum of the features of the node
-        double sum = 0.0;
-        size_t n_features = raw.size();
-        for (int j = 0; j < n_features; j++) {
-            sum += raw[j];
+    bool getSeededVertexDataVectorShare(GraphSummary& gs, ShareVecVec& vertexSvv, GraphGASLite::SeedShareMsg& msg) const {
+        GNNParam& gnnParam = GNNParam::getGNNParam();
+        const uint64_t rows = gs.localVertexVec.size();
+        msg = GraphGASLite::newSeedShareMsg(rows, gnnParam.input_dim);
+        vertexSvv.resize(rows);
+        // Encode, subtract the co-party's share and drop the plaintext row by row.
+        GraphGASLite::forEachSeedShareBlock(msg, [&gs, &vertexSvv](osuCrypto::PRNG& prng, uint64_t begin, uint64_t end) {
+            ShareVec r;
+            for (uint64_t i = begin; i < end; ++i) {
+                auto& data = gs.localVertexVec[i]->data();
+                ShareVec& sv = vertexSvv[i];
+                data.intoPlainShareVec(sv);
+                data.featureDel();
+                r.resize(sv.size());
+                prng.get(r.data(), r.size());
+                for (size_t j = 0; j < sv.size(); ++j) sv[j] -= r[j];
+            }
+        });
+        return true;
+    }
+
+    bool getVertexDataRowsShare(GraphSummary& gs, const std::vector<uint64_t>& rows, ShareVecVec& svv0, ShareVecVec& svv1) const {
+        GNNParam& gnnParam = GNNParam::getGNNParam();
+        bool isNoDummyEdge = TaskComm::getClientInstance().getIsNoDummyEdge();
+        svv0.resize(rows.size());
+        svv1.resize(rows.size());
+        for (uint64_t k=0; k<rows.size(); ++k) {
+            auto& v = gs.localVertexVec[rows[k]];
+            auto& data = v->data();
+            // Normalize as at the kernel start, without the degree preprocessing
+            // gave the dummy source of a vertex without in-edges.
+            double inDeg = (double)(v->inDeg().cnt());
+            const std::vector<bool>& isSrcDummy = v->getIsSrcDummyv();
+            if (isNoDummyEdge && isSrcDummy.size() == 1 && isSrcDummy[0]) inDeg -= 1.0;
+            double scaler = pow(inDeg + 1.0, -0.5);
+            for (auto& x : data.featureVal) x *= scaler;
+            for (auto& x : data.feature) x *= scaler;
+
+            if (gs.isOneSidedInput) {
+                // One-sided input, the rows are masked anew with the whole input.
+                data.intoPlainShareVec(svv0[k]);
+                data.featureDel();
+            } else {
+                data.intoShareVec(svv0[k], svv1[k]);
+            }
+            if (svv0[k].size() != gnnParam.input_dim) {
+                throw RangeException("No new features of vertex " + std::to_string((uint64_t)v->vid()));
+            }
+        }
+        return true;
+    }
+
+    bool onLocalFieldInference(GraphSummary& gs, const std::vector<DoubleTensor>& plainWeight) const {
+        GNNParam& gnnParam = GNNParam::getGNNParam();
+        const uint32_t forwardLayerNum = getForwardLayerNum();
+        const uint64_t n = gs.localVertexVec.size();
+        const uint64_t remoteN = gs.remoteInputSvv.size();
+        CryptoUtil& cryptoUtil = CryptoUtil::getInstance();
+
+        // The secure pass takes the rows off its frontier from the caches: zero,
+        // but for the predictions of the local fields, whose co-party share is zero.
+        for (uint32_t layer=0; layer<forwardLayerNum; ++layer) {
+            const uint64_t outDim = plainWeight[layer].empty()? 0 : plainWeight[layer][0].size();
+            for (auto kind : {ActivationKind::HW, ActivationKind::Z}) {
+                gs.localActivations.tensor(layer, kind).assign(n, ShareVec(outDim, 0));
+                gs.remoteActivations.tensor(layer, kind).assign(remoteN, ShareVec(outDim, 0));
+            }
+        }
+        ShareTensor& p = gs.localActivations.tensor(forwardLayerNum - 1, ActivationKind::P);
+        p.assign(n, ShareVec(gnnParam.num_labels, 0));
+        gs.remoteActivations.tensor(forwardLayerNum - 1, ActivationKind::P).assign(remoteN, ShareVec(gnnParam.num_labels, 0));
+
+        std::unordered_map<uint64_t, uint64_t> rowOfVid;
+        std::vector<double> normalizer(n, 0.0);
+        for (uint64_t i=0; i<n; ++i) {
+            rowOfVid[(uint64_t)gs.localVertexVec[i]->vid()] = i;
+            if (gs.localVertexInDeg[i] != 0) normalizer[i] = pow((double)gs.localVertexInDeg[i] + 1, -0.5);
+        }
+        // The input is pre-scaled and one-sided, the owner has it in the clear.
+        DoubleTensor h(n);
+        for (uint64_t i=0; i<n; ++i) {
+            const ShareVec& x = gs.localPlainInput[i];
+            h[i].resize(x.size());
+            for (uint64_t k=0; k<x.size(); ++k) h[i][k] = cryptoUtil.template decodeFixedPointAs<double>(x[k]);
+        }
+
+        // The same layers as the secure pass, over the local edges only, which
+        // are all edges for the rows of the local fields. Every row is computed,
+        // it costs little next to the secure pass.
+        for (uint32_t layer=0; layer<forwardLayerNum; ++layer) {
+            const DoubleTensor& w = plainWeight[layer];
+            const uint64_t outDim = w.empty()? 0 : w[0].size();
+            DoubleTensor hw(n, std::vector<double>(outDim, 0.0));
+            for (uint64_t i=0; i<n; ++i) {
+                if (h[i].size() != w.size()) throw RangeException("Unmatched plaintext layer input of row " + std::to_string(i));
+                for (uint64_t k=0; k<w.size(); ++k) {
+                    if (h[i][k] == 0) continue;
+                    for (uint64_t j=0; j<outDim; ++j) hw[i][j] += h[i][k] * w[k][j];
+                }
+                if (layer == 0) continue;
+                for (auto& x : hw[i]) x *= normalizer[i];
+            }
+            for (uint64_t i=0; i<n; ++i) {
+                auto& v = gs.localVertexVec[i];
+                const auto& srcs = v->getSrcVertexv();
+                const auto& isSrcDummy = v->getIsSrcDummyv();
+                h[i] = hw[i];
+                for (uint64_t k=0; k<srcs.size(); ++k) {
+                    if (k < isSrcDummy.size() && isSrcDummy[k]) continue;
+                    auto iter = rowOfVid.find((uint64_t)srcs[k]);
+                    if (iter == rowOfVid.end()) continue;
+                    for (uint64_t j=0; j<outDim; ++j) h[i][j] += hw[iter->second][j];
+                }
+                for (auto& x : h[i]) {
+                    x *= normalizer[i];
+                    if (layer + 1 < forwardLayerNum) x = std::max(x, 0.0);
+                }
+            }
+        }
+
+        uint64_t localFieldNum = 0;
+        for (uint64_t i=0; i<n; ++i) {
+            if (!gs.isLocalField[i]) continue;
+            ++localFieldNum;
+            std::vector<double>& logits = h[i];
+            if (logits.size() != gnnParam.num_labels) throw RangeException("Unmatched plaintext logits of row " + std::to_string(i));
+            if (gnnParam.inference_output == "argmax") {
+                // Ties yield more than one hot column, as in the secure argmax.
+                double maxLogit = *std::max_element(logits.begin(), logits.end());
+                for (auto& x : logits) x = (x == maxLogit)? 1.0 : 0.0;
+            } else if (gnnParam.inference_output == "prob") {
+                double maxLogit = *std::max_element(logits.begin(), logits.end());
+                double sum = 0;
+                for (auto& x : logits) {
+                    x = exp(x - maxLogit);
+                    sum += x;
+                }
+                for (auto& x : logits) x /= sum;
+            }
+            for (uint64_t j=0; j<logits.size(); ++j) p[i][j] = CryptoUtil::encodeDoubleAsFixedPoint(logits[j]);
         }
-        if (sum == 0.0) sum = 1.0;
-        // Normalize the features by dividing by the sum
-        std::vector<double> normalized(n_features, 0.0);
-        for (int j = 0; j < n_features; j++) {
-            // normalized[j] = raw[j] / sum;
-            normalized[j] = raw[j];
-            normalized[j] *= pow(inDeg + 1.0, -0.5);
-        }      
-        return normalized;  
+        printf("%lu of %lu vertices predicted in plaintext\n", localFieldNum, n);
+        return true;
+    }
+
+    void onAlgoKernelStart(Ptr<GraphTileType>& graph) const {
     }
 
     // GCN weight initialization function using the Glorot method
@@ -850,34 +1304,36 @@ protected:
 
     void onAlgoKernelStart(Ptr<GraphTileType>& graph, GraphSummary& gs) const {
         GNNParam& gnnParam = GNNParam::getGNNParam();
-        // Feature normalization
-        for (auto vIter = graph->vertexIter(); vIter != graph->vertexIterEnd(); ++vIter) {
-            auto v = vIter->second;
-            auto& data = v->data();
-            double inDeg = (double)(v->inDeg().cnt());
-            data.feature = normalizeFeatureVec(data.feature, inDeg);
+        if (gnnParam.inference_output != "prob" && gnnParam.inference_output != "logits" && gnnParam.inference_output != "argmax") {
+            std::cerr << "Invalid inference_output: expected prob, logits or argmax, got " << gnnParam.inference_output << std::endl;
+            exit(-1);
         }
+        // Feature normalization
+        std::vector<Ptr<VertexType>> vertices;
+        for (auto vIter = graph->vertexIter(); vIter != graph->vertexIterEnd(); ++vIter) vertices.push_back(vIter->second);
+        GraphGASLite::parallel_for(0, vertices.size(), GraphGASLite::VERTEX_LOOP_GRAIN, [&vertices](uint64_t begin, uint64_t end) {
+            for (uint64_t i = begin; i < end; ++i) {
+                auto& data = vertices[i]->data();
+                double inDeg = (double)(vertices[i]->inDeg().cnt());
+                // Scale in place, one pow per vertex.
+                double scaler = pow(inDeg + 1.0, -0.5);
+                for (auto& x : data.featureVal) x *= scaler;
+                for (auto& x : data.feature) x *= scaler;
+            }
+        });
 
         // Initilize weight matrix
         gs.plainWeight.resize(gnnParam.num_layers);
-        // gs.plainWeight[0].resize(gnnParam.input_dim);
-        // for (int i=0; i<gs.plainWeight[0].size(); ++i) {
-        //     gs.plainWeight[0][i].resize(gnnParam.hidden_dim, 0.5);
-        // }
-        // gs.plainWeight[1].resize(gnnParam.hidden_dim);
-        // for (int i=0; i<gs.plainWeight[1].size(); ++i) {
-        //     gs.plainWeight[1][i].resize(gnnParam.num_labels, 0.5);
-        // }
-        gs.plainWeight[0] = initWeight(gnnParam.input_dim, gnnParam.hidden_dim);
-        gs.plainWeight[1] = initWeight(gnnParam.hidden_dim, gnnParam.num_labels);
+        std::vector<uint32_t> dims = gnnParam.getLayerDims();
+        for (int layer = 0; layer < gnnParam.num_layers; ++layer) {
+            gs.plainWeight[layer] = initWeight(dims[layer], dims[layer + 1]);
+        }
 
         gs.localWeight.resize(gnnParam.num_layers);
         gs.remoteWeight.resize(gnnParam.num_layers);
-        // printf("H1\n");
-        intoShareTensor(gs.plainWeight[0], gs.localWeight[0], gs.remoteWeight[0]);
-        // printf("H2\n");
-        intoShareTensor(gs.plainWeight[1], gs.localWeight[1], gs.remoteWeight[1]);
-        // printf("H3\n");
+        for (int layer = 0; layer < gnnParam.num_layers; ++layer) {
+            intoShareTensor(gs.plainWeight[layer], gs.localWeight[layer], gs.remoteWeight[layer]);
+        }
 
         gs.learningRate = gnnParam.learning_rate;
         gs.globalNumSamples = gnnParam.num_samples;
@@ -889,38 +1345,17 @@ protected:
 
     uint32_t getPlainNumPerOperand() const {
         GNNParam& gnnParam = GNNParam::getGNNParam();
-        return std::max(gnnParam.input_dim, gnnParam.hidden_dim); // Fix me
+        std::vector<uint32_t> dims = gnnParam.getLayerDims();
+        return *std::max_element(dims.begin(), dims.end());
     }
 
+    // As wide as the output of the layer of the step, forward and backward.
     uint32_t getPlainNumPerOperand(uint64_t layer) const {
         GNNParam& gnnParam = GNNParam::getGNNParam();
-        layer = layer % ((1 + 2)*gnnParam.num_layers);
-        uint32_t ret = 0;
-        switch (layer) {
-            case 0:
-                ret = gnnParam.hidden_dim;
-                break;
-            case 1:
-                ret = gnnParam.num_labels;
-                break;
-            case 2:
-                ret = gnnParam.num_labels;
-                break;
-            case 3:
-                ret = gnnParam.num_labels;
-                break;
-            case 4:
-                ret = gnnParam.hidden_dim;
-                break;
-            case 5:
-                ret = gnnParam.hidden_dim;
-                break;
-            default:
-                printf("Illegal layer in getPlainNumPerOperand\n");
-                exit(-1);                
-        }
-
-        return ret;
+        uint32_t forwardLayerNum = getForwardLayerNum();
+        uint64_t step = layer % getEpochLayerNum();
+        uint32_t coForwardLayer = (step < forwardLayerNum)? step : forwardLayerNum - 1 - ((step - forwardLayerNum) / 2);
+        return gnnParam.getLayerDims()[coForwardLayer + 1];
     }
 
     uint32_t getForwardLayerNum() const {
@@ -938,9 +1373,29 @@ protected:
         return 3 * gnnParam.num_layers;
     }
 
+    // The normalizer of the one vector scale around the aggregation of iter, N^2
+    // but for the last layer, as in the training kernel. The cached scatter
+    // sources and pre-activations of incremental inference are the row-scaled ones
+    // of the folded chain, which the frontier pass reproduces.
+    std::vector<uint64_t>* getAggregationNormalizer(GraphSummary& gs, uint64_t iter, size_t length, int party) const {
+        uint32_t epochLayerNum = getEpochLayerNum();
+        uint32_t forwardLayerNum = getForwardLayerNum();
+        uint32_t layerIndex = iter % epochLayerNum;
+        uint32_t aggregationLayer = layerIndex;
+        if (layerIndex >= forwardLayerNum) {
+            uint32_t backwardIndex = layerIndex - forwardLayerNum;
+            aggregationLayer = forwardLayerNum - 1 - backwardIndex / 2 + ((backwardIndex % 2 == 0)? 1 : 0);
+        }
+        if (party != sci::ALICE) return &gs.plan.zeroVec(length);
+        return (aggregationLayer + 1 < forwardLayerNum)? &gs.plan.localSquaredNormalizer : &gs.plan.localNormalizer;
+    }
+
     std::vector<uint32_t> getDimensionVec() const {
         GNNParam& gnnParam = GNNParam::getGNNParam();
-        std::vector<uint32_t> dimensions = {gnnParam.hidden_dim, gnnParam.num_labels, 0, 0, 0, 0};
+        // Inference only scatters forward.
+        std::vector<uint32_t> dims = gnnParam.getLayerDims();
+        std::vector<uint32_t> dimensions(getEpochLayerNum(), 0);
+        for (uint32_t layer = 0; layer < getForwardLayerNum(); ++layer) dimensions[layer] = dims[layer + 1];
         return dimensions;
     }
 
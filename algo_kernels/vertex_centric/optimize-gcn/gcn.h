@@ -49,6 +49,9 @@
 struct GCNData {
     // # Feature
     std::vector<double> feature;
+    // # Sparse feature (nonzero columns and values), used instead of feature with sparse_feature
+    std::vector<uint32_t> featureIdx;
+    std::vector<double> featureVal;
     int label;
 
     // GraphGASLite::IterCount activeIter;
@@ -61,21 +64,59 @@ struct GCNData {
 
     GCNData(const GraphGASLite::VertexIdx&) {}
 
+    // Split into two shares written in place. The plaintext features are released
+    // once split, so only the shares stay resident.
     void intoShareVec(ShareVec& sv0, ShareVec& sv1) {
-        std::vector<uint64_t> feature_share0, feature_share1;
+        GNNParam& gnnParam = GNNParam::getGNNParam();
+        if (gnnParam.sparse_feature) {
+            // Zero entries still need random shares, but are never materialized as doubles.
+            size_t feature_length = gnnParam.input_dim;
+            sv0.resize(feature_length);
+            sv1.resize(feature_length);
+            size_t k = 0;
+            for (uint32_t i=0; i<feature_length; ++i) {
+                double x = (k < featureIdx.size() && featureIdx[k] == i)? featureVal[k++] : 0.0;
+                CryptoUtil::intoShares(x, sv0[i], sv1[i]);
+            }
+            featureDel();
+            return;
+        }
+
         size_t feature_length = feature.size();
-        feature_share0.resize(feature_length);
-        feature_share1.resize(feature_length);
+        sv0.resize(feature_length);
+        sv1.resize(feature_length);
         for (int i=0; i<feature_length; ++i) {
-            CryptoUtil::intoShares(feature[i], feature_share0[i], feature_share1[i]);
+            CryptoUtil::intoShares(feature[i], sv0[i], sv1[i]);
         }
+        featureDel();
+    }
 
-        sv0.swap(feature_share0);
-        sv1.swap(feature_share1);
+    void featureDel() {
+        std::vector<double>().swap(feature);
+        std::vector<uint32_t>().swap(featureIdx);
+        std::vector<double>().swap(featureVal);
     }
 
-    void fromShareVec(const ShareVec& sv0, const ShareVec& sv1) {
+    void intoPlainShareVec(ShareVec& sv) const {
+        GNNParam& gnnParam = GNNParam::getGNNParam();
+        if (gnnParam.sparse_feature) {
+            sv.assign(gnnParam.input_dim, 0);
+            for (size_t k=0; k<featureIdx.size(); ++k) {
+                sv[featureIdx[k]] = CryptoUtil::encodeDoubleAsFixedPoint(featureVal[k]);
+            }
+            return;
+        }
+
         size_t feature_length = feature.size();
+        sv.resize(feature_length);
+        for (int i=0; i<feature_length; ++i) {
+            sv[i] = CryptoUtil::encodeDoubleAsFixedPoint(feature[i]);
+        }
+    }
+
+    void fromShareVec(const ShareVec& sv0, const ShareVec& sv1) {
+        size_t feature_length = sv0.size();
+        feature.resize(feature_length);
         for (int i=0; i<feature_length; ++i) {
             feature[i] = CryptoUtil::mergeShareAsDouble(sv0[i], sv1[i]);
         }
@@ -167,7 +208,8 @@ protected:
     typedef typename GraphTileType::VertexType VertexType;
     typedef typename GraphTileType::EdgeType::WeightType EdgeWeightType;
     typedef typename GraphGASLite::SSEdgeCentricAlgoKernel<GraphTileType>::GraphSummary GraphSummary; 
-    typedef typename GraphGASLite::SSEdgeCentricAlgoKernel<GraphTileType>::TensorVecMap TensorVecMap; 
+    typedef GraphGASLite::ActivationStore ActivationStore;
+    typedef GraphGASLite::ActivationKind ActivationKind;
 
     std::pair<UpdateType, bool> scatter(const GraphGASLite::IterCount& iter, Ptr<VertexType>& src, EdgeWeightType& weight) const {
         return std::make_pair(GCNUpdate(), false);
@@ -215,38 +257,42 @@ protected:
         bool isClient = (party == sci::ALICE);
 
         size_t length = vertexSvv.size();
-        std::vector<uint64_t> normalizer(length);
-        for (int i = 0; i < length; ++i) {
-            normalizer[i] = vertexOutDeg[i] == 0 ? 0 : CryptoUtil::encodeDoubleAsFixedPoint(pow((double)vertexOutDeg[i] + 1, -0.5));
-        }
 
         if (isForward) { // FORWARD
             const ShareTensor& weight = isClient? gs.localWeight[coForwardLayer]:gs.remoteWeight[coForwardLayer];
-            TensorVecMap& vertexInterData = isClient? gs.localVertexInterDataTVs[coForwardLayer]:gs.remoteVertexInterDataTVs[coForwardLayer];
+            ActivationStore& acts = isClient? gs.localActivations : gs.remoteActivations;
 
             TaskComm& clientTaskComm = TaskComm::getClientInstance();
             size_t tileNum = clientTaskComm.getTileNum();
             size_t tileIndex = clientTaskComm.getTileIndex();
-            if (isClient && coTid == (tileIndex + 1) % tileNum) vertexInterData["h_t"] = {transpose(vertexSvv)};
-            if ((!isClient) && (coTid + 1) % tileNum == tileIndex) vertexInterData["h_t"] = {transpose(vertexSvv)};
+            // The transposed first layer input is constant and kept in the execution plan.
+            if ((iter % epochLayerNum) != 0) {
+                if (isClient && coTid == (tileIndex + 1) % tileNum) acts.tensor(coForwardLayer, ActivationKind::HT) = transpose(vertexSvv);
+                if ((!isClient) && (coTid + 1) % tileNum == tileIndex) acts.tensor(coForwardLayer, ActivationKind::HT) = transpose(vertexSvv);
+            }
 
-            sci::twoPartyGCNMatMul(
-                vertexSvv, 
-                weight, 
-                scaledVertexSvv,
-                coTid,
-                party
-            );
+            if ((iter % epochLayerNum) == 0) {
+                // With plain_input_layer the owner multiplies its plaintext X itself.
+                this->secureInputMatMul(gs, vertexSvv, weight, scaledVertexSvv, false, nullptr, coTid, party);
+            } else {
+                this->secureMatMul(
+                    gs,
+                    vertexSvv, 
+                    weight, 
+                    scaledVertexSvv,
+                    coTid,
+                    party
+                );
+            }
         }
-        // The feature is scaled, take care during back layer 
-
-        if ((iter % epochLayerNum) == 0) { // Is the first forward layer
+        // The forward source scale is folded into the previous layer, see getAggregationNormalizer.
+        if (isForward) {
             return;
         }
 
         sci::twoPartyGCNVectorScale(
             vertexSvv, 
-            normalizer, 
+            *getAggregationNormalizer(gs, iter, length, party), 
             scaledVertexSvv, 
             true,
             coTid, 
@@ -297,7 +343,8 @@ protected:
         //     coTid, 
         //     party
         // );
-        duplicatedUpdateSvv = updateSrcSvv;
+        // The update source is not read after scatter, hand over its buffer.
+        duplicatedUpdateSvv.swap(updateSrcSvv);
 
 #ifdef GCN_LOG
         // printf(">>>>> Scatter Comp duplicatedUpdateSvv: party id %d role %d\n", tileIndex, party);
@@ -373,6 +420,7 @@ protected:
     }
 
     void GatherComp(
+        GraphSummary& gs,
         ShareVecVec& vertexSvv, 
         ShareVecVec& updateSvv, 
         std::vector<bool>& isGatherDstVertexDummy, 
@@ -451,8 +499,7 @@ protected:
         // vertexSvv
         // updateSvv
         // isGatherDstVertexDummy
-        std::vector<bool> cond = isGatherDstVertexDummy;
-        for (int i = 0; i < cond.size(); ++i) cond[i] = !cond[i];
+        std::vector<bool>& cond = (party == sci::ALICE)? gs.plan.localGatherCond[updateSrcTid] : gs.plan.trueVec(vertexSvv.size());
         sci::twoPartyGCNCondVectorAddition(
             vertexSvv, 
             updateSvv, 
@@ -467,15 +514,10 @@ protected:
         // Scale as we have Gathered updates from all parties.
         t_tmp = std::chrono::high_resolution_clock::now();
 
-        if (updateSrcTid == tileNum - 1 && (iter + 1) % epochLayerNum != 0) {
-            std::vector<uint64_t> normalizer(length);
-            for (int i = 0; i < length; ++i) {
-                normalizer[i] = localVertexInDeg[i] == 0 ? 0 : CryptoUtil::encodeDoubleAsFixedPoint(pow((double)localVertexInDeg[i] + 1, -0.5));
-            }
-
+        if (updateSrcTid == tileNum - 1 && isForward) {
             sci::twoPartyGCNVectorScale(
                 vertexSvv, 
-                normalizer, 
+                *getAggregationNormalizer(gs, iter, length, party), 
                 vertexSvv, 
                 isSigned,
                 coTid, 
@@ -493,6 +535,82 @@ protected:
 #endif
     }
 
+    void GatherAllComp(
+        GraphSummary& gs,
+        ShareVecVec& vertexSvv, 
+        std::vector<ShareVecVec>& updateSvvs, 
+        std::vector<uint64_t>& localVertexInDeg,
+        uint64_t iter,
+        uint64_t coTid, 
+        int party
+    ) const {
+        uint32_t epochLayerNum = getEpochLayerNum();
+        bool isForward = ((iter % epochLayerNum) < getForwardLayerNum());
+        size_t length = vertexSvv.size();
+        if (length == 0) return;
+        size_t dim = vertexSvv[0].size();
+        bool isSigned = true;
+
+        auto t_tmp = std::chrono::high_resolution_clock::now();
+
+        // Stack the updates of all sources so one conditional addition selects them
+        // all. The first block adds onto the vertex data, the others onto zeros, and
+        // the blocks are then summed locally.
+        size_t sourceNum = updateSvvs.size();
+        ShareVecVec base(length * sourceNum);
+        ShareVecVec stacked(length * sourceNum);
+        std::vector<bool> cond(length * sourceNum);
+        for (size_t j = 0; j < sourceNum; ++j) {
+            std::vector<bool>& sourceCond = (party == sci::ALICE)? gs.plan.localGatherCond[j] : gs.plan.trueVec(length);
+            for (size_t m = 0; m < length; ++m) {
+                size_t row = j * length + m;
+                if (j == 0) base[row].swap(vertexSvv[m]);
+                else base[row].assign(dim, 0);
+                stacked[row].swap(updateSvvs[j][m]);
+                cond[row] = sourceCond[m];
+            }
+        }
+        sci::twoPartyGCNCondVectorAddition(
+            base, 
+            stacked, 
+            cond, 
+            base,
+            coTid, 
+            party
+        );
+        // Leave the update buffers as they were.
+        for (size_t j = 0; j < sourceNum; ++j) {
+            for (size_t m = 0; m < length; ++m) updateSvvs[j][m].swap(stacked[j * length + m]);
+        }
+        ShareVecVec().swap(stacked);
+        for (size_t m = 0; m < length; ++m) {
+            vertexSvv[m].swap(base[m]);
+            for (size_t j = 1; j < sourceNum; ++j) {
+                const ShareVec& sv = base[j * length + m];
+                for (size_t k = 0; k < dim; ++k) vertexSvv[m][k] += sv[k];
+            }
+        }
+        ShareVecVec().swap(base);
+
+        if (party == sci::ALICE) print_duration(t_tmp, "vertex-update-cond-addition");
+        t_tmp = std::chrono::high_resolution_clock::now();
+
+        // One scale, and so one truncation, for the sum of all sources. The backward
+        // pass scales before the aggregation only, see getAggregationNormalizer.
+        if (isForward) {
+            sci::twoPartyGCNVectorScale(
+                vertexSvv, 
+                *getAggregationNormalizer(gs, iter, length, party), 
+                vertexSvv, 
+                isSigned,
+                coTid, 
+                party
+            );
+        }
+
+        if (party == sci::ALICE) print_duration(t_tmp, "vertex-plus-update-svv-scale");
+    }
+
     void writeGatherTaskResult(const Task& task, ShareVec& dst) const {
         if (!task.finished) {
             throw ResultNotReadyException("Task result not ready yet!\n");
@@ -532,19 +650,13 @@ protected:
         if (isClient) party = sci::ALICE;
         else party = sci::BOB; 
 
-        size_t length = localVertexInDeg.size();
-        std::vector<uint64_t> normalizer(length);
-        for (int i = 0; i < length; ++i) {
-            normalizer[i] = localVertexInDeg[i] == 0 ? 0 : CryptoUtil::encodeDoubleAsFixedPoint(pow((double)localVertexInDeg[i] + 1, -0.5));
-        }
-
         if (isForward) { // FORWARD
             const ShareTensor& weight = isClient? gs.localWeight[coForwardLayer]:gs.remoteWeight[coForwardLayer];
-            TensorVecMap& vertexInterData = isClient? gs.localVertexInterDataTVs[coForwardLayer]:gs.remoteVertexInterDataTVs[coForwardLayer];
+            ActivationStore& acts = isClient? gs.localActivations : gs.remoteActivations;
 
             // printf("H1.2\n");
             if (iter % epochLayerNum != forwardLayerNum - 1) { // GCN_FORWARD_NN
-                vertexInterData["z"] = {vertexDataVec};
+                acts.tensor(coForwardLayer, ActivationKind::Z) = vertexDataVec;
                 ShareTensor new_h;
                 sci::twoPartyGCNRelu(vertexDataVec, new_h, dstTid, party);
 
@@ -565,17 +677,21 @@ protected:
                 printf(">> valSetSize %lu\n", valSetSize);
                 printf(">> testSetSize %lu\n", testSetSize);
 #endif
-                vertexInterData["z"] = {vertexDataVec};
-                vertexInterData["p"] = std::vector<ShareTensor>(1);
+                acts.tensor(coForwardLayer, ActivationKind::Z) = vertexDataVec;
+                // The softmax is row-wise, so the models go through it stacked row-wise.
+                uint32_t modelNum = getModelNum();
+                ShareTensor stackedZ;
+                if (modelNum > 1) GraphGASLite::stackModelColumns(vertexDataVec, modelNum, stackedZ);
+                const ShareTensor& z = (modelNum > 1)? stackedZ : vertexDataVec;
                 ShareTensor p;
                 ShareTensor p_minus_y;
                 if (isClient) {
                     ShareVecVec label;
-                    for (int i=0; i<vecSize; ++i) {
-                        label.push_back(toShareVec(gs.localVertexVec[i]->data().label, gnnParam.num_labels));
+                    for (int i=0; i<modelNum*vecSize; ++i) {
+                        label.push_back(toShareVec(gs.localVertexVec[i % vecSize]->data().label, gnnParam.num_labels));
                         // printf("vid %lu\n", (uint64_t)gs.localVertexVec[i]->vid());
                     }
-                    sci::twoPartyGCNForwardNNPredictionWithoutWeight(vertexDataVec, label, p, p_minus_y, dstTid, party);
+                    sci::twoPartyGCNForwardNNPredictionWithoutWeight(z, label, p, p_minus_y, dstTid, party);
 #ifdef GCN_LOG
                     printf(">>>>> Apply Comp prediction, input, weight, p: party id %d role %d\n", tileIndex, party);
                     sci::printShareVecVec(vertexDataVec, dstTid, party);
@@ -587,8 +703,8 @@ protected:
 #endif
                 } else {
                     ShareVecVec zero_label;
-                    zero_label.resize(vecSize, std::vector<uint64_t>(gnnParam.num_labels, 0));
-                    sci::twoPartyGCNForwardNNPredictionWithoutWeight(vertexDataVec, zero_label, p, p_minus_y, dstTid, party);
+                    zero_label.resize(modelNum*vecSize, std::vector<uint64_t>(gnnParam.num_labels, 0));
+                    sci::twoPartyGCNForwardNNPredictionWithoutWeight(z, zero_label, p, p_minus_y, dstTid, party);
 #ifdef GCN_LOG
                     printf(">>>>> Apply Comp prediction, input, weight, p: party id %d role %d\n", tileIndex, party);
                     sci::printShareVecVec(vertexDataVec, dstTid, party);
@@ -600,57 +716,43 @@ protected:
 #endif
                 }
 
-                DoubleTensor plainP;
-                sci::getPlainShareVecVec(p, plainP, dstTid, party);
-                if (isClient) {
-#ifdef GCN_LOG
-                    printf(">>>>> Apply Comp prediction, y, loss, accuracy: party id %d role %d\n", tileIndex, party);
-                    sci::print_vector_of_vector(plainP, 10);
-                    printf("--------\n");
-#endif
-                    DoubleTensor y(vecSize, std::vector<double>(gnnParam.num_labels, 0.0));
-                    for (int i=0; i<vecSize; ++i) {
-                        y[i][gs.localVertexVec[i]->data().label] = 1.0;
-                        for (int j=0; j<gnnParam.num_labels; ++j) {
-                            if (plainP[i][j] == 0) plainP[i][j] = 0.001;
-                        }
-                    }
-                    // sci::print_vector_of_vector(y);
-                    printf("--------\n");
-                    printf("cross-entropy-loss = %lf\n", sci::cross_entropy_loss(y, plainP));
-                    DoubleTensor trainingY = DoubleTensor(y.begin(), y.begin() + trainSetSize);
-                    DoubleTensor testY = DoubleTensor(y.begin() + trainSetSize + valSetSize, y.end());
-                    DoubleTensor trainingPlainP = DoubleTensor(plainP.begin(), plainP.begin() + trainSetSize);
-                    DoubleTensor testPlainP = DoubleTensor(plainP.begin() + trainSetSize + valSetSize, plainP.end());
-                    std::vector<bool> trainingIsBorder = std::vector<bool>(gs.isLocalVertexBorder.begin(), gs.isLocalVertexBorder.begin() + trainSetSize);
-                    std::vector<bool> testIsBorder = std::vector<bool>(gs.isLocalVertexBorder.begin() + trainSetSize + valSetSize, gs.isLocalVertexBorder.end());
-                    printf("full set accuracy = %lf\n", sci::accuracy(y, plainP));
-                    printf("training set accuracy = %lf\n", sci::accuracy(trainingY, trainingPlainP));
-                    printf("border training set accuracy = %lf\n", sci::accuracy(trainingY, trainingPlainP, trainingIsBorder));
-                    printf("test set accuracy = %lf\n", sci::accuracy(testY, testPlainP));
-                    printf("border test set accuracy = %lf\n", sci::accuracy(testY, testPlainP, testIsBorder));
-                    printf("the number of vertices is %lu, the number of border vertices is %lu\n", y.size(), sci::count_true(gs.isLocalVertexBorder));
-                    // printf("<<<<< Apply Comp prediction, y, loss, accuracy: party id %d role %d\n", tileIndex, party);
+                uint64_t epoch = iter / epochLayerNum;
+                uint64_t epochNum = (gs.endIter + epochLayerNum - 1) / epochLayerNum;
+                if (GraphGASLite::isEvalEpoch(epoch, epochNum, gnnParam.eval_interval)) {
+                    evaluate(gs, p, trainSetSize, valSetSize, dstTid, party);
+                }
+                if (modelNum > 1) {
+                    ShareTensor stacked;
+                    stacked.swap(p);
+                    GraphGASLite::unstackModelColumns(stacked, modelNum, p);
+                    stacked.swap(p_minus_y);
+                    GraphGASLite::unstackModelColumns(stacked, modelNum, p_minus_y);
                 }
 
-                vertexInterData["p"][0].swap(p);
+                acts.tensor(coForwardLayer, ActivationKind::P).swap(p);
                 // Preserve the gradients of training set only
                 // printf("trainSetSize %lu, vecSize %lu\n", trainSetSize, vecSize);
                 for (int i=trainSetSize; i<vecSize; ++i) {
                     p_minus_y[i] = std::vector<uint64_t>(p_minus_y[0].size(), 0);
                 }
                 dstVec.swap(p_minus_y);   
+
+                // Lower layers stay cold until backward reaches them again.
+                for (uint32_t layer = 0; layer + 1 < forwardLayerNum; ++layer) acts.spill(layer);
+#ifdef GCN_LOG
+                acts.printUsage(std::to_string(tileIndex) + (isClient? " local" : " remote"));
+#endif
             }
         } else { // BACKWARD
             ShareTensor weightT = isClient? gs.localWeight[coForwardLayer]:gs.remoteWeight[coForwardLayer];
             ShareTensor& weightRef = isClient? gs.localWeight[coForwardLayer]:gs.remoteWeight[coForwardLayer];
             ShareTensor& coWeightRef = isClient? gs.remoteWeight[coForwardLayer]:gs.localWeight[coForwardLayer];
             weightT = transpose(weightT);
-            TensorVecMap& vertexInterData = isClient? gs.localVertexInterDataTVs[coForwardLayer]:gs.remoteVertexInterDataTVs[coForwardLayer];
-            TensorVecMap& coVertexInterData = isClient? gs.remoteVertexInterDataTVs[coForwardLayer]:gs.localVertexInterDataTVs[coForwardLayer];
+            ActivationStore& acts = isClient? gs.localActivations : gs.remoteActivations;
+            ActivationStore& coActs = isClient? gs.remoteActivations : gs.localActivations;
             bool isFirstOfTwo = (((iter % epochLayerNum) - forwardLayerNum) % 2 == 0);
+            ShareTensor& h_t = (coForwardLayer != 0)? acts.tensor(coForwardLayer, ActivationKind::HT) : (isClient? gs.plan.localInputT : gs.plan.remoteInputT);
             if (coForwardLayer == forwardLayerNum - 1) { // two layers of GCN_BACKWARD_NN_INIT
-                vertexInterData["d"] = std::vector<ShareTensor>(1);
                 ShareTensor d;
                 ShareTensor g;
 #ifdef GCN_LOG
@@ -662,33 +764,37 @@ protected:
                 printf("<<<<< Apply Comp weight_t: party id %d role %d\n", tileIndex, party);
 #endif
                 if (isFirstOfTwo) {
-                    sci::twoPartyGCNMatMul(vertexDataVec, weightT, g, dstTid, party);
-                    vertexInterData["g"] = {g};
+                    this->secureMatMul(gs, vertexDataVec, weightT, g, dstTid, party);
+                    acts.tensor(coForwardLayer, ActivationKind::G).swap(g);
                     dstVec = vertexDataVec;
                     return;
                 }
 
-                sci::twoPartyGCNMatMul(vertexInterData["h_t"][0], vertexDataVec, d , dstTid, party);
+                if (coForwardLayer == 0) {
+                    this->secureInputMatMul(gs, h_t, vertexDataVec, d, true, nullptr, dstTid, party);
+                } else {
+                    this->secureMatMul(gs, h_t, vertexDataVec, d, dstTid, party);
+                }
 
                 uint64_t trainSetSize = (uint64_t)(vecSize * gnnParam.train_ratio);
                 double gradientScaler = (double) 1 / trainSetSize;
                 // double gradientScaler = 1.0;
-                sci::twoPartyGCNMatrixScale(d, static_cast<uint64_t>(gradientScaler * (1<<SCALER_BIT_LENGTH)), d, dstTid, party);
-
-                sci::twoPartyGCNApplyGradient(weightRef, d, static_cast<uint64_t>(gs.learningRate * (1<<SCALER_BIT_LENGTH)), weightRef, dstTid, party);
+                if (getModelNum() > 1) {
+                    applyModelGradients(gs, weightRef, d, gradientScaler, coForwardLayer, dstTid, party);
+                } else {
+                    GraphGASLite::twoPartyGradientStep(weightRef, d, gradientScaler, {gs.learningRate}, dstTid, party);
+                }
 
                 // double weightScaler = (double) 1 / tileNum;
                 // sci::twoPartyGCNMatrixScale(weightRef, static_cast<uint64_t>(weightScaler * (1<<SCALER_BIT_LENGTH)), weightRef, dstTid, party);
 
-                vertexInterData["d"][0].swap(d);
-                dstVec.swap(vertexInterData["g"][0]);
+                dstVec.swap(acts.tensor(coForwardLayer, ActivationKind::G));
 #ifdef GCN_LOG
                 printf(">>>>> Apply Comp d: party id %d role %d\n", tileIndex, party);
-                sci::printShareVecVec(vertexInterData["d"][0], dstTid, party);
+                sci::printShareVecVec(d, dstTid, party);
                 printf("<<<<< Apply Comp d: party id %d role %d\n", tileIndex, party);
 #endif
             } else { // GCN_BACKWARD_NN
-                vertexInterData["d"] = std::vector<ShareTensor>(1);
                 ShareTensor d;
                 ShareTensor g;
 #ifdef GCN_LOG
@@ -702,41 +808,46 @@ protected:
                 bool isFirstLayer = false;
                 if (coForwardLayer == 0) isFirstLayer = true; 
                 if (isFirstOfTwo) {
-                    sci::twoPartyGCNBackwardNNWithoutAH(vertexDataVec, vertexInterData["z"][0], weightT, dstVec, g, isFirstLayer, dstTid, party);
-                    vertexInterData["g"] = {g};
+                    sci::twoPartyGCNBackwardNNWithoutAH(vertexDataVec, acts.tensor(coForwardLayer, ActivationKind::Z), weightT, dstVec, g, isFirstLayer, dstTid, party);
+                    acts.tensor(coForwardLayer, ActivationKind::G).swap(g);
                     return;
                 }
 
-                sci::twoPartyGCNMatMul(vertexInterData["h_t"][0], vertexDataVec, d , dstTid, party);
+                if (coForwardLayer == 0) {
+                    this->secureInputMatMul(gs, h_t, vertexDataVec, d, true, nullptr, dstTid, party);
+                } else {
+                    this->secureMatMul(gs, h_t, vertexDataVec, d, dstTid, party);
+                }
 #ifdef GCN_LOG
                 printf(">>>>> Apply Comp d: party id %d role %d\n", tileIndex, party);
                 sci::printShareVecVec(d, dstTid, party);
                 printf("<<<<< Apply Comp d: party id %d role %d\n", tileIndex, party);
                 printf(">>>>> Apply Comp g: party id %d role %d\n", tileIndex, party);
-                sci::printShareVecVec(vertexInterData["g"][0], dstTid, party);
+                sci::printShareVecVec(acts.tensor(coForwardLayer, ActivationKind::G), dstTid, party);
                 printf("<<<<< Apply Comp g: party id %d role %d\n", tileIndex, party);
 #endif
 
                 uint64_t trainSetSize = (uint64_t)(vecSize * gnnParam.train_ratio);
                 double gradientScaler = (double) 1 / trainSetSize;
                 // double gradientScaler = 1.0;
-                sci::twoPartyGCNMatrixScale(d, static_cast<uint64_t>(gradientScaler * (1<<SCALER_BIT_LENGTH)), d, dstTid, party);
-
 #ifdef GCN_LOG
                 printf(">>>>> Apply Comp weight, d, new weight: party id %d role %d\n", tileIndex, party);
                 sci::printShareVecVec(weightRef, dstTid, party);
                 printf("---------\n");
 #endif
-                sci::twoPartyGCNApplyGradient(weightRef, d, static_cast<uint64_t>(gs.learningRate * (1<<SCALER_BIT_LENGTH)), weightRef, dstTid, party);
+                if (getModelNum() > 1) {
+                    applyModelGradients(gs, weightRef, d, gradientScaler, coForwardLayer, dstTid, party);
+                } else {
+                    GraphGASLite::twoPartyGradientStep(weightRef, d, gradientScaler, {gs.learningRate}, dstTid, party);
+                }
 
                 // double weightScaler = (double) 1 / tileNum;
                 // sci::twoPartyGCNMatrixScale(weightRef, static_cast<uint64_t>(weightScaler * (1<<SCALER_BIT_LENGTH)), weightRef, dstTid, party);
 
-                vertexInterData["d"][0].swap(d);
-                dstVec.swap(vertexInterData["g"][0]);
+                dstVec.swap(acts.tensor(coForwardLayer, ActivationKind::G));
 
 #ifdef GCN_LOG
-                sci::printShareVecVec(vertexInterData["d"][0], dstTid, party);
+                sci::printShareVecVec(d, dstTid, party);
                 printf("---------\n");
                 sci::printShareVecVec(weightRef, dstTid, party);
                 printf("---------\n");
@@ -744,6 +855,9 @@ protected:
 #endif
             }
 
+            // The layer is not read again until the next forward pass rewrites it.
+            acts.release(coForwardLayer);
+
             Semaphore& remote_weight_ready_smp = serverTaskComm.getRemoteWeightReadySmp();
             Semaphore& weight_avg_finished_smp = clientTaskComm.getWeightAvgFinishedSmp();
             if (isClient) {
@@ -758,10 +872,12 @@ protected:
                             sci::plaintext_add_matrix_in_place(weightRef, weightFromTheOtherParties[i]);
                         }
                     }
-                    // debugD = sci::plaintext_add_matrix(vertexInterData["d"][0], coVertexInterData["d"][0]);
+                    // debugD = sci::plaintext_add_matrix(acts.tensor(coForwardLayer, ActivationKind::D), coActs.tensor(coForwardLayer, ActivationKind::D));
                     sci::plaintext_add_matrix_in_place(weightRef, coWeightRef);
                     double weightScaler = (double) 1 / tileNum;
                     sci::twoPartyGCNMatrixScale(weightRef, static_cast<uint64_t>(weightScaler * (1<<SCALER_BIT_LENGTH)), weightRef, 1-tileIndex, tileIndex + 1);
+                    // The scale may leave rounding noise in the zero blocks.
+                    if (coForwardLayer != 0) GraphGASLite::maskModelBlocks(weightRef, getModelNum());
                     coWeightRef = weightRef;
 
                     for (int i = 0; i < tileNum; ++i) {
@@ -790,7 +906,7 @@ protected:
             } else {
                 remote_weight_ready_smp.release();
                 weight_avg_finished_smp.acquire();
-                // ShareVecVec debugD = sci::plaintext_add_matrix(vertexInterData["d"][0], coVertexInterData["d"][0]);
+                // ShareVecVec debugD = sci::plaintext_add_matrix(acts.tensor(coForwardLayer, ActivationKind::D), coActs.tensor(coForwardLayer, ActivationKind::D));
 #ifdef GCN_LOG
                 // printf(">>>>> Apply Comp added d: party id %d role %d\n", tileIndex, party);
                 // sci::printShareVecVec(debugD, dstTid, party);
@@ -813,32 +929,185 @@ protected:
     void writeApplyTaskVecResult(GraphSummary& gs, uint64_t iter, const std::vector<Task>& taskVec, std::vector<ShareVec>& dstVec, bool isClient) const {
     }
 
+    void onExecutionPlanBuild(GraphSummary& gs) const {
+        TaskComm& clientTaskComm = TaskComm::getClientInstance();
+        size_t tileNum = clientTaskComm.getTileNum();
+        size_t tileIndex = clientTaskComm.getTileIndex();
+
+        size_t length = gs.localVertexInDeg.size();
+        gs.plan.localNormalizer.resize(length);
+        gs.plan.localSquaredNormalizer.resize(length);
+        GraphGASLite::parallel_for(0, length, GraphGASLite::VERTEX_LOOP_GRAIN, [&gs](uint64_t begin, uint64_t end) {
+            for (uint64_t i = begin; i < end; ++i) {
+                gs.plan.localNormalizer[i] = gs.localVertexInDeg[i] == 0 ? 0 : CryptoUtil::encodeDoubleAsFixedPoint(pow((double)gs.localVertexInDeg[i] + 1, -0.5));
+                gs.plan.localSquaredNormalizer[i] = gs.localVertexInDeg[i] == 0 ? 0 : CryptoUtil::encodeDoubleAsFixedPoint(1.0 / ((double)gs.localVertexInDeg[i] + 1));
+            }
+        });
+
+        if (gs.localFeatureCsr.rowCount() != 0) {
+            // Plaintext sparse input: scatter the nonzeros straight into X^T.
+            gs.localFeatureCsr.transposeEncode(gs.plan.localPlainInputT);
+        } else if (gs.isOneSidedInput) {
+            gs.plan.localPlainInputT = transpose(gs.localPlainInput);
+        }
+        gs.plan.localInputT = transpose(gs.localInputSvv);
+        gs.plan.remoteInputT = transpose(gs.remoteInputSvv);
+
+        GNNParam& gnnParam = GNNParam::getGNNParam();
+        if (!gnnParam.activation_spill_dir.empty()) {
+            std::string prefix = gnnParam.activation_spill_dir + "/cognn_act_" + std::to_string(tileIndex);
+            gs.localActivations.spillFileIs(prefix + "_local.bin");
+            gs.remoteActivations.spillFileIs(prefix + "_remote.bin");
+        }
+    }
+
+    std::vector<GraphGASLite::MatMulShape> getIterMatMulShapes(GraphSummary& gs, uint64_t iter) const {
+        uint32_t epochLayerNum = getEpochLayerNum();
+        uint32_t forwardLayerNum = getForwardLayerNum();
+        uint64_t step = iter % epochLayerNum;
+        uint64_t n = gs.localVertexVec.size();
+        uint32_t layer = (step < forwardLayerNum)? step : forwardLayerNum - 1 - ((step - forwardLayerNum) / 2);
+        const bool isInput = (layer == 0 && gs.isOneSidedInput);
+        uint64_t in = gs.localWeight[layer].size();
+        uint64_t out = gs.localWeight[layer].empty()? 0 : gs.localWeight[layer][0].size();
+        // H * W forward, then G * W^T at the top layer and H^T * G for every layer backward.
+        if (step < forwardLayerNum) {
+            return {{n, in, out, isInput? GraphGASLite::MatMulOperand::Input : GraphGASLite::MatMulOperand::Shared}};
+        }
+        bool isFirstOfTwo = ((step - forwardLayerNum) % 2 == 0);
+        if (!isFirstOfTwo) {
+            return {{in, n, out, isInput? GraphGASLite::MatMulOperand::InputT : GraphGASLite::MatMulOperand::Shared}};
+        }
+        if (layer == forwardLayerNum - 1) return {{n, out, in}};
+        return std::vector<GraphGASLite::MatMulShape>();
+    }
+
+    bool getOneSidedVertexDataVector(GraphSummary& gs, ShareVecVec& vertexSvv) const {
+        GNNParam& gnnParam = GNNParam::getGNNParam();
+        if (!gnnParam.plain_input_layer) return false;
+        vertexSvv.resize(gs.localVertexVec.size());
+        if (gnnParam.sparse_feature) {
+            // Move the per-vertex rows into one CSR matrix in local vertex order.
+            gs.localFeatureCsr.clear();
+            gs.localFeatureCsr.dimIs(gnnParam.input_dim);
+            for (uint64_t i=0; i<gs.localVertexVec.size(); ++i) {
+                auto& data = gs.localVertexVec[i]->data();
+                gs.localFeatureCsr.rowNew(data.featureIdx, data.featureVal);
+                data.featureDel();
+                gs.localFeatureCsr.rowEncode(i, vertexSvv[i]);
+            }
+            return true;
+        }
+        for (uint64_t i=0; i<gs.localVertexVec.size(); ++i) {
+            gs.localVertexVec[i]->data().intoPlainShareVec(vertexSvv[i]);
+        }
+        return true;
+    }
+
+    bool getSeededVertexDataVectorShare(GraphSummary& gs, ShareVecVec& vertexSvv, GraphGASLite::SeedShareMsg& msg) const {
+        GNNParam& gnnParam = GNNParam::getGNNParam();
+        const uint64_t rows = gs.localVertexVec.size();
+        msg = GraphGASLite::newSeedShareMsg(rows, gnnParam.input_dim);
+        vertexSvv.resize(rows);
+        // Encode, subtract the co-party's share and drop the plaintext row by row.
+        GraphGASLite::forEachSeedShareBlock(msg, [&gs, &vertexSvv](osuCrypto::PRNG& prng, uint64_t begin, uint64_t end) {
+            ShareVec r;
+            for (uint64_t i = begin; i < end; ++i) {
+                auto& data = gs.localVertexVec[i]->data();
+                ShareVec& sv = vertexSvv[i];
+                data.intoPlainShareVec(sv);
+                data.featureDel();
+                r.resize(sv.size());
+                prng.get(r.data(), r.size());
+                for (size_t j = 0; j < sv.size(); ++j) sv[j] -= r[j];
+            }
+        });
+        return true;
+    }
+
     void onAlgoKernelStart(Ptr<GraphTileType>& graph) const {
     }
 
-    static std::vector<double> normalizeFeatureVec(const std::vector<double>& raw, double inDeg) {
-        // Compute the sum of the features of the node
-        double sum = 0.0;
-        size_t n_features = raw.size();
-        for (int j = 0; j < n_features; j++) {
-            sum += raw[j];
+    // Report the configured metrics of the prediction p, the client prints them.
+    // With several models p holds them stacked row-wise, all are evaluated at once.
+    void evaluate(GraphSummary& gs, const ShareTensor& p, uint64_t trainSetSize, uint64_t valSetSize, uint64_t dstTid, int party) const {
+        GNNParam& gnnParam = GNNParam::getGNNParam();
+        uint32_t metrics = GraphGASLite::evalMetricsOf(gnnParam.eval_metrics);
+        bool isClient = (party == sci::ALICE);
+        uint32_t modelNum = getModelNum();
+        uint64_t vecSize = p.size() / modelNum;
+        auto modelPrefix = [modelNum](uint32_t m) {
+            return (modelNum > 1)? "model " + std::to_string(m) + " " : std::string();
+        };
+
+        if (metrics & GraphGASLite::EVAL_LOSS) {
+            // The loss needs the probabilities themselves.
+            DoubleTensor plainP;
+            sci::getPlainShareVecVec(p, plainP, dstTid, party);
+            if (isClient) {
+                DoubleTensor y(vecSize, std::vector<double>(gnnParam.num_labels, 0.0));
+                for (int i=0; i<vecSize; ++i) y[i][gs.localVertexVec[i]->data().label] = 1.0;
+                for (auto& row : plainP) {
+                    for (int j=0; j<gnnParam.num_labels; ++j) {
+                        if (row[j] == 0) row[j] = 0.001;
+                    }
+                }
+                for (uint32_t m=0; m<modelNum; ++m) {
+                    DoubleTensor modelP(plainP.begin() + m * vecSize, plainP.begin() + (m + 1) * vecSize);
+                    printf("%scross-entropy-loss = %lf\n", modelPrefix(m).c_str(), sci::cross_entropy_loss(y, modelP));
+                }
+            }
+        }
+
+        if (metrics & (GraphGASLite::EVAL_ACCURACY | GraphGASLite::EVAL_BORDER_ACCURACY)) {
+            // Only the correct counts of the full, training and test sets are revealed.
+            bool withBorder = (metrics & GraphGASLite::EVAL_BORDER_ACCURACY);
+            std::vector<std::pair<uint64_t, uint64_t>> setRanges = {{0, vecSize}, {0, trainSetSize}, {trainSetSize + valSetSize, vecSize}};
+            std::vector<std::pair<uint64_t, uint64_t>> ranges;
+            for (uint32_t m=0; m<modelNum; ++m) {
+                for (const auto& range : setRanges) ranges.push_back({m * vecSize + range.first, m * vecSize + range.second});
+            }
+            std::vector<uint64_t> labels;
+            std::vector<bool> isBorder;
+            if (isClient) {
+                for (int i=0; i<modelNum*vecSize; ++i) labels.push_back(gs.localVertexVec[i % vecSize]->data().label);
+                for (uint32_t m=0; m<modelNum; ++m) isBorder.insert(isBorder.end(), gs.isLocalVertexBorder.begin(), gs.isLocalVertexBorder.end());
+            }
+            ShareTensor oneHot;
+            GraphGASLite::twoPartySecureArgmax(p, oneHot, dstTid, party);
+            ShareVecVec counts;
+            GraphGASLite::twoPartyCorrectCounts(oneHot, labels, isBorder, ranges, withBorder, counts, dstTid, party);
+            DoubleTensor plainCounts;
+            sci::getPlainShareVecVec(counts, plainCounts, dstTid, party);
+            if (isClient) {
+                const char* names[] = {"full set", "training set", "test set"};
+                for (size_t r=0; r<ranges.size(); ++r) {
+                    const std::string name = modelPrefix(r / setRanges.size()) + names[r % setRanges.size()];
+                    uint64_t size = ranges[r].second - ranges[r].first;
+                    printf("%s accuracy = %lf\n", name.c_str(), size == 0? 0 : plainCounts[0][r] / size);
+                    if (!withBorder) continue;
+                    uint64_t borderSize = std::count(isBorder.begin() + ranges[r].first, isBorder.begin() + ranges[r].second, true);
+                    printf("border %s accuracy = %lf\n", name.c_str(), borderSize == 0? 0 : plainCounts[0][ranges.size() + r] / borderSize);
+                }
+                printf("the number of vertices is %lu, the number of border vertices is %lu\n", vecSize, sci::count_true(gs.isLocalVertexBorder));
+            }
         }
-        if (sum == 0.0) sum = 1.0;
-        // Normalize the features by dividing by the sum
-        std::vector<double> normalized(n_features, 0.0);
-        for (int j = 0; j < n_features; j++) {
-            // normalized[j] = raw[j] / sum;
-            normalized[j] = raw[j];
-            normalized[j] *= pow(inDeg + 1.0, -0.5);
-        }      
-        return normalized;  
+    }
+
+    // Update the concatenated weights of several models, each with its own learning rate
+    void applyModelGradients(GraphSummary& gs, ShareTensor& weight, ShareTensor& d, double gradientScaler, uint32_t layer, uint64_t dstTid, int party) const {
+        uint32_t modelNum = getModelNum();
+        // The cross-model blocks of the upper layer gradients are not gradients of any model.
+        if (layer != 0) GraphGASLite::maskModelBlocks(d, modelNum);
+
+        GraphGASLite::twoPartyGradientStep(weight, d, gradientScaler, gs.modelLearningRates, dstTid, party);
     }
 
     // GCN weight initialization function using the Glorot method
-    static std::vector<std::vector<double>> initWeight(int dim0, int dim1) {
+    static std::vector<std::vector<double>> initWeight(int dim0, int dim1, unsigned seed = 42) {
         std::vector<std::vector<double>> W(dim0, std::vector<double>(dim1, 0.0));
 
-        std::srand(42);
+        std::srand(seed);
 
         double limit = std::sqrt(6.0 / (dim0 + dim1));
 
@@ -854,35 +1123,42 @@ protected:
     void onAlgoKernelStart(Ptr<GraphTileType>& graph, GraphSummary& gs) const {
         GNNParam& gnnParam = GNNParam::getGNNParam();
         // Feature normalization
-        for (auto vIter = graph->vertexIter(); vIter != graph->vertexIterEnd(); ++vIter) {
-            auto v = vIter->second;
-            auto& data = v->data();
-            double inDeg = (double)(v->inDeg().cnt());
-            data.feature = normalizeFeatureVec(data.feature, inDeg);
-        }
+        std::vector<Ptr<VertexType>> vertices;
+        for (auto vIter = graph->vertexIter(); vIter != graph->vertexIterEnd(); ++vIter) vertices.push_back(vIter->second);
+        GraphGASLite::parallel_for(0, vertices.size(), GraphGASLite::VERTEX_LOOP_GRAIN, [&vertices](uint64_t begin, uint64_t end) {
+            for (uint64_t i = begin; i < end; ++i) {
+                auto& data = vertices[i]->data();
+                double inDeg = (double)(vertices[i]->inDeg().cnt());
+                // Scale in place, one pow per vertex.
+                double scaler = pow(inDeg + 1.0, -0.5);
+                for (auto& x : data.featureVal) x *= scaler;
+                for (auto& x : data.feature) x *= scaler;
+            }
+        });
 
         // Initilize weight matrix
         gs.plainWeight.resize(gnnParam.num_layers);
-        // gs.plainWeight[0].resize(gnnParam.input_dim);
-        // for (int i=0; i<gs.plainWeight[0].size(); ++i) {
-        //     gs.plainWeight[0][i].resize(gnnParam.hidden_dim, 0.5);
-        // }
-        // gs.plainWeight[1].resize(gnnParam.hidden_dim);
-        // for (int i=0; i<gs.plainWeight[1].size(); ++i) {
-        //     gs.plainWeight[1][i].resize(gnnParam.num_labels, 0.5);
-        // }
-        gs.plainWeight[0] = initWeight(gnnParam.input_dim, gnnParam.hidden_dim);
-        gs.plainWeight[1] = initWeight(gnnParam.hidden_dim, gnnParam.num_labels);
+        std::vector<uint32_t> dims = gnnParam.getLayerDims();
+        uint32_t modelNum = getModelNum();
+        for (int layer = 0; layer < gnnParam.num_layers; ++layer) {
+            if (modelNum == 1) {
+                gs.plainWeight[layer] = initWeight(dims[layer], dims[layer + 1]);
+                continue;
+            }
+            // Every model starts from its own initialization.
+            std::vector<DoubleTensor> models;
+            for (uint32_t m = 0; m < modelNum; ++m) models.push_back(initWeight(dims[layer], dims[layer + 1], 42 + m));
+            gs.plainWeight[layer] = GraphGASLite::concatModelWeights(models, layer != 0);
+        }
 
         gs.localWeight.resize(gnnParam.num_layers);
         gs.remoteWeight.resize(gnnParam.num_layers);
-        // printf("H1\n");
-        intoShareTensor(gs.plainWeight[0], gs.localWeight[0], gs.remoteWeight[0]);
-        // printf("H2\n");
-        intoShareTensor(gs.plainWeight[1], gs.localWeight[1], gs.remoteWeight[1]);
-        // printf("H3\n");
+        for (int layer = 0; layer < gnnParam.num_layers; ++layer) {
+            intoShareTensor(gs.plainWeight[layer], gs.localWeight[layer], gs.remoteWeight[layer]);
+        }
 
         gs.learningRate = gnnParam.learning_rate;
+        gs.modelLearningRates = GraphGASLite::modelLearningRatesOf(gnnParam.model_learning_rates, gnnParam.learning_rate, modelNum);
         gs.globalNumSamples = gnnParam.num_samples;
     }
 
@@ -892,38 +1168,18 @@ protected:
 
     uint32_t getPlainNumPerOperand() const {
         GNNParam& gnnParam = GNNParam::getGNNParam();
-        return std::max(gnnParam.input_dim, gnnParam.hidden_dim); // Fix me
+        std::vector<uint32_t> dims = gnnParam.getLayerDims();
+        return std::max(dims[0], getModelNum() * *std::max_element(dims.begin() + 1, dims.end()));
     }
 
+    // The vertex data of all models side by side, as wide as the output of the
+    // layer of the step, forward and backward.
     uint32_t getPlainNumPerOperand(uint64_t layer) const {
         GNNParam& gnnParam = GNNParam::getGNNParam();
-        layer = layer % ((1 + 2)*gnnParam.num_layers);
-        uint32_t ret = 0;
-        switch (layer) {
-            case 0:
-                ret = gnnParam.hidden_dim;
-                break;
-            case 1:
-                ret = gnnParam.num_labels;
-                break;
-            case 2:
-                ret = gnnParam.num_labels;
-                break;
-            case 3:
-                ret = gnnParam.num_labels;
-                break;
-            case 4:
-                ret = gnnParam.hidden_dim;
-                break;
-            case 5:
-                ret = gnnParam.hidden_dim;
-                break;
-            default:
-                printf("Illegal layer in getPlainNumPerOperand\n");
-                exit(-1);                
-        }
-
-        return ret;
+        uint32_t forwardLayerNum = getForwardLayerNum();
+        uint64_t step = layer % getEpochLayerNum();
+        uint32_t coForwardLayer = (step < forwardLayerNum)? step : forwardLayerNum - 1 - ((step - forwardLayerNum) / 2);
+        return getModelNum() * gnnParam.getLayerDims()[coForwardLayer + 1];
     }
 
     uint32_t getForwardLayerNum() const {
@@ -941,12 +1197,57 @@ protected:
         return 3 * gnnParam.num_layers;
     }
 
+    /**
+     * The normalizer of the one vector scale around the aggregation of iter.
+     *
+     * A layer computes relu(N A relu(...) W N) with N the in-degree normalizer on
+     * both sides of the aggregation A. As ReLU and the matmul commute with a
+     * positive row scale, the source N of layer l + 1 is applied with the
+     * destination N of layer l as N^2, the same way the input features carry the
+     * source N of layer 0 from loading. The forward pass then scales once after
+     * each aggregation, by N for the last layer and N^2 otherwise, and the stored
+     * layer inputs and ReLU inputs are the row-scaled ones. The backward pass
+     * reverses an aggregation with the same single scale before it: the gradient
+     * of a weight is the stored input times A^T (s dZ), with s the forward scale
+     * of its layer, and the gradient passed down is A^T (s dZ W^T). The server
+     * passes zeros, as only the client's normalizer enters the scale.
+     */
+    std::vector<uint64_t>* getAggregationNormalizer(GraphSummary& gs, uint64_t iter, size_t length, int party) const {
+        uint32_t epochLayerNum = getEpochLayerNum();
+        uint32_t forwardLayerNum = getForwardLayerNum();
+        uint32_t layerIndex = iter % epochLayerNum;
+        // The forward layer whose aggregation is run or reversed. The first of the two
+        // backward iterations of a layer passes down the gradient of the layer above.
+        uint32_t aggregationLayer = layerIndex;
+        if (layerIndex >= forwardLayerNum) {
+            uint32_t backwardIndex = layerIndex - forwardLayerNum;
+            aggregationLayer = forwardLayerNum - 1 - backwardIndex / 2 + ((backwardIndex % 2 == 0)? 1 : 0);
+        }
+        if (party != sci::ALICE) return &gs.plan.zeroVec(length);
+        return (aggregationLayer + 1 < forwardLayerNum)? &gs.plan.localSquaredNormalizer : &gs.plan.localNormalizer;
+    }
+
     std::vector<uint32_t> getDimensionVec() const {
         GNNParam& gnnParam = GNNParam::getGNNParam();
-        std::vector<uint32_t> dimensions = {gnnParam.hidden_dim, gnnParam.num_labels, 0, gnnParam.num_labels, gnnParam.hidden_dim, gnnParam.hidden_dim};
+        uint32_t modelNum = getModelNum();
+        uint32_t forwardLayerNum = getForwardLayerNum();
+        std::vector<uint32_t> dims = gnnParam.getLayerDims();
+        // The output width of the layer of every step, but for the first backward
+        // step of the top layer, which scatters nothing.
+        std::vector<uint32_t> dimensions(getEpochLayerNum());
+        for (uint32_t step = 0; step < dimensions.size(); ++step) {
+            uint32_t coForwardLayer = (step < forwardLayerNum)? step : forwardLayerNum - 1 - ((step - forwardLayerNum) / 2);
+            bool isTopFirstOfTwo = (step == forwardLayerNum);
+            dimensions[step] = isTopFirstOfTwo? 0 : modelNum * dims[coForwardLayer + 1];
+        }
         return dimensions;
     }
 
+    uint32_t getModelNum() const {
+        GNNParam& gnnParam = GNNParam::getGNNParam();
+        return std::max(gnnParam.num_models, 1);
+    }
+
 protected:
     GCNEdgeCentricAlgoKernel(const string& name, const GraphGASLite::VertexIdx& src)
         : GraphGASLite::SSEdgeCentricAlgoKernel<GraphTileType>(name),
@@ -36,11 +36,29 @@ private:
 
 void readVertexDataLine(std::istringstream& iss, GCNData& data) {
     GNNParam& gnnParam = GNNParam::getGNNParam();
-    data.feature.resize(gnnParam.input_dim);
-    for (int i=0; i<gnnParam.input_dim; ++i) {
-        iss >> data.feature[i];
+    // Convert with strtod rather than operator>>, straight into the final storage.
+    string rest;
+    std::getline(iss, rest);
+    const char* pbegin = rest.c_str();
+    char* pend = nullptr;
+    data.featureIdx.clear();
+    data.featureVal.clear();
+    if (!gnnParam.sparse_feature) data.feature.resize(gnnParam.input_dim);
+    for (uint32_t i=0; i<gnnParam.input_dim; ++i) {
+        double x = strtod(pbegin, &pend);
+        if (pend == pbegin) {
+            throw FileException("Truncated vertex data line");
+        }
+        if (!gnnParam.sparse_feature) {
+            data.feature[i] = x;
+        } else if (x != 0.0) {
+            // Keep only the nonzeros.
+            data.featureIdx.push_back(i);
+            data.featureVal.push_back(x);
+        }
+        pbegin = pend;
     }
-    iss >> data.label;
+    data.label = strtol(pbegin, &pend, 10);
 }
 
 #endif // KERNEL_HARNESS_H_
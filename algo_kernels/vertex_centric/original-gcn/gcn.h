@@ -167,7 +167,8 @@ protected:
     typedef typename GraphTileType::VertexType VertexType;
     typedef typename GraphTileType::EdgeType::WeightType EdgeWeightType;
     typedef typename GraphGASLite::SSEdgeCentricAlgoKernel<GraphTileType>::GraphSummary GraphSummary; 
-    typedef typename GraphGASLite::SSEdgeCentricAlgoKernel<GraphTileType>::TensorVecMap TensorVecMap; 
+    typedef GraphGASLite::ActivationStore ActivationStore;
+    typedef GraphGASLite::ActivationKind ActivationKind;
 
     std::pair<UpdateType, bool> scatter(const GraphGASLite::IterCount& iter, Ptr<VertexType>& src, EdgeWeightType& weight) const {
         return std::make_pair(GCNUpdate(), false);
@@ -321,6 +322,7 @@ protected:
     }
 
     void GatherComp(
+        GraphSummary& gs,
         ShareVecVec& vertexSvv, 
         ShareVecVec& updateSvv, 
         std::vector<bool>& isGatherDstVertexDummy, 
@@ -448,12 +450,11 @@ protected:
 
         if (isForward) { // FORWARD
             const ShareTensor& weight = isClient? gs.localWeight[coForwardLayer]:gs.remoteWeight[coForwardLayer];
-            TensorVecMap& vertexInterData = isClient? gs.localVertexInterDataTVs[coForwardLayer]:gs.remoteVertexInterDataTVs[coForwardLayer];
-            vertexInterData["ah_t"] = {transpose(vertexDataVec)};
+            ActivationStore& acts = isClient? gs.localActivations : gs.remoteActivations;
+            acts.tensor(coForwardLayer, ActivationKind::HT) = transpose(vertexDataVec);
 
             // printf("H1.2\n");
             if (iter % epochLayerNum != forwardLayerNum - 1) { // GCN_FORWARD_NN
-                vertexInterData["z"] = std::vector<ShareTensor>(1);
                 ShareTensor z;
                 ShareTensor new_h;
                 sci::twoPartyGCNForwardNN(vertexDataVec, weight, normalizer, z, new_h, dstTid, party);
@@ -468,7 +469,7 @@ protected:
                 printf("<<<<< Apply Comp forward, input, weight, z: party id %d role %d\n", 1 - dstTid, party);
 #endif
 
-                vertexInterData["z"][0].swap(z);
+                acts.tensor(coForwardLayer, ActivationKind::Z).swap(z);
                 dstVec.swap(new_h);
             } else { // GCN_FORWARD_PREDICTION
                 uint64_t trainSetSize = (uint64_t)(vecSize * gnnParam.train_ratio);
@@ -479,8 +480,6 @@ protected:
                 printf(">> valSetSize %lu\n", valSetSize);
                 printf(">> testSetSize %lu\n", testSetSize);
 #endif
-                vertexInterData["z"] = std::vector<ShareTensor>(1);
-                vertexInterData["p"] = std::vector<ShareTensor>(1);
                 ShareTensor z;
                 ShareTensor p;
                 ShareTensor p_minus_y;
@@ -552,8 +551,8 @@ protected:
                     // printf("<<<<< Apply Comp prediction, y, loss, accuracy: party id %d role %d\n", 1 - dstTid, party);
                 }
 
-                vertexInterData["z"][0].swap(z);
-                vertexInterData["p"][0].swap(p);
+                acts.tensor(coForwardLayer, ActivationKind::Z).swap(z);
+                acts.tensor(coForwardLayer, ActivationKind::P).swap(p);
                 // Preserve the gradients of training set only
                 // printf("trainSetSize %lu, vecSize %lu\n", trainSetSize, vecSize);
                 for (int i=trainSetSize; i<vecSize; ++i) {
@@ -566,10 +565,9 @@ protected:
             ShareTensor& weightRef = isClient? gs.localWeight[coForwardLayer]:gs.remoteWeight[coForwardLayer];
             ShareTensor& coWeightRef = isClient? gs.remoteWeight[coForwardLayer]:gs.localWeight[coForwardLayer];
             weightT = transpose(weightT);
-            TensorVecMap& vertexInterData = isClient? gs.localVertexInterDataTVs[coForwardLayer]:gs.remoteVertexInterDataTVs[coForwardLayer];
-            TensorVecMap& coVertexInterData = isClient? gs.remoteVertexInterDataTVs[coForwardLayer]:gs.localVertexInterDataTVs[coForwardLayer];
+            ActivationStore& acts = isClient? gs.localActivations : gs.remoteActivations;
+            ActivationStore& coActs = isClient? gs.remoteActivations : gs.localActivations;
             if (coForwardLayer == forwardLayerNum - 1) { // GCN_BACKWARD_NN_INIT
-                vertexInterData["d"] = std::vector<ShareTensor>(1);
                 ShareTensor d;
                 ShareTensor g;
 #ifdef GCN_LOG
@@ -577,13 +575,13 @@ protected:
                 sci::printShareVecVec(vertexDataVec, dstTid, party);
                 printf("<<<<< Apply Comp p_minus_y: party id %d role %d\n", 1 - dstTid, party);
                 printf(">>>>> Apply Comp ah_t: party id %d role %d\n", 1 - dstTid, party);
-                sci::printShareVecVec(vertexInterData["ah_t"][0], dstTid, party);
+                sci::printShareVecVec(acts.tensor(coForwardLayer, ActivationKind::HT), dstTid, party);
                 printf("<<<<< Apply Comp ah_t: party id %d role %d\n", 1 - dstTid, party);
                 printf(">>>>> Apply Comp weight_t: party id %d role %d\n", 1 - dstTid, party);
                 sci::printShareVecVec(weightT, dstTid, party);
                 printf("<<<<< Apply Comp weight_t: party id %d role %d\n", 1 - dstTid, party);
 #endif
-                sci::twoPartyGCNBackwardNNInit(vertexDataVec, vertexInterData["ah_t"][0], weightT, normalizer, d, g, dstTid, party);
+                sci::twoPartyGCNBackwardNNInit(vertexDataVec, acts.tensor(coForwardLayer, ActivationKind::HT), weightT, normalizer, d, g, dstTid, party);
 
                 uint64_t trainSetSize = (uint64_t)(vecSize * gnnParam.train_ratio);
                 double gradientScaler = (double) 1 / trainSetSize;
@@ -595,15 +593,14 @@ protected:
                 // double weightScaler = (double) 1 / tileNum;
                 // sci::twoPartyGCNMatrixScale(weightRef, static_cast<uint64_t>(weightScaler * (1<<SCALER_BIT_LENGTH)), weightRef, dstTid, party);
 
-                vertexInterData["d"][0].swap(d);
+                acts.tensor(coForwardLayer, ActivationKind::D).swap(d);
                 dstVec.swap(g);
 #ifdef GCN_LOG
                 printf(">>>>> Apply Comp d: party id %d role %d\n", 1 - dstTid, party);
-                sci::printShareVecVec(vertexInterData["d"][0], dstTid, party);
+                sci::printShareVecVec(acts.tensor(coForwardLayer, ActivationKind::D), dstTid, party);
                 printf("<<<<< Apply Comp d: party id %d role %d\n", 1 - dstTid, party);
 #endif
             } else { // GCN_BACKWARD_NN
-                vertexInterData["d"] = std::vector<ShareTensor>(1);
                 ShareTensor d;
                 ShareTensor g;
 #ifdef GCN_LOG
@@ -611,7 +608,7 @@ protected:
                 sci::printShareVecVec(vertexDataVec, dstTid, party);
                 printf("<<<<< Apply Comp p_minus_y: party id %d role %d\n", 1 - dstTid, party);
                 printf(">>>>> Apply Comp ah_t: party id %d role %d\n", 1 - dstTid, party);
-                sci::printShareVecVec(vertexInterData["ah_t"][0], dstTid, party);
+                sci::printShareVecVec(acts.tensor(coForwardLayer, ActivationKind::HT), dstTid, party);
                 printf("<<<<< Apply Comp ah_t: party id %d role %d\n", 1 - dstTid, party);
                 printf(">>>>> Apply Comp weight_t: party id %d role %d\n", 1 - dstTid, party);
                 sci::printShareVecVec(weightT, dstTid, party);
@@ -619,7 +616,7 @@ protected:
 #endif
                 bool isFirstLayer = false;
                 if (coForwardLayer == 0) isFirstLayer = true; 
-                sci::twoPartyGCNBackwardNN(vertexDataVec, vertexInterData["ah_t"][0], vertexInterData["z"][0], weightT, normalizer, d, g, isFirstLayer, dstTid, party);
+                sci::twoPartyGCNBackwardNN(vertexDataVec, acts.tensor(coForwardLayer, ActivationKind::HT), acts.tensor(coForwardLayer, ActivationKind::Z), weightT, normalizer, d, g, isFirstLayer, dstTid, party);
 #ifdef GCN_LOG
                 printf(">>>>> Apply Comp d: party id %d role %d\n", 1 - dstTid, party);
                 sci::printShareVecVec(d, dstTid, party);
@@ -644,11 +641,11 @@ protected:
                 // double weightScaler = (double) 1 / tileNum;
                 // sci::twoPartyGCNMatrixScale(weightRef, static_cast<uint64_t>(weightScaler * (1<<SCALER_BIT_LENGTH)), weightRef, dstTid, party);
 
-                vertexInterData["d"][0].swap(d);
+                acts.tensor(coForwardLayer, ActivationKind::D).swap(d);
                 dstVec.swap(g);
 
 #ifdef GCN_LOG
-                sci::printShareVecVec(vertexInterData["d"][0], dstTid, party);
+                sci::printShareVecVec(acts.tensor(coForwardLayer, ActivationKind::D), dstTid, party);
                 printf("---------\n");
                 sci::printShareVecVec(weightRef, dstTid, party);
                 printf("---------\n");
@@ -669,7 +666,7 @@ protected:
                             sci::plaintext_add_matrix_in_place(weightRef, weightFromTheOtherParties[i]);
                         }
                     }
-                    debugD = sci::plaintext_add_matrix(vertexInterData["d"][0], coVertexInterData["d"][0]);
+                    debugD = sci::plaintext_add_matrix(acts.tensor(coForwardLayer, ActivationKind::D), coActs.tensor(coForwardLayer, ActivationKind::D));
                     sci::plaintext_add_matrix_in_place(weightRef, coWeightRef);
 
                     double weightScaler = (double) 1 / tileNum;
@@ -699,7 +696,7 @@ protected:
             } else {
                 remote_weight_ready_smp.release();
                 weight_avg_finished_smp.acquire();
-                ShareVecVec debugD = sci::plaintext_add_matrix(vertexInterData["d"][0], coVertexInterData["d"][0]);
+                ShareVecVec debugD = sci::plaintext_add_matrix(acts.tensor(coForwardLayer, ActivationKind::D), coActs.tensor(coForwardLayer, ActivationKind::D));
 #ifdef GCN_LOG
                 printf(">>>>> Apply Comp added d: party id %d role %d\n", 1 - dstTid, party);
                 sci::printShareVecVec(debugD, dstTid, party);
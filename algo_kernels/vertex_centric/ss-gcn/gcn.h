@@ -167,7 +167,8 @@ protected:
     typedef typename GraphTileType::VertexType VertexType;
     typedef typename GraphTileType::EdgeType::WeightType EdgeWeightType;
     typedef typename GraphGASLite::SSEdgeCentricAlgoKernel<GraphTileType>::GraphSummary GraphSummary; 
-    typedef typename GraphGASLite::SSEdgeCentricAlgoKernel<GraphTileType>::TensorVecMap TensorVecMap; 
+    typedef GraphGASLite::ActivationStore ActivationStore;
+    typedef GraphGASLite::ActivationKind ActivationKind;
 
     std::pair<UpdateType, bool> scatter(const GraphGASLite::IterCount& iter, Ptr<VertexType>& src, EdgeWeightType& weight) const {
         return std::make_pair(GCNUpdate(), false);
@@ -279,7 +280,8 @@ protected:
         //     coTid, 
         //     party
         // );
-        duplicatedUpdateSvv = updateSrcSvv;
+        // The update source is not read after scatter, hand over its buffer.
+        duplicatedUpdateSvv.swap(updateSrcSvv);
 
 #ifdef GCN_LOG
         printf(">>>>> Scatter Comp duplicatedUpdateSvv: party id %d role %d\n", 1 - coTid, party);
@@ -352,6 +354,7 @@ protected:
     }
 
     void GatherComp(
+        GraphSummary& gs,
         ShareVecVec& vertexSvv, 
         ShareVecVec& updateSvv, 
         std::vector<bool>& isGatherDstVertexDummy, 
@@ -480,69 +483,6 @@ protected:
         GNNParam& gnnParam = GNNParam::getGNNParam();
         uint64_t vecSize = vertexDataVec.size();
         std::vector<Task> taskVec;
-        // printf("H1.0\n");
-        // printf("H1.1\n");
-        if ((iter / gnnParam.num_layers) % 2 == 0) { // FORWARD
-            ShareTensor weight = isClient? gs.localWeight[iter%gnnParam.num_layers]:gs.remoteWeight[iter%gnnParam.num_layers];
-            TensorVecMap& vertexInterData = isClient? gs.localVertexInterDataTVs[iter%gnnParam.num_layers]:gs.remoteVertexInterDataTVs[iter%gnnParam.num_layers];
-            vertexInterData["ah"] = std::vector<ShareTensor>();
-            for (int i=0; i<vecSize; ++i) {
-                vertexInterData["ah"].push_back(toShareTensor(vertexDataVec[i]));
-            }
-            // printf("H1.2\n");
-            if (iter % gnnParam.num_layers != gnnParam.num_layers - 1) { // GCN_FORWARD_NN
-                for (int i=0; i<vecSize; ++i) {
-                    GCNForwardNN* gfn = new GCNForwardNN();
-                    gfn->writeShareToOperand(vertexDataVec[i], weight);
-                    // printf("H1.3\n");
-                    gfn->useMask = false;
-                    Task task = {GCN_FORWARD_NN, static_cast<uint64_t>(-1), false, (void*)gfn, static_cast<uint64_t>(-1), dstTid, dstTid};
-                    task.isDummy = isDummy;
-                    taskVec.push_back(task);
-                }
-            } else { // GCN_FORWARD_PREDICTION
-                for (int i=0; i<vecSize; ++i) {
-                    // printf("H1.4\n");
-                    GCNForwardNNPrediction* gfnp = new GCNForwardNNPrediction();
-                    if (isClient) {
-                        gfnp->writeShareToOperand(vertexDataVec[i], weight, toShareVec(gs.localVertexVec[i]->data().label, gnnParam.num_labels));
-                    } else {
-                        ShareVec zero_sv;
-                        zero_sv.resize(gnnParam.num_labels, 0);
-                        gfnp->writeShareToOperand(vertexDataVec[i], weight, zero_sv);
-                    }
-                    gfnp->useMask = false;
-                    Task task = {GCN_FORWARD_NN_PREDICTION, static_cast<uint64_t>(-1), false, (void*)gfnp, static_cast<uint64_t>(-1), dstTid, dstTid};
-                    task.isDummy = isDummy;
-                    taskVec.push_back(task);
-                }                
-            }
-        } else { // BACKWARD
-            ShareTensor weight = isClient? gs.localWeight[(gnnParam.num_layers-1)-iter%gnnParam.num_layers]:gs.remoteWeight[(gnnParam.num_layers-1)-iter%gnnParam.num_layers];
-            weight = transpose(weight);
-            TensorVecMap& vertexInterData = isClient? gs.localVertexInterDataTVs[(gnnParam.num_layers-1)-iter%gnnParam.num_layers]:gs.remoteVertexInterDataTVs[(gnnParam.num_layers-1)-iter%gnnParam.num_layers];
-            if (iter % gnnParam.num_layers == 0) { // GCN_BACKWARD_NN_INIT
-                for (int i=0; i<vecSize; ++i) {
-                    // printf("H1.5\n");
-                    GCNBackwardNNInit* gbni = new GCNBackwardNNInit();
-                    gbni->writeShareToOperand(vertexDataVec[i], toShareVec(vertexInterData["ah"][i]), weight);
-                    gbni->useMask = false;
-                    Task task = {GCN_BACKWARD_NN_INIT, static_cast<uint64_t>(-1), false, (void*)gbni, static_cast<uint64_t>(-1), dstTid, dstTid};
-                    task.isDummy = isDummy;
-                    taskVec.push_back(task);
-                }                
-            } else { // GCN_BACKWARD_NN
-                for (int i=0; i<vecSize; ++i) {
-                    // printf("H1.6\n");
-                    GCNBackwardNN* gbn = new GCNBackwardNN();
-                    gbn->writeShareToOperand(vertexDataVec[i], toShareVec(vertexInterData["ah"][i]), toShareVec(vertexInterData["z"][i]), weight);
-                    gbn->useMask = false;
-                    Task task = {GCN_BACKWARD_NN, static_cast<uint64_t>(-1), false, (void*)gbn, static_cast<uint64_t>(-1), dstTid, dstTid};
-                    task.isDummy = isDummy;
-                    taskVec.push_back(task);
-                }
-            }
-        }
         
         return taskVec;        
     }
@@ -567,12 +507,12 @@ protected:
 
         if ((iter / gnnParam.num_layers) % 2 == 0) { // FORWARD
             ShareTensor weight = isClient? gs.localWeight[iter%gnnParam.num_layers]:gs.remoteWeight[iter%gnnParam.num_layers];
-            TensorVecMap& vertexInterData = isClient? gs.localVertexInterDataTVs[iter%gnnParam.num_layers]:gs.remoteVertexInterDataTVs[iter%gnnParam.num_layers];
-            vertexInterData["ah_t"] = {transpose(vertexDataVec)};
+            ActivationStore& acts = isClient? gs.localActivations : gs.remoteActivations;
+            const uint32_t layer = iter%gnnParam.num_layers;
+            acts.tensor(layer, ActivationKind::HT) = transpose(vertexDataVec);
 
             // printf("H1.2\n");
             if (iter % gnnParam.num_layers != gnnParam.num_layers - 1) { // GCN_FORWARD_NN
-                vertexInterData["z"] = std::vector<ShareTensor>(1);
                 ShareTensor z;
                 ShareTensor new_h;
                 sci::twoPartyGCNForwardNN(vertexDataVec, weight, normalizer, z, new_h, dstTid, party);
@@ -587,7 +527,7 @@ protected:
                 printf("<<<<< Apply Comp forward, input, weight, z: party id %d role %d\n", 1 - dstTid, party);
 #endif
 
-                vertexInterData["z"][0].swap(z);
+                acts.tensor(layer, ActivationKind::Z).swap(z);
                 dstVec.swap(new_h);
             } else { // GCN_FORWARD_PREDICTION
                 uint64_t trainSetSize = (uint64_t)(vecSize * gnnParam.train_ratio);
@@ -598,8 +538,6 @@ protected:
                 printf(">> valSetSize %lu\n", valSetSize);
                 printf(">> testSetSize %lu\n", testSetSize);
 #endif
-                vertexInterData["z"] = std::vector<ShareTensor>(1);
-                vertexInterData["p"] = std::vector<ShareTensor>(1);
                 ShareTensor z;
                 ShareTensor p;
                 ShareTensor p_minus_y;
@@ -671,8 +609,8 @@ protected:
                     // printf("<<<<< Apply Comp prediction, y, loss, accuracy: party id %d role %d\n", 1 - dstTid, party);
                 }
 
-                vertexInterData["z"][0].swap(z);
-                vertexInterData["p"][0].swap(p);
+                acts.tensor(layer, ActivationKind::Z).swap(z);
+                acts.tensor(layer, ActivationKind::P).swap(p);
                 // Preserve the gradients of training set only
                 // printf("trainSetSize %lu, vecSize %lu\n", trainSetSize, vecSize);
                 for (int i=trainSetSize; i<vecSize; ++i) {
@@ -685,10 +623,10 @@ protected:
             ShareTensor& weightRef = isClient? gs.localWeight[(gnnParam.num_layers-1)-iter%gnnParam.num_layers]:gs.remoteWeight[(gnnParam.num_layers-1)-iter%gnnParam.num_layers];
             ShareTensor& coWeightRef = isClient? gs.remoteWeight[(gnnParam.num_layers-1)-iter%gnnParam.num_layers]:gs.localWeight[(gnnParam.num_layers-1)-iter%gnnParam.num_layers];
             weightT = transpose(weightT);
-            TensorVecMap& vertexInterData = isClient? gs.localVertexInterDataTVs[(gnnParam.num_layers-1)-iter%gnnParam.num_layers]:gs.remoteVertexInterDataTVs[(gnnParam.num_layers-1)-iter%gnnParam.num_layers];
-            TensorVecMap& coVertexInterData = isClient? gs.remoteVertexInterDataTVs[(gnnParam.num_layers-1)-iter%gnnParam.num_layers]:gs.localVertexInterDataTVs[(gnnParam.num_layers-1)-iter%gnnParam.num_layers];
+            ActivationStore& acts = isClient? gs.localActivations : gs.remoteActivations;
+            ActivationStore& coActs = isClient? gs.remoteActivations : gs.localActivations;
+            const uint32_t layer = (gnnParam.num_layers-1)-iter%gnnParam.num_layers;
             if (iter % gnnParam.num_layers == 0) { // GCN_BACKWARD_NN_INIT
-                vertexInterData["d"] = std::vector<ShareTensor>(1);
                 ShareTensor d;
                 ShareTensor g;
 #ifdef GCN_LOG
@@ -696,13 +634,13 @@ protected:
                 sci::printShareVecVec(vertexDataVec, dstTid, party);
                 printf("<<<<< Apply Comp p_minus_y: party id %d role %d\n", 1 - dstTid, party);
                 printf(">>>>> Apply Comp ah_t: party id %d role %d\n", 1 - dstTid, party);
-                sci::printShareVecVec(vertexInterData["ah_t"][0], dstTid, party);
+                sci::printShareVecVec(acts.tensor(layer, ActivationKind::HT), dstTid, party);
                 printf("<<<<< Apply Comp ah_t: party id %d role %d\n", 1 - dstTid, party);
                 printf(">>>>> Apply Comp weight_t: party id %d role %d\n", 1 - dstTid, party);
                 sci::printShareVecVec(weightT, dstTid, party);
                 printf("<<<<< Apply Comp weight_t: party id %d role %d\n", 1 - dstTid, party);
 #endif
-                sci::twoPartyGCNBackwardNNInit(vertexDataVec, vertexInterData["ah_t"][0], weightT, normalizer, d, g, dstTid, party);
+                sci::twoPartyGCNBackwardNNInit(vertexDataVec, acts.tensor(layer, ActivationKind::HT), weightT, normalizer, d, g, dstTid, party);
 
                 uint64_t trainSetSize = (uint64_t)(vecSize * gnnParam.train_ratio);
                 double gradientScaler = (double) 1 / trainSetSize;
@@ -714,15 +652,14 @@ protected:
                 double weightScaler = (double) 1 / tileNum;
                 sci::twoPartyGCNMatrixScale(weightRef, static_cast<uint64_t>(weightScaler * (1<<SCALER_BIT_LENGTH)), weightRef, dstTid, party);
 
-                vertexInterData["d"][0].swap(d);
+                acts.tensor(layer, ActivationKind::D).swap(d);
                 dstVec.swap(g);
 #ifdef GCN_LOG
                 printf(">>>>> Apply Comp d: party id %d role %d\n", 1 - dstTid, party);
-                sci::printShareVecVec(vertexInterData["d"][0], dstTid, party);
+                sci::printShareVecVec(acts.tensor(layer, ActivationKind::D), dstTid, party);
                 printf("<<<<< Apply Comp d: party id %d role %d\n", 1 - dstTid, party);
 #endif
             } else { // GCN_BACKWARD_NN
-                vertexInterData["d"] = std::vector<ShareTensor>(1);
                 ShareTensor d;
                 ShareTensor g;
 #ifdef GCN_LOG
@@ -730,7 +667,7 @@ protected:
                 sci::printShareVecVec(vertexDataVec, dstTid, party);
                 printf("<<<<< Apply Comp p_minus_y: party id %d role %d\n", 1 - dstTid, party);
                 printf(">>>>> Apply Comp ah_t: party id %d role %d\n", 1 - dstTid, party);
-                sci::printShareVecVec(vertexInterData["ah_t"][0], dstTid, party);
+                sci::printShareVecVec(acts.tensor(layer, ActivationKind::HT), dstTid, party);
                 printf("<<<<< Apply Comp ah_t: party id %d role %d\n", 1 - dstTid, party);
                 printf(">>>>> Apply Comp weight_t: party id %d role %d\n", 1 - dstTid, party);
                 sci::printShareVecVec(weightT, dstTid, party);
@@ -738,7 +675,7 @@ protected:
 #endif
                 bool isFirstLayer = false;
                 if ((iter + 1) % (2 * gnnParam.num_layers) == 0) isFirstLayer = true; 
-                sci::twoPartyGCNBackwardNN(vertexDataVec, vertexInterData["ah_t"][0], vertexInterData["z"][0], weightT, normalizer, d, g, isFirstLayer, dstTid, party);
+                sci::twoPartyGCNBackwardNN(vertexDataVec, acts.tensor(layer, ActivationKind::HT), acts.tensor(layer, ActivationKind::Z), weightT, normalizer, d, g, isFirstLayer, dstTid, party);
 #ifdef GCN_LOG
                 printf(">>>>> Apply Comp d: party id %d role %d\n", 1 - dstTid, party);
                 sci::printShareVecVec(d, dstTid, party);
@@ -763,11 +700,11 @@ protected:
                 double weightScaler = (double) 1 / tileNum;
                 sci::twoPartyGCNMatrixScale(weightRef, static_cast<uint64_t>(weightScaler * (1<<SCALER_BIT_LENGTH)), weightRef, dstTid, party);
 
-                vertexInterData["d"][0].swap(d);
+                acts.tensor(layer, ActivationKind::D).swap(d);
                 dstVec.swap(g);
 
 #ifdef GCN_LOG
-                sci::printShareVecVec(vertexInterData["d"][0], dstTid, party);
+                sci::printShareVecVec(acts.tensor(layer, ActivationKind::D), dstTid, party);
                 printf("---------\n");
                 sci::printShareVecVec(weightRef, dstTid, party);
                 printf("---------\n");
@@ -789,7 +726,7 @@ protected:
                             sci::plaintext_add_matrix_in_place(weightRef, weightFromTheOtherParties[i]);
                         }
                     }
-                    // debugD = sci::plaintext_add_matrix(vertexInterData["d"][0], coVertexInterData["d"][0]);
+                    // debugD = sci::plaintext_add_matrix(acts.tensor(layer, ActivationKind::D), coActs.tensor(layer, ActivationKind::D));
                     sci::plaintext_add_matrix_in_place(weightRef, coWeightRef);
                     coWeightRef = weightRef;
                     for (int i = 0; i < tileNum; ++i) {
@@ -818,7 +755,7 @@ protected:
             } else {
                 remote_weight_ready_smp.release();
                 weight_avg_finished_smp.acquire();
-                // ShareVecVec debugD = sci::plaintext_add_matrix(vertexInterData["d"][0], coVertexInterData["d"][0]);
+                // ShareVecVec debugD = sci::plaintext_add_matrix(acts.tensor(layer, ActivationKind::D), coActs.tensor(layer, ActivationKind::D));
 #ifdef GCN_LOG
                 // printf(">>>>> Apply Comp added d: party id %d role %d\n", 1 - dstTid, party);
                 // sci::printShareVecVec(debugD, dstTid, party);
@@ -839,51 +776,6 @@ protected:
     }
 
     void writeApplyTaskVecResult(GraphSummary& gs, uint64_t iter, const std::vector<Task>& taskVec, std::vector<ShareVec>& dstVec, bool isClient) const {
-        GNNParam& gnnParam = GNNParam::getGNNParam();
-        uint64_t vecSize = taskVec.size();
-        for (int i=0; i<vecSize; ++i) {
-            if (!taskVec[i].finished) {
-                throw ResultNotReadyException("Apply Task result not ready yet!\n");
-                exit(-1);
-            }
-        }
-        dstVec.clear();
-
-        if ((iter / gnnParam.num_layers) % 2 == 0) { // FORWARD
-            TensorVecMap& vertexInterData = isClient? gs.localVertexInterDataTVs[iter%gnnParam.num_layers]:gs.remoteVertexInterDataTVs[iter%gnnParam.num_layers];
-            vertexInterData["z"] = std::vector<ShareTensor>();
-            if (iter % gnnParam.num_layers != gnnParam.num_layers - 1) { // GCN_FORWARD_NN
-                for (int i=0; i<vecSize; ++i) {
-                    GCNForwardNN* gfn = (GCNForwardNN*)taskVec[i].buf;
-                    vertexInterData["z"].push_back(toShareTensor(gfn->z));
-                    dstVec.push_back(gfn->new_h);
-                }
-            } else { // GCN_FORWARD_PREDICTION
-                vertexInterData["p"] = std::vector<ShareTensor>();
-                for (int i=0; i<vecSize; ++i) {
-                    GCNForwardNNPrediction* gfnp = (GCNForwardNNPrediction*)taskVec[i].buf;
-                    vertexInterData["p"].push_back(toShareTensor(gfnp->p));
-                    vertexInterData["z"].push_back(toShareTensor(gfnp->z));
-                    dstVec.push_back(gfnp->p_minus_y);
-                }                
-            }
-        } else { // BACKWARD
-            TensorVecMap& vertexInterData = isClient? gs.localVertexInterDataTVs[(gnnParam.num_layers-1)-iter%gnnParam.num_layers]:gs.remoteVertexInterDataTVs[(gnnParam.num_layers-1)-iter%gnnParam.num_layers];
-            vertexInterData["d"] = std::vector<ShareTensor>();
-            if (iter % gnnParam.num_layers == 0) { // GCN_BACKWARD_NN_INIT
-                for (int i=0; i<vecSize; ++i) {
-                    GCNBackwardNNInit* gbni = (GCNBackwardNNInit*)taskVec[i].buf;
-                    vertexInterData["d"].push_back(gbni->d);
-                    dstVec.push_back(gbni->g);
-                }                
-            } else { // GCN_BACKWARD_NN
-                for (int i=0; i<vecSize; ++i) {
-                    GCNBackwardNN* gbn = (GCNBackwardNN*)taskVec[i].buf;
-                    vertexInterData["d"].push_back(gbn->d);
-                    dstVec.push_back(gbn->g);                    
-                }
-            }
-        }
     }
 
     void onAlgoKernelStart(Ptr<GraphTileType>& graph) const {
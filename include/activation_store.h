@@ -0,0 +1,220 @@
+#ifndef ACTIVATION_STORE_H_
+#define ACTIVATION_STORE_H_
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "task.h"
+#include "utils/exception.h"
+
+namespace GraphGASLite {
+
+enum class ActivationKind {
+    HT,     // Transposed layer input
+    Z,      // Pre-activation output
+    P,      // Prediction
+    G,      // Gradient w.r.t. the layer input
+    D,      // Gradient w.r.t. the layer weight
+    HW,     // Scaled matmul output of the layer input, the scatter source
+    Count,
+};
+
+static inline std::string activationKindName(const ActivationKind& kind) {
+    switch(kind) {
+        case ActivationKind::HT: return "h_t";
+        case ActivationKind::Z: return "z";
+        case ActivationKind::P: return "p";
+        case ActivationKind::G: return "g";
+        case ActivationKind::D: return "d";
+        case ActivationKind::HW: return "hw";
+        default: return "invalid";
+    }
+}
+
+/**
+ * Per-layer activation share store of one peer.
+ *
+ * Activations are addressed by (layer, kind) instead of by string key, and the
+ * store keeps track of how many bytes each layer holds. When a scratch file is
+ * given, cold layers can be spilled to it between forward and backward and are
+ * transparently reloaded on the next access.
+ *
+ * A store is used by one thread at a time.
+ */
+class ActivationStore {
+public:
+    ActivationStore() : fd_(-1), fileSize_(0) {}
+
+    ~ActivationStore() {
+        if (fd_ >= 0) close(fd_);
+    }
+
+    ActivationStore(const ActivationStore&) = delete;
+    ActivationStore& operator=(const ActivationStore&) = delete;
+
+    uint32_t layerCount() const { return slots_.size(); }
+    void layerCountIs(uint32_t layerCount) { slots_.resize(layerCount); }
+
+    /**
+     * Enable spilling to a scratch file. The file is unlinked right away so it
+     * does not outlive the process.
+     */
+    void spillFileIs(const std::string& path) {
+        if (fd_ >= 0) close(fd_);
+        fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+        if (fd_ < 0) {
+            throw FileException(path);
+        }
+        unlink(path.c_str());
+        fileSize_ = 0;
+    }
+
+    bool spillEnabled() const { return fd_ >= 0; }
+
+    /**
+     * Get the activation, reloading it if spilled. Created empty if absent.
+     */
+    ShareTensor& tensor(uint32_t layer, ActivationKind kind) {
+        Slot& slot = slotOf(layer, kind);
+        if (slot.spilled) reload(slot);
+        return slot.tensor;
+    }
+
+    bool hasTensor(uint32_t layer, ActivationKind kind) const {
+        const Slot& slot = slots_.at(layer)[static_cast<size_t>(kind)];
+        return slot.spilled || !slot.tensor.empty();
+    }
+
+    /**
+     * Spill all activations of a layer to the scratch file. No-op if spilling
+     * is not enabled.
+     */
+    void spill(uint32_t layer) {
+        if (fd_ < 0) return;
+        for (auto& slot : slots_.at(layer)) spill(slot);
+    }
+
+    /**
+     * Drop all activations of a layer, resident or spilled.
+     */
+    void release(uint32_t layer) {
+        for (auto& slot : slots_.at(layer)) {
+            ShareTensor().swap(slot.tensor);
+            slot.spilled = false;
+        }
+    }
+
+    uint64_t residentBytes(uint32_t layer) const {
+        uint64_t bytes = 0;
+        for (const auto& slot : slots_.at(layer)) {
+            for (const auto& row : slot.tensor) bytes += row.size() * sizeof(uint64_t);
+        }
+        return bytes;
+    }
+
+    uint64_t spilledBytes(uint32_t layer) const {
+        uint64_t bytes = 0;
+        for (const auto& slot : slots_.at(layer)) {
+            if (slot.spilled) bytes += slot.rows * slot.cols * sizeof(uint64_t);
+        }
+        return bytes;
+    }
+
+    uint64_t residentBytes() const {
+        uint64_t bytes = 0;
+        for (uint32_t layer = 0; layer < slots_.size(); ++layer) bytes += residentBytes(layer);
+        return bytes;
+    }
+
+    void printUsage(const std::string& tag) const {
+        for (uint32_t layer = 0; layer < slots_.size(); ++layer) {
+            printf("activation %s layer %u: %lu bytes resident, %lu bytes spilled\n",
+                    tag.c_str(), layer, residentBytes(layer), spilledBytes(layer));
+        }
+    }
+
+private:
+    struct Slot {
+        ShareTensor tensor;
+        bool spilled = false;
+        uint64_t rows = 0;
+        uint64_t cols = 0;
+        uint64_t offset = 0;
+        uint64_t capacity = 0;
+    };
+
+    Slot& slotOf(uint32_t layer, ActivationKind kind) {
+        if (layer >= slots_.size()) {
+            throw RangeException(std::to_string(layer));
+        }
+        return slots_[layer][static_cast<size_t>(kind)];
+    }
+
+    void spill(Slot& slot) {
+        if (slot.spilled || slot.tensor.empty()) return;
+        const uint64_t rows = slot.tensor.size();
+        const uint64_t cols = slot.tensor[0].size();
+        for (const auto& row : slot.tensor) {
+            // Only rectangular tensors are spilled.
+            if (row.size() != cols) return;
+        }
+        const uint64_t bytes = rows * cols * sizeof(uint64_t);
+        if (bytes == 0) return;
+
+        // Layer shapes are fixed across epochs, so a slot keeps its file region.
+        if (slot.capacity < bytes) {
+            const uint64_t pageSize = sysconf(_SC_PAGESIZE);
+            slot.offset = fileSize_;
+            slot.capacity = (bytes + pageSize - 1) / pageSize * pageSize;
+            fileSize_ += slot.capacity;
+            if (ftruncate(fd_, fileSize_) != 0) {
+                throw FileException("activation scratch file");
+            }
+        }
+
+        void* addr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, slot.offset);
+        if (addr == MAP_FAILED) {
+            throw MemoryException("mmap activation scratch file");
+        }
+        uint64_t* dst = static_cast<uint64_t*>(addr);
+        for (uint64_t r = 0; r < rows; ++r) {
+            memcpy(dst + r * cols, slot.tensor[r].data(), cols * sizeof(uint64_t));
+        }
+        munmap(addr, bytes);
+
+        slot.rows = rows;
+        slot.cols = cols;
+        slot.spilled = true;
+        ShareTensor().swap(slot.tensor);
+    }
+
+    void reload(Slot& slot) {
+        const uint64_t bytes = slot.rows * slot.cols * sizeof(uint64_t);
+        void* addr = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd_, slot.offset);
+        if (addr == MAP_FAILED) {
+            throw MemoryException("mmap activation scratch file");
+        }
+        const uint64_t* src = static_cast<const uint64_t*>(addr);
+        slot.tensor.resize(slot.rows);
+        for (uint64_t r = 0; r < slot.rows; ++r) {
+            slot.tensor[r].assign(src + r * slot.cols, src + (r + 1) * slot.cols);
+        }
+        munmap(addr, bytes);
+        slot.spilled = false;
+    }
+
+private:
+    std::vector<std::array<Slot, static_cast<size_t>(ActivationKind::Count)>> slots_;
+    int fd_;
+    uint64_t fileSize_;
+};
+
+} // namespace GraphGASLite
+
+#endif // ACTIVATION_STORE_H_
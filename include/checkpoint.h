@@ -0,0 +1,132 @@
+#ifndef CHECKPOINT_H_
+#define CHECKPOINT_H_
+
+#include <unistd.h>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+#include "task.h"
+#include "utils/exception.h"
+
+namespace GraphGASLite {
+
+/**
+ * Training checkpoint of one party, the state needed to continue after an
+ * epoch: the weight shares it holds, its own and those held for the previous
+ * party, and the next iteration. Activations are not kept, the iteration is
+ * always the first of an epoch, so none is live. Neither is any RNG state, the
+ * protocols draw fresh randomness every iteration and the weight
+ * initialization is overwritten on resume.
+ *
+ * Compact binary format, all fields 64-bit words in host byte order:
+ * magic, version, tile index, tile number, iteration, tensor count, then for
+ * every tensor its rows, its columns and its entries row by row. The local
+ * weights precede the remote ones.
+ *
+ * A checkpoint is written to a temporary file, synced and renamed over the
+ * current one, whose previous version is kept as well, so a crash leaves at
+ * least one complete checkpoint behind. Parties crash at different times, so
+ * on resume they agree on the last iteration all of them have.
+ */
+struct Checkpoint {
+    uint64_t tileIndex;
+    uint64_t tileNum;
+    uint64_t iter; // The next iteration to run
+    std::vector<ShareTensor> localWeight;
+    std::vector<ShareTensor> remoteWeight;
+};
+
+static const uint64_t CHECKPOINT_MAGIC = 0x31504b434e4e4743ULL; // "CGNNCKP1"
+static const uint64_t CHECKPOINT_VERSION = 1;
+
+static inline std::string checkpointPathOf(const std::string& dir, uint64_t tileIndex, bool isPrevious = false) {
+    return dir + "/cognn_ckpt_" + std::to_string(tileIndex) + (isPrevious? "_prev.bin" : ".bin");
+}
+
+static inline bool isSameTensorShape(const ShareTensor& a, const ShareTensor& b) {
+    return a.size() == b.size() && (a.empty() || a[0].size() == b[0].size());
+}
+
+static inline void writeCheckpoint(const std::string& dir, const Checkpoint& ckpt) {
+    const std::string path = checkpointPathOf(dir, ckpt.tileIndex);
+    const std::string tmpPath = path + ".tmp";
+    FILE* fp = fopen(tmpPath.c_str(), "wb");
+    if (fp == nullptr) throw FileException(tmpPath);
+
+    bool isOk = true;
+    auto put = [fp, &isOk](uint64_t word) {
+        isOk = isOk && fwrite(&word, sizeof(word), 1, fp) == 1;
+    };
+    put(CHECKPOINT_MAGIC);
+    put(CHECKPOINT_VERSION);
+    put(ckpt.tileIndex);
+    put(ckpt.tileNum);
+    put(ckpt.iter);
+    put(ckpt.localWeight.size() + ckpt.remoteWeight.size());
+    for (const auto* tensors : {&ckpt.localWeight, &ckpt.remoteWeight}) {
+        for (const auto& tensor : *tensors) {
+            const uint64_t cols = tensor.empty()? 0 : tensor[0].size();
+            put(tensor.size());
+            put(cols);
+            for (const auto& row : tensor) {
+                if (row.size() != cols) throw RangeException("Ragged checkpoint tensor");
+                isOk = isOk && fwrite(row.data(), sizeof(uint64_t), cols, fp) == cols;
+            }
+        }
+    }
+    isOk = isOk && fflush(fp) == 0 && fsync(fileno(fp)) == 0;
+    isOk = (fclose(fp) == 0) && isOk;
+    if (!isOk) {
+        remove(tmpPath.c_str());
+        throw FileException(tmpPath);
+    }
+
+    // Keep the current checkpoint as the previous one, ignore if there is none.
+    rename(path.c_str(), checkpointPathOf(dir, ckpt.tileIndex, true).c_str());
+    if (rename(tmpPath.c_str(), path.c_str()) != 0) throw FileException(path);
+}
+
+/**
+ * Read a checkpoint. Return false if there is none or it is not a complete
+ * checkpoint of this format.
+ */
+static inline bool readCheckpoint(const std::string& path, Checkpoint& ckpt) {
+    FILE* fp = fopen(path.c_str(), "rb");
+    if (fp == nullptr) return false;
+
+    bool isOk = true;
+    auto get = [fp, &isOk]() {
+        uint64_t word = 0;
+        isOk = isOk && fread(&word, sizeof(word), 1, fp) == 1;
+        return word;
+    };
+    isOk = (get() == CHECKPOINT_MAGIC) && isOk;
+    isOk = (get() == CHECKPOINT_VERSION) && isOk;
+    ckpt.tileIndex = get();
+    ckpt.tileNum = get();
+    ckpt.iter = get();
+    const uint64_t tensorCount = get();
+    ckpt.localWeight.clear();
+    ckpt.remoteWeight.clear();
+    for (uint64_t t = 0; isOk && t < tensorCount; ++t) {
+        const uint64_t rows = get();
+        const uint64_t cols = get();
+        if (!isOk) break;
+        ShareTensor tensor(rows, ShareVec(cols));
+        for (auto& row : tensor) {
+            isOk = isOk && fread(row.data(), sizeof(uint64_t), cols, fp) == cols;
+        }
+        auto& tensors = (t < tensorCount / 2)? ckpt.localWeight : ckpt.remoteWeight;
+        tensors.push_back(std::move(tensor));
+    }
+    // Nothing may follow the last tensor.
+    isOk = isOk && fgetc(fp) == EOF;
+    fclose(fp);
+    return isOk;
+}
+
+} // namespace GraphGASLite
+
+#endif // CHECKPOINT_H_
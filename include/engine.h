@@ -11,6 +11,7 @@
 #include "comm_sync.h"
 #include "graph.h"
 
+#include <list>
 #include <thread>
 #include <vector>
 #include <memory>
@@ -37,6 +38,10 @@ public:
     typedef typename AlgoKernelList::const_iterator AlgoKernelConstIter;
 
 public:
+    ~Engine() {
+        sessionClose();
+    }
+
     Ptr<GraphTileType> graphTile(const TileIdx& tid) const {
         if (tid >= graphs_.size()) return nullptr;
         return graphs_[tid];
@@ -136,20 +141,20 @@ public:
     }
 
     /**
-     * Run all algorithm kernels in sequence on the graph tiles.
-     *
-     * The engine is defined as a functor class.
+     * Open a session: set up the channels to all other tiles and the
+     * communication utility, which are then kept across runs until the
+     * session is closed. Kernels run back to back in one session share them.
      */
-    void operator()() {
+    void sessionOpen() {
+        if (isSessionOpen()) return;
         // Number of worker threads.
         // Currently use one thread for each tile.
         auto threadCount = graphTileCount();
         auto tileIndex = graphTileIndex();
 
         // Utility for communication and synchronization.
-        typedef CommSync<VertexIdx, typename GraphTileType::UpdateType> CommSyncType;
-        CommSyncType cs(threadCount,
-                typename CommSyncType::KeyValue(-1uL, typename GraphTileType::UpdateType()));
+        cs_.reset(new CommSyncType(threadCount,
+                typename CommSyncType::KeyValue(-1uL, typename GraphTileType::UpdateType())));
 
         auto nodeCount = graphTileCount();
         TaskComm& clientTaskComm = TaskComm::getClientInstance();
@@ -163,12 +168,9 @@ public:
             ip += std::to_string(tileIndex + 1);
         }
 
-        std::vector<std::vector<osuCrypto::Channel*>> channels(nodeCount);
-        for (uint64_t i = 0; i < nodeCount; ++i)
-            channels[i].resize(nodeCount);
+        channels_.assign(nodeCount, std::vector<osuCrypto::Channel*>(nodeCount, nullptr));
 
-        std::list<osuCrypto::Session> endpoints;
-        osuCrypto::IOService ioService(0);
+        ioService_.reset(new osuCrypto::IOService(0));
 
         printf("Set up channels\n");
 
@@ -190,42 +192,82 @@ public:
                 }
                 printf("Endpoints name %s\n", name.c_str());
                 if (!isCluster || host) {
-                    endpoints.emplace_back(ioService, ip, port, host?osuCrypto::SessionMode::Server:osuCrypto::SessionMode::Client, name);
+                    endpoints_.emplace_back(*ioService_, ip, port, host?osuCrypto::SessionMode::Server:osuCrypto::SessionMode::Client, name);
                 } else {
                     std::string remoteIp = "10.0.0.";
                     remoteIp += std::to_string(j + 1);
-                    endpoints.emplace_back(ioService, remoteIp, port, host?osuCrypto::SessionMode::Server:osuCrypto::SessionMode::Client, name);             
+                    endpoints_.emplace_back(*ioService_, remoteIp, port, host?osuCrypto::SessionMode::Server:osuCrypto::SessionMode::Client, name);             
                 }
-                channels[tileIndex][j] = new osuCrypto::Channel(endpoints.back().addChannel("chl", "chl"));
+                channels_[tileIndex][j] = new osuCrypto::Channel(endpoints_.back().addChannel("chl", "chl"));
             }
         }
 
         printf("Finish setup channels\n");
 
-        cs.setChannels(&channels);
-
-        cs.threadIdIs(tileIndex);
+        cs_->setChannels(&channels_);
 
-        for (auto& k : kernels_) {
-            (*k)(graphs_[tileIndex], cs);
-        }
+        cs_->threadIdIs(tileIndex);
+    }
 
-        for (auto chls : channels)
-            for (auto chl : chls)
-                if (chl)
+    /**
+     * Close the session, tearing down the channels.
+     */
+    void sessionClose() {
+        if (!isSessionOpen()) return;
+        for (auto& chls : channels_) {
+            for (auto chl : chls) {
+                if (chl) {
                     chl->close();
+                    delete chl;
+                }
+            }
+        }
+        channels_.clear();
 
-        for (auto& ep : endpoints)
+        for (auto& ep : endpoints_)
             ep.stop();
+        endpoints_.clear();
+
+        ioService_->stop();
+        ioService_.reset();
+        cs_.reset();
+    }
 
-        ioService.stop();
+    bool isSessionOpen() const {
+        return cs_ != nullptr;
+    }
+
+    /**
+     * Run all algorithm kernels in sequence on the graph tiles.
+     *
+     * The engine is defined as a functor class. Runs in the open session, or
+     * in one of its own if none is open.
+     */
+    void operator()() {
+        const bool isOwnSession = !isSessionOpen();
+        sessionOpen();
+
+        for (auto& k : kernels_) {
+            (*k)(graphs_[graphTileIndex()], *cs_);
+        }
+
+        if (isOwnSession) sessionClose();
     }
 
+private:
+    typedef CommSync<VertexIdx, typename GraphTileType::UpdateType> CommSyncType;
+
 private:
     GraphTileList graphs_;
     AlgoKernelList kernels_;
     size_t tileIndex_;
 
+    // Session state, kept from sessionOpen() to sessionClose().
+    Ptr<CommSyncType> cs_;
+    Ptr<osuCrypto::IOService> ioService_;
+    std::list<osuCrypto::Session> endpoints_;
+    std::vector<std::vector<osuCrypto::Channel*>> channels_;
+
 };
 
 } // namespace GraphGASLite
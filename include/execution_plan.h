@@ -0,0 +1,96 @@
+#ifndef EXECUTION_PLAN_H_
+#define EXECUTION_PLAN_H_
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+#include "task.h"
+#include "utils/threads.h"
+
+namespace GraphGASLite {
+
+/**
+ * Per-graph execution plan.
+ *
+ * Holds the vectors that only depend on the topology and the layer schedule, so
+ * they are computed once after preprocessing and consumed by reference in every
+ * layer of every epoch instead of being rebuilt per call.
+ */
+class ExecutionPlan {
+public:
+    // Fixed-point pow(inDeg + 1, -0.5) of local vertices, 0 for zero in-degree.
+    std::vector<uint64_t> localNormalizer;
+    // Fixed-point pow(inDeg + 1, -1), the destination normalizer of a layer and the
+    // source normalizer of the next one as a single scale.
+    std::vector<uint64_t> localSquaredNormalizer;
+    // Per update source tile, whether each local vertex receives real updates from it.
+    std::vector<std::vector<bool>> localGatherCond;
+    // Plain number per operand of each layer in an epoch.
+    std::vector<uint32_t> plainNumPerOperand;
+    // Transposed first layer input, own share and the share held for the previous party.
+    ShareTensor localInputT;
+    ShareTensor remoteInputT;
+    // Transposed plaintext input of the one-sided input owner.
+    ShareTensor localPlainInputT;
+
+    ExecutionPlan() {}
+    ExecutionPlan(const ExecutionPlan&) = delete;
+    ExecutionPlan& operator=(const ExecutionPlan&) = delete;
+
+    uint32_t plainNumPerOperandOf(uint64_t iter) const {
+        return plainNumPerOperand[iter % plainNumPerOperand.size()];
+    }
+
+    /**
+     * All-zero vector of length n, created on first use and shared afterwards.
+     * Callers must not modify it.
+     */
+    std::vector<uint64_t>& zeroVec(size_t n) {
+        std::vector<uint64_t>* ret = nullptr;
+        mutex_begin(uniqLock, cacheLock_);
+        auto& vec = zeroVecs_[n];
+        if (vec.size() != n) vec.resize(n, 0);
+        ret = &vec;
+        mutex_end();
+        return *ret;
+    }
+
+    /**
+     * All-false vector of length n, created on first use and shared afterwards.
+     * Callers must not modify it.
+     */
+    std::vector<bool>& falseVec(size_t n) {
+        std::vector<bool>* ret = nullptr;
+        mutex_begin(uniqLock, cacheLock_);
+        auto& vec = falseVecs_[n];
+        if (vec.size() != n) vec.resize(n, false);
+        ret = &vec;
+        mutex_end();
+        return *ret;
+    }
+
+    /**
+     * All-true vector of length n, created on first use and shared afterwards.
+     * Callers must not modify it.
+     */
+    std::vector<bool>& trueVec(size_t n) {
+        std::vector<bool>* ret = nullptr;
+        mutex_begin(uniqLock, cacheLock_);
+        auto& vec = trueVecs_[n];
+        if (vec.size() != n) vec.resize(n, true);
+        ret = &vec;
+        mutex_end();
+        return *ret;
+    }
+
+private:
+    lock_t cacheLock_;
+    std::map<size_t, std::vector<uint64_t>> zeroVecs_;
+    std::map<size_t, std::vector<bool>> falseVecs_;
+    std::map<size_t, std::vector<bool>> trueVecs_;
+};
+
+} // namespace GraphGASLite
+
+#endif // EXECUTION_PLAN_H_
@@ -0,0 +1,57 @@
+#ifndef FRONTIER_H_
+#define FRONTIER_H_
+
+#include <cstdint>
+#include <vector>
+#include "task.h"
+#include "utils/exception.h"
+
+namespace GraphGASLite {
+
+/**
+ * Incremental inference after the features of some vertices changed.
+ *
+ * Layer l of a GCN reads the layer input of the vertex and its in-neighbors,
+ * so the rows whose layer l input differs from the previous run, the frontier
+ * F_l, grow by one hop per layer: F_0 are the changed vertices and F_{l+1} are
+ * F_l and its out-neighbors. Only the rows in the frontier go through the
+ * row-wise protocols, the matmul, the scaling and the activation, the others
+ * are taken from the activation shares cached by the previous run. The
+ * aggregation still moves every row, its communication does not depend on
+ * which rows changed.
+ *
+ * Hybrid inference restricts the secure pass the same way. The vertices whose
+ * receptive field is all local, no peer mirrors any vertex within L - 1 local
+ * hops of them, are predicted by their owner in plaintext, and the frontier is
+ * what the other vertices read: F_L are those vertices and F_l are F_{l+1} and
+ * their in-neighbors, local or at the peers.
+ *
+ * Frontiers are kept as increasing local row indices, one list per layer input
+ * and one for the output.
+ */
+
+/**
+ * sub = the given rows of x.
+ */
+static inline void gatherRows(const ShareVecVec& x, const std::vector<uint64_t>& rows, ShareVecVec& sub) {
+    sub.resize(rows.size());
+    for (uint64_t k = 0; k < rows.size(); ++k) {
+        if (rows[k] >= x.size()) throw RangeException("Frontier row " + std::to_string(rows[k]));
+        sub[k] = x[rows[k]];
+    }
+}
+
+/**
+ * Overwrite the given rows of x with sub.
+ */
+static inline void scatterRows(const ShareVecVec& sub, const std::vector<uint64_t>& rows, ShareVecVec& x) {
+    if (sub.size() != rows.size()) throw RangeException("Unmatched frontier rows");
+    for (uint64_t k = 0; k < rows.size(); ++k) {
+        if (rows[k] >= x.size()) throw RangeException("Frontier row " + std::to_string(rows[k]));
+        x[rows[k]] = sub[k];
+    }
+}
+
+} // namespace GraphGASLite
+
+#endif // FRONTIER_H_
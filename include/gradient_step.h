@@ -0,0 +1,50 @@
+#ifndef GRADIENT_STEP_H_
+#define GRADIENT_STEP_H_
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "task.h"
+#include "multi_model.h"
+#include "SCIHarness.h"
+
+namespace GraphGASLite {
+
+// Significant bits a folded update factor must keep in the fixed point
+// encoding, which bounds its relative error by about 1.6%.
+static const uint32_t GRADIENT_FOLD_MIN_BITS = 6;
+
+static inline uint64_t encodeGradientFactor(double factor) {
+    return static_cast<uint64_t>(factor * (1ULL << SCALER_BIT_LENGTH));
+}
+
+/**
+ * weight -= scaler * rate * d, with rates[m] for the column block of model m.
+ *
+ * Every public factor costs one truncation. The scaler is folded into the
+ * rates, saving the separate scale of d, if each product still has
+ * GRADIENT_FOLD_MIN_BITS significant bits, i.e. rate / trainSize is at least
+ * 2^(GRADIENT_FOLD_MIN_BITS - SCALER_BIT_LENGTH), which every shipped
+ * config reaches. d is scaled in place otherwise, for very small rates or
+ * very large training sets.
+ */
+static inline void twoPartyGradientStep(ShareVecVec& weight, ShareVecVec& d, double scaler,
+        const std::vector<double>& rates, uint64_t coTid, int party) {
+    bool isFoldable = true;
+    for (double rate : rates) {
+        isFoldable = isFoldable && std::fabs(scaler * rate) * (1ULL << SCALER_BIT_LENGTH) >= (double)(1ULL << GRADIENT_FOLD_MIN_BITS);
+    }
+    if (!isFoldable) sci::twoPartyGCNMatrixScale(d, encodeGradientFactor(scaler), d, coTid, party);
+
+    std::vector<uint64_t> factors;
+    for (double rate : rates) factors.push_back(encodeGradientFactor(isFoldable? scaler * rate : rate));
+    if (factors.size() == 1) {
+        sci::twoPartyGCNApplyGradient(weight, d, factors[0], weight, coTid, party);
+    } else {
+        twoPartyModelGradientStep(weight, d, factors, coTid, party);
+    }
+}
+
+} // namespace GraphGASLite
+
+#endif // GRADIENT_STEP_H_
@@ -2,7 +2,11 @@
 #define GRAPH_H_
 
 #include <algorithm>
+#include <map>
+#include <set>
+#include <thread>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include <queue>
 #include "graph_common.h"
@@ -41,6 +45,12 @@ public:
     void outDegInc(const DegreeCount& d = 1u) {
         outDeg_ += d;
     }
+    void inDegDec(const DegreeCount& d = 1u) {
+        inDeg_ -= d;
+    }
+    void outDegDec(const DegreeCount& d = 1u) {
+        outDeg_ -= d;
+    }
 
     VertexDataType& data() { return data_; }
     const VertexDataType& data() const { return data_; }
@@ -635,7 +645,7 @@ public:
     bool edgeSorted() const { return edgeSorted_; }
     void edgeSortedIs(bool sorted) {
         if (!edgeSorted_ && sorted) {
-            std::sort(edges_.begin(), edges_.end(), EdgeType::lessFunc);
+            sortEdges();
             edgeSorted_ = true;
         }
     }
@@ -656,6 +666,114 @@ public:
 
     size_t edgeCount() const { return edges_.size(); }
 
+    /* Edge deltas. */
+
+    /**
+     * Add an edge to a finalized tile. The in-degree of a remote destination is
+     * left to its master tile, which ingests the same delta. The edge list is
+     * sorted again by edgeDeltaCommit().
+     */
+    void edgeDeltaNew(const VertexIdx& srcId, const VertexIdx& dstId, const TileIdx& dstTileId, const EdgeWeightType& weight) {
+        checkFinalized(__func__);
+        if (vertices_.count(srcId) == 0) {
+            throw RangeException(std::to_string(srcId));
+        }
+        if (dstTileId == tid_ && vertices_.count(dstId) == 0) {
+            throw RangeException(std::to_string(dstId));
+        }
+        if (dstTileId != tid_ && mirrorVertices_.count(dstId) == 0) {
+            auto mirrorVertex = Ptr<MirrorVertexType>(new MirrorVertexType(dstId, dstTileId, tid_));
+            mirrorVertices_.insert( typename MirrorVertexMap::value_type(dstId, mirrorVertex) );
+        }
+        edges_.push_back(EdgeType(srcId, dstId, weight));
+        edgeSorted_ = false;
+        vertex(srcId)->outDegInc();
+        if (dstTileId != tid_) {
+            vertex(srcId)->setIsBorderVertex(true);
+        } else {
+            vertex(dstId)->inDegInc();
+        }
+        deltaTiles_.insert(dstTileId);
+    }
+
+    /**
+     * Remove one edge from srcId to dstId from a finalized tile. Removals take
+     * effect in edgeDeltaCommit().
+     */
+    void edgeDeltaDel(const VertexIdx& srcId, const VertexIdx& dstId) {
+        checkFinalized(__func__);
+        if (vertices_.count(srcId) == 0) {
+            throw RangeException(std::to_string(srcId));
+        }
+        edgeDels_[std::make_pair((uint64_t)srcId, (uint64_t)dstId)]++;
+    }
+
+    /**
+     * Apply the pending removals and sort the edge list again. Mirror vertices
+     * left without incoming edges are dropped.
+     */
+    void edgeDeltaCommit() {
+        checkFinalized(__func__);
+        if (!edgeDels_.empty()) {
+            std::unordered_set<uint64_t> touchedSrcs;
+            size_t kept = 0;
+            for (size_t i = 0; i < edges_.size(); i++) {
+                auto it = edgeDels_.find(std::make_pair((uint64_t)edges_[i].srcId(), (uint64_t)edges_[i].dstId()));
+                if (it == edgeDels_.end() || it->second == 0) {
+                    if (kept != i) edges_[kept] = std::move(edges_[i]);
+                    kept++;
+                    continue;
+                }
+                it->second--;
+                const VertexIdx srcId = edges_[i].srcId();
+                const VertexIdx dstId = edges_[i].dstId();
+                vertex(srcId)->outDegDec();
+                if (hasVertex(dstId)) {
+                    vertex(dstId)->inDegDec();
+                    deltaTiles_.insert(tid_);
+                } else {
+                    deltaTiles_.insert(mirrorVertex(dstId)->masterTileId());
+                    touchedSrcs.insert(srcId);
+                }
+            }
+            edges_.erase(edges_.begin() + kept, edges_.end());
+            for (const auto& del : edgeDels_) {
+                if (del.second != 0) {
+                    throw RangeException("edge " + std::to_string(del.first.first) + " -> " + std::to_string(del.first.second));
+                }
+            }
+            edgeDels_.clear();
+
+            // Border flags of the touched sources and the remaining mirror vertices.
+            std::unordered_set<uint64_t> borderSrcs;
+            std::unordered_set<uint64_t> liveMirrors;
+            for (const auto& e : edges_) {
+                if (hasVertex(e.dstId())) continue;
+                liveMirrors.insert(e.dstId());
+                if (touchedSrcs.count(e.srcId())) borderSrcs.insert(e.srcId());
+            }
+            for (const auto srcId : touchedSrcs) {
+                vertex(srcId)->setIsBorderVertex(borderSrcs.count(srcId) != 0);
+            }
+            for (auto mvIter = mirrorVertices_.begin(); mvIter != mirrorVertices_.end(); ) {
+                if (liveMirrors.count(mvIter->first) == 0) {
+                    mvIter = mirrorVertices_.erase(mvIter);
+                } else {
+                    ++mvIter;
+                }
+            }
+            mvidLastVisited_ = -1;
+            mvLastVisited_ = nullptr;
+        }
+        edgeSortedIs(true);
+    }
+
+    /**
+     * Tiles whose incoming edges from this tile changed by deltas.
+     */
+    const std::set<TileIdx>& deltaTiles() const { return deltaTiles_; }
+    void deltaTilesDelAll() { deltaTiles_.clear(); }
+
     bool finalized() const { return finalized_; }
     void finalizedIs(const bool finalized) {
         if (!finalized_ && finalized) {
@@ -680,6 +798,48 @@ public:
         finalized_ = finalized;
     }
 
+private:
+    /**
+     * Sort the edge list. Large lists are split into chunks sorted on separate
+     * threads, then merged pairwise, also in parallel.
+     */
+    void sortEdges() {
+        static const size_t minChunkSize = 1 << 16;
+        const size_t edgeCount = edges_.size();
+        size_t chunkCount = std::max(1u, std::thread::hardware_concurrency());
+        chunkCount = std::min(chunkCount, edgeCount / minChunkSize);
+        if (chunkCount <= 1) {
+            std::sort(edges_.begin(), edges_.end(), EdgeType::lessFunc);
+            return;
+        }
+
+        std::vector<size_t> bounds(chunkCount + 1);
+        for (size_t i = 0; i <= chunkCount; i++) {
+            bounds[i] = edgeCount * i / chunkCount;
+        }
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < chunkCount; i++) {
+            threads.emplace_back([this, &bounds, i]() {
+                std::sort(edges_.begin() + bounds[i], edges_.begin() + bounds[i + 1], EdgeType::lessFunc);
+            });
+        }
+        for (auto& t : threads) t.join();
+
+        for (size_t width = 1; width < chunkCount; width *= 2) {
+            threads.clear();
+            for (size_t i = 0; i + width < chunkCount; i += 2 * width) {
+                const size_t first = bounds[i];
+                const size_t middle = bounds[i + width];
+                const size_t last = bounds[std::min(i + 2 * width, chunkCount)];
+                threads.emplace_back([this, first, middle, last]() {
+                    std::inplace_merge(edges_.begin() + first, edges_.begin() + middle,
+                            edges_.begin() + last, EdgeType::lessFunc);
+                });
+            }
+            for (auto& t : threads) t.join();
+        }
+    }
+
 private:
     const TileIdx tid_;
 
@@ -690,6 +850,10 @@ private:
 
     bool edgeSorted_;
 
+    // Pending edge removals, by (src, dst), and the tiles changed by deltas.
+    std::map<std::pair<uint64_t, uint64_t>, uint32_t> edgeDels_;
+    std::set<TileIdx> deltaTiles_;
+
     /**
      * Finalize graph tile to prevent further changes on graph structure.
      * Any mutator to add/delete vertex/edge is not allowed after finalizing,
@@ -711,6 +875,12 @@ private:
         }
     }
 
+    void checkFinalized(const string& funcName) {
+        if (!finalized_) {
+            throw PermissionException(funcName + ": Graph tile has not been finalized.");
+        }
+    }
+
     GraphTile(const GraphTile&) = delete;
     GraphTile& operator=(const GraphTile&) = delete;
     GraphTile(GraphTile&&) = delete;
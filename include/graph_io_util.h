@@ -1,11 +1,19 @@
 #ifndef GRAPH_IO_UTIL_H_
 #define GRAPH_IO_UTIL_H_
 
+#include <algorithm>
+#include <array>
+#include <cctype>
 #include <cerrno>
+#include <cstring>
 #include <fstream>
 #include <iterator>
 #include <sstream>
 #include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "utils/thread_pool.h"
 #include "graph.h"
 
@@ -13,6 +21,67 @@ namespace GraphGASLite {
 
 namespace GraphIOUtil {
 
+/**
+ * Read-only memory map of a whole file.
+ */
+class MappedFile {
+public:
+    explicit MappedFile(const string& fileName) : data_(nullptr), size_(0) {
+        int fd = open(fileName.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw FileException(fileName);
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            close(fd);
+            throw FileException(fileName);
+        }
+        size_ = st.st_size;
+        if (size_ > 0) {
+            void* addr = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr == MAP_FAILED) {
+                close(fd);
+                throw FileException(fileName);
+            }
+            data_ = static_cast<const char*>(addr);
+        }
+        close(fd);
+    }
+
+    ~MappedFile() {
+        if (data_ != nullptr) munmap(const_cast<char*>(data_), size_);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    const char* data_;
+    size_t size_;
+};
+
+// Parse an unsigned decimal number in [p, end) after optional blanks, and advance p.
+// A faster way to convert string to numbers than using operator>>, and bounded by
+// end as the buffer is not null-terminated.
+inline static bool parseUint64(const char*& p, const char* end, uint64_t& val) {
+    while (p < end && (*p == ' ' || *p == '\t')) p++;
+    const char* pbegin = p;
+    val = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        const uint64_t digit = *p - '0';
+        if (val > (UINT64_MAX - digit) / 10) {
+            // Out of range.
+            return false;
+        }
+        val = val * 10 + digit;
+        p++;
+    }
+    return p != pbegin;
+}
+
 // Get the next line until a non-commented, non-empty line.
 inline static std::istream& nextEffectiveLine(std::istream& input, string& line) {
     do {
@@ -33,6 +102,7 @@ inline static std::istream& nextEffectiveLine(std::istream& input, string& line)
  * @param tileMergeFactor       The factor for tile merge. The actual tile index of
  *                              a vertex will be the index in the partition file
  *                              divided by this factor.
+ * @param finalize              Whether to finalize the tiles.
  * @param vertexArgs            Used by vertex constructor.
  *
  * @return                      graph tiles.
@@ -100,11 +170,7 @@ std::vector< Ptr<GraphTileType> > graphTilesFromEdgeList(const size_t tileCount,
         if (edgeListFileName.empty()) {
             throw FileException(edgeListFileName);
         }
-        std::ifstream infile(edgeListFileName, std::ifstream::in);
-        if (!infile.is_open()) {
-            throw FileException(edgeListFileName);
-        }
-        string line;
+        MappedFile edgeListFile(edgeListFileName);
 
         // Store edge info while reading file, then use multiple load threads to build tiles.
         struct EdgeInfo {
@@ -116,69 +182,112 @@ std::vector< Ptr<GraphTileType> > graphTilesFromEdgeList(const size_t tileCount,
         };
         // Graph tiles for thread i will be loaded by load thread i % loadThreadCount.
         constexpr uint32_t loadThreadCount = 8;
-        std::array<std::vector<EdgeInfo>, loadThreadCount> edgeInfoArray;
-
-        while (nextEffectiveLine(infile, line)) {
-            // Line format: <srcId> <dstId> [weight]
+        typedef std::array<std::vector<EdgeInfo>, loadThreadCount> EdgeInfoArray;
 
-            // A faster way to convert string to numbers than using operator>>.
-            const char* pbegin = line.c_str();
-            char* pend = nullptr;
-            uint64_t srcId = strtoull(pbegin, &pend, 10);
-            if (pend == pbegin || errno == ERANGE) {
-                // No conversion or out of range.
-                throw FileException(edgeListFileName);
+        // The file is split into byte ranges on line boundaries, parsed in parallel into
+        // their own edge info arrays, kept in file order by range. There are more ranges
+        // than threads, so the ranges dense in edges or comments are balanced by stealing.
+        constexpr uint32_t parseRangeCount = 4 * loadThreadCount;
+        std::vector<EdgeInfoArray> edgeInfoArrays(parseRangeCount);
+        std::vector<char> parseFailed(parseRangeCount, false);
+        std::vector<size_t> rangeBegin(parseRangeCount + 1, edgeListFile.size());
+        rangeBegin[0] = 0;
+        for (uint32_t idx = 1; idx < parseRangeCount; idx++) {
+            size_t pos = std::max(rangeBegin[idx - 1], edgeListFile.size() / parseRangeCount * idx);
+            // A line belongs to the range its first byte falls in.
+            if (pos > 0) {
+                const char* eol = static_cast<const char*>(
+                        memchr(edgeListFile.data() + pos - 1, '\n', edgeListFile.size() - pos + 1));
+                pos = (eol == nullptr)? edgeListFile.size() : eol - edgeListFile.data() + 1;
             }
-            pbegin = pend;
-            uint64_t dstId = strtoull(pbegin, &pend, 10);
-            if (pend == pbegin || errno == ERANGE) {
-                // No conversion or out of range.
-                throw FileException(edgeListFileName);
-            }
-            pbegin = pend;
+            rangeBegin[idx] = pos;
+        }
 
-            typename GraphTileType::EdgeType::WeightType weight = defaultWeight;
-            line = line.substr(pbegin - line.c_str());
-            if (line.find_first_not_of(" \t\n\v\f\r") != std::string::npos) {
-                std::istringstream iss(line);
-                if (!(iss >> weight)) {
-                    throw FileException(edgeListFileName);
+        auto parseFunc = [&edgeListFile, &rangeBegin, &edgeInfoArrays, &parseFailed, &vertexTileIdx,
+                &defaultWeight, undirected](uint32_t idx) {
+            EdgeInfoArray& edgeInfoArray = edgeInfoArrays[idx];
+            const char* p = edgeListFile.data() + rangeBegin[idx];
+            const char* end = edgeListFile.data() + rangeBegin[idx + 1];
+            while (p < end) {
+                const char* eol = static_cast<const char*>(memchr(p, '\n', end - p));
+                if (eol == nullptr) eol = end;
+                if (eol == p || *p == '#') {
+                    // Skip empty or commented line.
+                    p = eol + 1;
+                    continue;
                 }
-            }
 
-            // Get corresponding tile and add vertex if hasn't been done.
-            const auto srcTid = vertexTileIdx(srcId);
-            const auto dstTid = vertexTileIdx(dstId);
-            if (!partitioned && !tiles[srcTid]->vertex(srcId)) {
-                tiles[srcTid]->vertexNew(srcId, std::forward<Args>(vertexArgs)...);
+                // Line format: <srcId> <dstId> [weight]
+                uint64_t srcId = 0;
+                uint64_t dstId = 0;
+                if (!parseUint64(p, eol, srcId) || !parseUint64(p, eol, dstId)) {
+                    parseFailed[idx] = true;
+                    return;
+                }
+
+                typename GraphTileType::EdgeType::WeightType weight = defaultWeight;
+                while (p < eol && isspace(static_cast<unsigned char>(*p))) p++;
+                if (p < eol) {
+                    std::istringstream iss(string(p, eol));
+                    if (!(iss >> weight)) {
+                        parseFailed[idx] = true;
+                        return;
+                    }
+                }
+
+                // Get corresponding tile.
+                const auto srcTid = vertexTileIdx(srcId);
+                const auto dstTid = vertexTileIdx(dstId);
+
+                // Store edge info.
+                edgeInfoArray[srcTid % loadThreadCount].push_back(EdgeInfo{srcId, dstId, weight, srcTid, dstTid});
+                if (undirected) {
+                    edgeInfoArray[dstTid % loadThreadCount].push_back(EdgeInfo{dstId, srcId, weight, dstTid, srcTid});
+                }
+                p = eol + 1;
             }
-            if (!partitioned && !tiles[dstTid]->vertex(dstId)) {
-                tiles[dstTid]->vertexNew(dstId, std::forward<Args>(vertexArgs)...);
+        };
+        parallel_for(0, parseRangeCount, 1, [&parseFunc](uint64_t begin, uint64_t end) {
+            for (uint64_t idx = begin; idx < end; idx++) parseFunc(idx);
+        });
+        for (uint32_t idx = 0; idx < parseRangeCount; idx++) {
+            if (parseFailed[idx]) {
+                throw FileException(edgeListFileName);
             }
+        }
 
-            // Store edge info.
-            edgeInfoArray[srcTid % loadThreadCount].push_back(EdgeInfo{srcId, dstId, weight, srcTid, dstTid});
-            if (undirected) {
-                edgeInfoArray[dstTid % loadThreadCount].push_back(EdgeInfo{dstId, srcId, weight, dstTid, srcTid});
+        if (!partitioned) {
+            // Add vertices if hasn't been done, in file order.
+            for (const auto& edgeInfoArray : edgeInfoArrays) {
+                for (const auto& e : edgeInfoArray[0]) {
+                    if (!tiles[e.srcTid]->vertex(e.srcId)) {
+                        tiles[e.srcTid]->vertexNew(e.srcId, std::forward<Args>(vertexArgs)...);
+                    }
+                    if (!tiles[e.dstTid]->vertex(e.dstId)) {
+                        tiles[e.dstTid]->vertexNew(e.dstId, std::forward<Args>(vertexArgs)...);
+                    }
+                }
             }
         }
 
-        ThreadPool loadPool(loadThreadCount);
-        auto loadFunc = [&edgeInfoArray, &tiles, &tileIndex](uint32_t idx) {
-            for (const auto& e : edgeInfoArray[idx]) {
-                // Add edge.
-                if (e.srcTid == tileIndex) {
-                    tiles[e.srcTid]->edgeNew(e.srcId, e.dstId, e.dstTid, e.weight);
-                    if (e.srcTid != e.dstTid) tiles[e.srcTid]->vertex(e.srcId)->setIsBorderVertex(true);
-                } else if (e.dstTid == tileIndex) {
-                    tiles[e.dstTid]->vertex(e.dstId)->inDegInc();
+        auto loadFunc = [&edgeInfoArrays, &tiles, &tileIndex](uint32_t idx) {
+            for (auto& edgeInfoArray : edgeInfoArrays) {
+                for (const auto& e : edgeInfoArray[idx]) {
+                    // Add edge.
+                    if (e.srcTid == tileIndex) {
+                        tiles[e.srcTid]->edgeNew(e.srcId, e.dstId, e.dstTid, e.weight);
+                        if (e.srcTid != e.dstTid) tiles[e.srcTid]->vertex(e.srcId)->setIsBorderVertex(true);
+                    } else if (e.dstTid == tileIndex) {
+                        tiles[e.dstTid]->vertex(e.dstId)->inDegInc();
+                    }
                 }
+                std::vector<EdgeInfo>().swap(edgeInfoArray[idx]);
             }
         };
-        for (uint32_t idx = 0; idx < loadThreadCount; idx++) {
-            loadPool.add_task(std::bind(loadFunc, idx));
-        }
-        loadPool.wait_all();
+        // The edges of a tile are all in one bucket, so only one task adds edges to it.
+        parallel_for(0, loadThreadCount, 1, [&loadFunc](uint64_t begin, uint64_t end) {
+            for (uint64_t idx = begin; idx < end; idx++) loadFunc(idx);
+        });
 
         if (finalize) {
             // Finalize each tile.
@@ -207,6 +316,69 @@ std::vector< Ptr<GraphTileType> > graphTilesFromEdgeList(const size_t tileCount,
     }
 }
 
+/**
+ * Apply an edge delta file to a finalized graph tile.
+ *
+ * Each line is "+ <src> <dst>" to add or "- <src> <dst>" to remove an edge. The
+ * tile adds or removes the edges it holds, i.e. those from its vertices, and
+ * adjusts the in-degree of its vertices for incoming edges held by other tiles.
+ *
+ * @param tile                  the finalized graph tile of this party.
+ * @param tileIndex             the index of the tile.
+ * @param deltaFileName         edge delta file.
+ * @param defaultWeight         the weight of added edges.
+ * @param undirected            whether each line also stands for the reverse edge.
+ * @param tidMap                vertex to tile map from loading.
+ */
+template<typename GraphTileType>
+void edgeDeltaFromFile(Ptr<GraphTileType>& tile, const size_t tileIndex, const string& deltaFileName,
+        const typename GraphTileType::EdgeType::WeightType& defaultWeight, const bool undirected,
+        const std::unordered_map< VertexIdx, TileIdx, std::hash<VertexIdx::Type> >& tidMap) {
+    std::ifstream infile(deltaFileName, std::ifstream::in);
+    if (!infile.is_open()) {
+        throw FileException(deltaFileName);
+    }
+    auto tileOf = [&tidMap, &deltaFileName](uint64_t vid) {
+        auto it = tidMap.find(vid);
+        if (it == tidMap.end()) {
+            throw RangeException(deltaFileName + ": unknown vertex " + std::to_string(vid));
+        }
+        return it->second;
+    };
+    auto applyFunc = [&tile, &tileOf, tileIndex, &defaultWeight](bool isAdd, uint64_t srcId, uint64_t dstId) {
+        const TileIdx srcTid = tileOf(srcId);
+        const TileIdx dstTid = tileOf(dstId);
+        if (srcTid == tileIndex) {
+            if (isAdd) {
+                tile->edgeDeltaNew(srcId, dstId, dstTid, defaultWeight);
+            } else {
+                tile->edgeDeltaDel(srcId, dstId);
+            }
+        } else if (dstTid == tileIndex) {
+            if (isAdd) {
+                tile->vertex(dstId)->inDegInc();
+            } else {
+                tile->vertex(dstId)->inDegDec();
+            }
+        }
+    };
+
+    string line;
+    while (nextEffectiveLine(infile, line)) {
+        std::istringstream iss(line);
+        char op = 0;
+        uint64_t srcId = 0;
+        uint64_t dstId = 0;
+        // Line format: <+|-> <src> <dst>
+        if (!(iss >> op >> srcId >> dstId) || (op != '+' && op != '-')) {
+            throw FileException(deltaFileName);
+        }
+        applyFunc(op == '+', srcId, dstId);
+        if (undirected) applyFunc(op == '+', dstId, srcId);
+    }
+    tile->edgeDeltaCommit();
+}
+
 } // namespace GraphIOUtil
 
 } // namespace GraphGASLite
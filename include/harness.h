@@ -28,6 +28,7 @@ const ArgInfo optInfoList[] = {
     {"-m", "[maxiter]", "Maximum iteration number (default " + std::to_string(maxItersDefault) + ")."},
     {"-p", "[numParts]", "Number of partitions per thread (default " + std::to_string(numPartsDefault) + ")."},
     {"-u", "", "Undirected graph (default directed)."},
+    {"-d", "[deltaFile]", "Edge delta (\"+|- <src> <dst>\" lines) applied to the preprocessed graph, the same on every party."},
     {"-h", "", "Print this help message."},
 };
 
@@ -91,7 +92,7 @@ template <typename AppArgs>
 int algoKernelArgs(int argc, char** argv,
         size_t& threadCount, size_t& graphTileCount, size_t& tileIndex,
         uint64_t& maxIters, uint32_t& numParts, string& setting, bool& noPreprocess, bool& isCluster, bool& isNoDummyEdge, bool& undirected,
-        string& edgelistFile, string& vertexlistFile, string& partitionFile, string& outputFile, string& GNNConfigFile,
+        string& edgeDeltaFile, string& edgelistFile, string& vertexlistFile, string& partitionFile, string& outputFile, string& GNNConfigFile,
         AppArgs& appArgs) {
 
     threadCount = 0;
@@ -113,6 +114,7 @@ int algoKernelArgs(int argc, char** argv,
     outputFile = "";
     GNNConfigFile = "";
     setting = "";
+    edgeDeltaFile = "";
 
     appArgs = AppArgs();
 
@@ -120,7 +122,7 @@ int algoKernelArgs(int argc, char** argv,
 
     int ch;
     opterr = 0; // Reset potential previous errors.
-    while ((ch = getopt(argc, argv, "t:g:i:m:p:s:n:c:r:uh")) != -1) {
+    while ((ch = getopt(argc, argv, "t:g:i:m:p:s:n:c:r:d:uh")) != -1) {
         switch (ch) {
             case 't':
                 std::stringstream(optarg) >> threadCount;
@@ -154,6 +156,9 @@ int algoKernelArgs(int argc, char** argv,
                 if (isNoDummyEdgeFlag == 1)
                     isNoDummyEdge = true;
                 break;
+            case 'd':
+                edgeDeltaFile = optarg;
+                break;
             case 'u':
                 undirected = true;
                 break;
@@ -0,0 +1,368 @@
+#ifndef MATMUL_TRIPLE_H_
+#define MATMUL_TRIPLE_H_
+
+#include <cstdint>
+#include <deque>
+#include <iterator>
+#include <map>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "task.h"
+#include "seed_share.h"
+#include "utils/exception.h"
+#include "utils/thread_pool.h"
+#include "SCIHarness.h"
+
+namespace GraphGASLite {
+
+/**
+ * Matrix Beaver triples for the secure matmuls.
+ *
+ * A triple is a sharing of random U (rows x inner) and V (inner x cols) and of
+ * Z = U * V. With one at hand, A * B only needs E = A - U and F = B - V to be
+ * opened, in a single exchange, after which every party computes its share of
+ * the product locally as Z + E * V + U * F (+ E * F on the client), followed
+ * by the local fixed point truncation.
+ *
+ * Triples are dealt ahead of the iterations by a third party, the one after
+ * the pair's server, which must not collude with either party of the pair. U
+ * and V shares and the client's Z share are expansions of PRG seeds, so only
+ * the server's Z share, which carries the dealer's correction, is sent in full.
+ *
+ * With one-sided input the client of the pair knows the first layer input X in
+ * the clear and holds U, the expansion of a seed it also gives the dealer, as
+ * its share, the server holds X - U. The triples of the matmuls with X or X^T as
+ * left operand reuse that U, so the dealer only draws V, and only the weight
+ * side F is opened, to the client, which multiplies X itself.
+ */
+enum class MatMulOperand : uint64_t {
+    Shared = 0, // Both operands are secret shared
+    Input = 1,  // The left operand is the one-sided input X
+    InputT = 2, // The left operand is X^T
+};
+
+struct MatMulShape {
+    uint64_t rows;
+    uint64_t inner;
+    uint64_t cols;
+    MatMulOperand operand;
+};
+
+struct MatMulTriple {
+    MatMulShape shape;
+    uint64_t seedHi;
+    uint64_t seedLo;
+    ShareVecVec z; // Explicit Z share, empty if it is the expansion of the seed
+};
+
+enum class MatMulTripleKind : uint64_t {
+    U = 1,
+    V = 2,
+    Z = 3,
+};
+
+// Rows of the product per task, rows with more nonzeros are stolen from busy workers.
+static const uint64_t MATMUL_TRIPLE_ROW_GRAIN = 16;
+
+static inline MatMulShape matMulShapeOf(const ShareVecVec& a, const ShareVecVec& b) {
+    return {a.size(), a.empty()? 0 : a[0].size(), b.empty()? 0 : b[0].size(), MatMulOperand::Shared};
+}
+
+static inline MatMulTriple newMatMulTriple(const MatMulShape& shape) {
+    SeedShareMsg seed = newSeedShareMsg(0, 0);
+    return {shape, seed[2], seed[3], ShareVecVec()};
+}
+
+/**
+ * A shape travels as {rows, inner, cols, operand}.
+ */
+static inline ShareVec matMulShapeMsg(const MatMulShape& shape) {
+    return {shape.rows, shape.inner, shape.cols, static_cast<uint64_t>(shape.operand)};
+}
+
+static inline MatMulShape matMulShapeOf(const ShareVec& msg) {
+    if (msg.size() < 4 || msg[3] > static_cast<uint64_t>(MatMulOperand::InputT)) {
+        throw InvalidArgumentException("Malformed matmul shape message");
+    }
+    return {msg[0], msg[1], msg[2], static_cast<MatMulOperand>(msg[3])};
+}
+
+/**
+ * A triple travels as its shape followed by {seed high, seed low}, the explicit
+ * Z share, if any, is sent on its own.
+ */
+static inline ShareVec matMulTripleMsg(const MatMulTriple& triple) {
+    ShareVec msg = matMulShapeMsg(triple.shape);
+    msg.push_back(triple.seedHi);
+    msg.push_back(triple.seedLo);
+    return msg;
+}
+
+static inline MatMulTriple matMulTripleOf(const ShareVec& msg) {
+    if (msg.size() != 6) {
+        throw InvalidArgumentException("Malformed matmul triple message");
+    }
+    return {matMulShapeOf(msg), msg[4], msg[5], ShareVecVec()};
+}
+
+/**
+ * Expand one matrix of the seeded part of a triple share.
+ */
+static inline void expandMatMulTripleShare(const MatMulTriple& triple, MatMulTripleKind kind, ShareVecVec& dst) {
+    const MatMulShape& shape = triple.shape;
+    const uint64_t rows = (kind == MatMulTripleKind::V)? shape.inner : shape.rows;
+    const uint64_t cols = (kind == MatMulTripleKind::U)? shape.inner : shape.cols;
+    expandSeedShare({rows, cols, triple.seedHi ^ static_cast<uint64_t>(kind), triple.seedLo}, dst);
+}
+
+/**
+ * c += a * b over the ring, c must already have the shape of the product.
+ */
+static inline void ringMatMulAdd(const ShareVecVec& a, const ShareVecVec& b, ShareVecVec& c) {
+    const uint64_t rows = a.size();
+    const uint64_t inner = b.size();
+    const uint64_t cols = b.empty()? 0 : b[0].size();
+    parallel_for(0, rows, MATMUL_TRIPLE_ROW_GRAIN, [&a, &b, &c, inner, cols](uint64_t begin, uint64_t end) {
+        for (uint64_t i = begin; i < end; ++i) {
+            uint64_t* ci = c[i].data();
+            for (uint64_t k = 0; k < inner; ++k) {
+                const uint64_t aik = a[i][k];
+                if (aik == 0) continue;
+                const uint64_t* bk = b[k].data();
+                for (uint64_t j = 0; j < cols; ++j) ci[j] += aik * bk[j];
+            }
+        }
+    });
+}
+
+/**
+ * Deal a triple given the seeds of the pair's client and server shares, i.e.
+ * fill in the explicit Z share of the server.
+ */
+static inline void dealMatMulTriple(const MatMulTriple& clientTriple, MatMulTriple& serverTriple) {
+    const MatMulShape& shape = clientTriple.shape;
+    ShareVecVec u, v, other;
+    expandMatMulTripleShare(clientTriple, MatMulTripleKind::U, u);
+    expandMatMulTripleShare(serverTriple, MatMulTripleKind::U, other);
+    for (uint64_t i = 0; i < shape.rows; ++i) {
+        for (uint64_t k = 0; k < shape.inner; ++k) u[i][k] += other[i][k];
+    }
+    expandMatMulTripleShare(clientTriple, MatMulTripleKind::V, v);
+    expandMatMulTripleShare(serverTriple, MatMulTripleKind::V, other);
+    for (uint64_t k = 0; k < shape.inner; ++k) {
+        for (uint64_t j = 0; j < shape.cols; ++j) v[k][j] += other[k][j];
+    }
+
+    ShareVecVec z(shape.rows, ShareVec(shape.cols, 0));
+    ringMatMulAdd(u, v, z);
+    expandMatMulTripleShare(clientTriple, MatMulTripleKind::Z, other);
+    for (uint64_t i = 0; i < shape.rows; ++i) {
+        for (uint64_t j = 0; j < shape.cols; ++j) z[i][j] -= other[i][j];
+    }
+    serverTriple.z.swap(z);
+}
+
+/**
+ * Deal a one-sided triple, whose U is the client's input mask, or its
+ * transpose, instead of the expansion of the client seed.
+ */
+static inline void dealOneSidedMatMulTriple(const ShareVecVec& mask, const MatMulTriple& clientTriple, MatMulTriple& serverTriple) {
+    const MatMulShape& shape = clientTriple.shape;
+    if (mask.size() != shape.rows || (!mask.empty() && mask[0].size() != shape.inner)) {
+        throw RangeException("Unmatched one-sided matmul mask");
+    }
+    ShareVecVec v, other;
+    expandMatMulTripleShare(serverTriple, MatMulTripleKind::V, v);
+
+    ShareVecVec z(shape.rows, ShareVec(shape.cols, 0));
+    ringMatMulAdd(mask, v, z);
+    expandMatMulTripleShare(clientTriple, MatMulTripleKind::Z, other);
+    for (uint64_t i = 0; i < shape.rows; ++i) {
+        for (uint64_t j = 0; j < shape.cols; ++j) z[i][j] -= other[i][j];
+    }
+    serverTriple.z.swap(z);
+}
+
+/**
+ * Local truncation of the two shares of a product (SecureML). If the product is
+ * below 2^l in magnitude, the result is off by at most one unit in the last
+ * place except with probability 2^(l + 1 - 64), when a share wraps around and
+ * the result is off by about 2^(64 - SCALER_BIT_LENGTH), i.e. garbage.
+ */
+static inline void truncateMatMulShare(ShareVecVec& z, bool isClient) {
+    for (auto& row : z) {
+        for (auto& x : row) {
+            x = isClient? static_cast<uint64_t>(static_cast<int64_t>(x) >> SCALER_BIT_LENGTH)
+                : -static_cast<uint64_t>(static_cast<int64_t>(-x) >> SCALER_BIT_LENGTH);
+        }
+    }
+}
+
+/**
+ * Triples one party holds for one peer pair, consumed first in first out per
+ * shape. Both parties of the pair run the same matmul sequence, so they take
+ * matching triples without any coordination.
+ */
+class MatMulTripleStore {
+public:
+    void tripleNew(MatMulTriple& triple) {
+        triples_[keyOf(triple.shape)].push_back(std::move(triple));
+        ++tripleCount_;
+    }
+
+    bool tripleTake(const MatMulShape& shape, MatMulTriple& triple) {
+        auto it = triples_.find(keyOf(shape));
+        if (it == triples_.end() || it->second.empty()) return false;
+        triple = std::move(it->second.front());
+        it->second.pop_front();
+        --tripleCount_;
+        return true;
+    }
+
+    uint64_t tripleCount() const { return tripleCount_; }
+
+    void tripleDelAll() {
+        triples_.clear();
+        tripleCount_ = 0;
+    }
+
+private:
+    typedef std::tuple<uint64_t, uint64_t, uint64_t, uint64_t> ShapeKey;
+    static ShapeKey keyOf(const MatMulShape& shape) {
+        return std::make_tuple(shape.rows, shape.inner, shape.cols, static_cast<uint64_t>(shape.operand));
+    }
+
+    std::map<ShapeKey, std::deque<MatMulTriple>> triples_;
+    uint64_t tripleCount_ = 0;
+};
+
+/**
+ * Online phase of a triple-backed matmul c = a * b with the peer of the pair.
+ * The triple is used up.
+ */
+static inline void beaverMatMul(const ShareVecVec& a, const ShareVecVec& b, MatMulTriple& triple,
+        ShareVecVec& c, TaskComm& taskComm, uint64_t peer, bool isClient) {
+    const MatMulShape& shape = triple.shape;
+    if (a.size() != shape.rows || b.size() != shape.inner) {
+        throw RangeException("Unmatched matmul triple shape");
+    }
+    for (const auto& row : a) {
+        if (row.size() != shape.inner) throw RangeException("Unmatched matmul triple shape");
+    }
+    for (const auto& row : b) {
+        if (row.size() != shape.cols) throw RangeException("Unmatched matmul triple shape");
+    }
+
+    ShareVecVec u, v, z;
+    expandMatMulTripleShare(triple, MatMulTripleKind::U, u);
+    expandMatMulTripleShare(triple, MatMulTripleKind::V, v);
+    if (triple.z.empty()) {
+        expandMatMulTripleShare(triple, MatMulTripleKind::Z, z);
+    } else {
+        z.swap(triple.z);
+    }
+
+    // Open E = a - U and F = b - V, stacked, in one exchange.
+    ShareVecVec ef(shape.rows + shape.inner);
+    for (uint64_t i = 0; i < shape.rows; ++i) {
+        ef[i].resize(shape.inner);
+        for (uint64_t k = 0; k < shape.inner; ++k) ef[i][k] = a[i][k] - u[i][k];
+    }
+    for (uint64_t k = 0; k < shape.inner; ++k) {
+        ef[shape.rows + k].resize(shape.cols);
+        for (uint64_t j = 0; j < shape.cols; ++j) ef[shape.rows + k][j] = b[k][j] - v[k][j];
+    }
+    ShareVecVec peerEf;
+    if (isClient) {
+        taskComm.sendShareVecVec(ef, peer);
+        taskComm.recvShareVecVec(peerEf, peer);
+    } else {
+        taskComm.recvShareVecVec(peerEf, peer);
+        taskComm.sendShareVecVec(ef, peer);
+    }
+    if (peerEf.size() != ef.size()) {
+        throw RangeException("Unmatched opened matmul masks");
+    }
+    for (uint64_t r = 0; r < ef.size(); ++r) {
+        if (peerEf[r].size() != ef[r].size()) throw RangeException("Unmatched opened matmul masks");
+        for (uint64_t j = 0; j < ef[r].size(); ++j) ef[r][j] += peerEf[r][j];
+    }
+    ShareVecVec().swap(peerEf);
+    ShareVecVec e(std::make_move_iterator(ef.begin()), std::make_move_iterator(ef.begin() + shape.rows));
+    ShareVecVec f(std::make_move_iterator(ef.begin() + shape.rows), std::make_move_iterator(ef.end()));
+    ShareVecVec().swap(ef);
+
+    ringMatMulAdd(e, v, z);
+    ringMatMulAdd(u, f, z);
+    if (isClient) ringMatMulAdd(e, f, z);
+
+    truncateMatMulShare(z, isClient);
+    c.swap(z);
+}
+
+/**
+ * Online phase of a one-sided matmul c = X * b, or X^T * b, with the peer of the
+ * pair. The client passes X in the clear as x and its mask U as a, the server
+ * passes X - U as a and no x. The server opens F = b - V to the client, which
+ * adds X * b + U * F to its Z share, while the server adds (X - U) * b to its
+ * own. If rows is given, a and x are only those rows of the triple's left
+ * operand and so is the product. The triple is used up.
+ */
+static inline void oneSidedMatMul(const ShareVecVec* x, const ShareVecVec& a, const ShareVecVec& b, MatMulTriple& triple,
+        const std::vector<uint64_t>* rows, ShareVecVec& c, TaskComm& taskComm, uint64_t peer, bool isClient) {
+    const MatMulShape& shape = triple.shape;
+    const uint64_t rowCount = (rows != nullptr)? rows->size() : shape.rows;
+    if (a.size() != rowCount || b.size() != shape.inner || (isClient && (x == nullptr || x->size() != rowCount))) {
+        throw RangeException("Unmatched matmul triple shape");
+    }
+    for (uint64_t i = 0; i < rowCount; ++i) {
+        if (a[i].size() != shape.inner || (isClient && (*x)[i].size() != shape.inner)) {
+            throw RangeException("Unmatched matmul triple shape");
+        }
+    }
+    for (const auto& row : b) {
+        if (row.size() != shape.cols) throw RangeException("Unmatched matmul triple shape");
+    }
+
+    ShareVecVec z;
+    if (triple.z.empty()) {
+        expandMatMulTripleShare(triple, MatMulTripleKind::Z, z);
+    } else {
+        z.swap(triple.z);
+    }
+    if (rows != nullptr) {
+        ShareVecVec sub(rowCount);
+        for (uint64_t k = 0; k < rowCount; ++k) {
+            if ((*rows)[k] >= z.size()) throw RangeException("Matmul triple row " + std::to_string((*rows)[k]));
+            sub[k].swap(z[(*rows)[k]]);
+        }
+        z.swap(sub);
+    }
+
+    if (isClient) {
+        ShareVecVec f;
+        taskComm.recvShareVecVec(f, peer);
+        if (f.size() != shape.inner) throw RangeException("Unmatched opened matmul masks");
+        for (const auto& row : f) {
+            if (row.size() != shape.cols) throw RangeException("Unmatched opened matmul masks");
+        }
+        ringMatMulAdd(*x, b, z);
+        ringMatMulAdd(a, f, z);
+    } else {
+        ShareVecVec f;
+        expandMatMulTripleShare(triple, MatMulTripleKind::V, f);
+        for (uint64_t k = 0; k < shape.inner; ++k) {
+            for (uint64_t j = 0; j < shape.cols; ++j) f[k][j] = b[k][j] - f[k][j];
+        }
+        taskComm.sendShareVecVec(f, peer);
+        ringMatMulAdd(a, b, z);
+    }
+
+    truncateMatMulShare(z, isClient);
+    c.swap(z);
+}
+
+} // namespace GraphGASLite
+
+#endif // MATMUL_TRIPLE_H_
@@ -0,0 +1,98 @@
+#ifndef METRICS_H_
+#define METRICS_H_
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "task.h"
+#include "utils/exception.h"
+#include "SCIHarness.h"
+
+namespace GraphGASLite {
+
+/**
+ * Training metrics, as a bit set. LOSS reveals the prediction matrix to its
+ * owner, the accuracy metrics only reveal aggregated correct counts.
+ */
+enum EvalMetric : uint32_t {
+    EVAL_LOSS = 1,
+    EVAL_ACCURACY = 2,
+    EVAL_BORDER_ACCURACY = 4,
+};
+
+/**
+ * Parse a comma separated metric list, e.g. "loss,accuracy". "none" and the
+ * empty list select nothing, "all" selects every metric.
+ */
+static inline uint32_t evalMetricsOf(const std::string& names) {
+    uint32_t metrics = 0;
+    std::stringstream ss(names);
+    std::string name;
+    while (std::getline(ss, name, ',')) {
+        if (name.empty() || name == "none") continue;
+        else if (name == "loss") metrics |= EVAL_LOSS;
+        else if (name == "accuracy") metrics |= EVAL_ACCURACY;
+        else if (name == "border_accuracy") metrics |= EVAL_BORDER_ACCURACY;
+        else if (name == "all") metrics |= EVAL_LOSS | EVAL_ACCURACY | EVAL_BORDER_ACCURACY;
+        else throw InvalidArgumentException("Unknown metric " + name);
+    }
+    return metrics;
+}
+
+/**
+ * Whether to evaluate at the end of the epoch, every interval epochs and at
+ * the last one. An interval of 0 disables evaluation.
+ */
+static inline bool isEvalEpoch(uint64_t epoch, uint64_t epochNum, uint32_t interval) {
+    if (interval == 0) return false;
+    return (epoch + 1) % interval == 0 || epoch + 1 == epochNum;
+}
+
+/**
+ * Shares of the numbers of correct predictions over the given row ranges, from
+ * a one-hot prediction share matrix in fixed point. Labels and border flags
+ * are the client's, the server passes empty vectors. The correct entries are
+ * picked with one conditional addition over all (row, class) pairs, with the
+ * client's label match as condition, and summed locally per range.
+ *
+ * counts is one row, the count of every range, followed with withBorder by the
+ * count of the border rows of every range.
+ */
+static inline void twoPartyCorrectCounts(const ShareVecVec& oneHot, const std::vector<uint64_t>& labels,
+        const std::vector<bool>& isBorder, const std::vector<std::pair<uint64_t, uint64_t>>& ranges,
+        bool withBorder, ShareVecVec& counts, uint64_t coTid, int party) {
+    const uint64_t rows = oneHot.size();
+    const uint64_t cols = rows == 0? 0 : oneHot[0].size();
+    const uint64_t copyNum = withBorder? 2 : 1;
+    const bool isClient = (party == sci::ALICE);
+
+    ShareVecVec base(copyNum * rows * cols, ShareVec(1, 0));
+    ShareVecVec picked(copyNum * rows * cols);
+    std::vector<bool> cond(copyNum * rows * cols, true);
+    for (uint64_t c = 0; c < copyNum; ++c) {
+        for (uint64_t i = 0; i < rows; ++i) {
+            for (uint64_t j = 0; j < cols; ++j) {
+                const uint64_t k = (c * rows + i) * cols + j;
+                picked[k].assign(1, oneHot[i][j]);
+                if (isClient) cond[k] = (labels[i] == j) && (c == 0 || isBorder[i]);
+            }
+        }
+    }
+    sci::twoPartyGCNCondVectorAddition(base, picked, cond, base, coTid, party);
+
+    counts.assign(1, ShareVec(copyNum * ranges.size(), 0));
+    for (uint64_t c = 0; c < copyNum; ++c) {
+        for (uint64_t r = 0; r < ranges.size(); ++r) {
+            uint64_t& count = counts[0][c * ranges.size() + r];
+            for (uint64_t i = ranges[r].first; i < ranges[r].second; ++i) {
+                for (uint64_t j = 0; j < cols; ++j) count += base[(c * rows + i) * cols + j][0];
+            }
+        }
+    }
+}
+
+} // namespace GraphGASLite
+
+#endif // METRICS_H_
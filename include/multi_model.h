@@ -0,0 +1,142 @@
+#ifndef MULTI_MODEL_H_
+#define MULTI_MODEL_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "task.h"
+#include "utils/exception.h"
+#include "SCIHarness.h"
+
+namespace GraphGASLite {
+
+/**
+ * Several models of identical shapes trained side by side in one session.
+ *
+ * The weights of the models are concatenated column-wise, so the activations
+ * of a vertex are the activations of all models next to each other, and every
+ * matmul, aggregation and element-wise protocol runs once for all of them. The
+ * first layer weights are [W_1 | ... | W_M], the upper ones are block diagonal,
+ * diag(W_1, ..., W_M), with the off-diagonal blocks publicly zero: both shares
+ * of them are kept at zero, so they stay exactly zero.
+ *
+ * Row-wise protocols over the classes, i.e. the softmax and the argmax, work
+ * on the models stacked row-wise instead, model after model.
+ */
+
+/**
+ * Concatenate the per-model weights, column-wise or block diagonal.
+ */
+static inline DoubleTensor concatModelWeights(const std::vector<DoubleTensor>& models, bool isBlockDiagonal) {
+    const uint64_t modelNum = models.size();
+    const uint64_t rows = (modelNum == 0)? 0 : models[0].size();
+    const uint64_t cols = (rows == 0)? 0 : models[0][0].size();
+    DoubleTensor w(isBlockDiagonal? modelNum * rows : rows, std::vector<double>(modelNum * cols, 0.0));
+    for (uint64_t m = 0; m < modelNum; ++m) {
+        const uint64_t rowOffset = isBlockDiagonal? m * rows : 0;
+        for (uint64_t i = 0; i < rows; ++i) {
+            for (uint64_t j = 0; j < cols; ++j) w[rowOffset + i][m * cols + j] = models[m][i][j];
+        }
+    }
+    return w;
+}
+
+/**
+ * Zero the off-diagonal blocks of a block diagonal share matrix, locally.
+ */
+static inline void maskModelBlocks(ShareVecVec& w, uint32_t modelNum) {
+    const uint64_t rows = w.size();
+    const uint64_t cols = (rows == 0)? 0 : w[0].size();
+    if (modelNum <= 1 || rows % modelNum != 0 || cols % modelNum != 0) return;
+    const uint64_t rowBlock = rows / modelNum;
+    const uint64_t colBlock = cols / modelNum;
+    for (uint64_t i = 0; i < rows; ++i) {
+        const uint64_t m = i / rowBlock;
+        for (uint64_t j = 0; j < cols; ++j) {
+            if (j / colBlock != m) w[i][j] = 0;
+        }
+    }
+}
+
+/**
+ * n x (M * c) to (M * n) x c, the rows of model m at m * n.
+ */
+static inline void stackModelColumns(const ShareVecVec& x, uint32_t modelNum, ShareVecVec& stacked) {
+    const uint64_t rows = x.size();
+    const uint64_t cols = (rows == 0)? 0 : x[0].size() / modelNum;
+    stacked.resize(modelNum * rows);
+    for (uint64_t m = 0; m < modelNum; ++m) {
+        for (uint64_t i = 0; i < rows; ++i) {
+            stacked[m * rows + i].assign(x[i].begin() + m * cols, x[i].begin() + (m + 1) * cols);
+        }
+    }
+}
+
+/**
+ * (M * n) x c back to n x (M * c).
+ */
+static inline void unstackModelColumns(const ShareVecVec& stacked, uint32_t modelNum, ShareVecVec& x) {
+    const uint64_t rows = stacked.size() / modelNum;
+    const uint64_t cols = (rows == 0)? 0 : stacked[0].size();
+    x.assign(rows, ShareVec(modelNum * cols));
+    for (uint64_t m = 0; m < modelNum; ++m) {
+        for (uint64_t i = 0; i < rows; ++i) {
+            std::copy(stacked[m * rows + i].begin(), stacked[m * rows + i].end(), x[i].begin() + m * cols);
+        }
+    }
+}
+
+/**
+ * Parse the comma separated learning rates of the models. The empty list gives
+ * every model the default rate.
+ */
+static inline std::vector<double> modelLearningRatesOf(const std::string& rates, double defaultRate, uint32_t modelNum) {
+    std::vector<double> ret;
+    std::stringstream ss(rates);
+    std::string rate;
+    while (std::getline(ss, rate, ',')) {
+        if (!rate.empty()) ret.push_back(std::stod(rate));
+    }
+    if (ret.empty()) ret.assign(modelNum, defaultRate);
+    if (ret.size() != modelNum) {
+        throw InvalidArgumentException("Expect " + std::to_string(modelNum) + " model learning rates");
+    }
+    return ret;
+}
+
+/**
+ * weight -= d, with the column block of model m of d scaled by factors[m], the
+ * fixed point encoded factor of the model. The per-model scaling is a single
+ * vector scale over the columns, so a single truncation, and the subtraction
+ * is local. Both parties pass the factors, only the client's enter the scale,
+ * as in the other vector scales.
+ */
+static inline void twoPartyModelGradientStep(ShareVecVec& weight, const ShareVecVec& d, const std::vector<uint64_t>& factors,
+        uint64_t coTid, int party) {
+    const uint64_t rows = d.size();
+    const uint64_t cols = (rows == 0)? 0 : d[0].size();
+    const uint64_t modelNum = factors.size();
+    if (rows == 0 || modelNum == 0) return;
+    if (weight.size() != rows || weight[0].size() != cols || cols % modelNum != 0) {
+        throw RangeException("Unmatched model gradient shape");
+    }
+    const uint64_t colBlock = cols / modelNum;
+
+    // The vector scale multiplies rows by the client's factors, so scale d^T.
+    ShareVecVec dT(cols, ShareVec(rows));
+    std::vector<uint64_t> normalizer(cols, 0);
+    for (uint64_t j = 0; j < cols; ++j) {
+        for (uint64_t i = 0; i < rows; ++i) dT[j][i] = d[i][j];
+        if (party == sci::ALICE) normalizer[j] = factors[j / colBlock];
+    }
+    sci::twoPartyGCNVectorScale(dT, normalizer, dT, true, coTid, party);
+    for (uint64_t i = 0; i < rows; ++i) {
+        for (uint64_t j = 0; j < cols; ++j) weight[i][j] -= dT[j][i];
+    }
+}
+
+} // namespace GraphGASLite
+
+#endif // MULTI_MODEL_H_
@@ -0,0 +1,286 @@
+#ifndef QUERY_SERVER_H_
+#define QUERY_SERVER_H_
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "utils/exception.h"
+
+namespace GraphGASLite {
+
+/**
+ * A query of one client connection, the vertex ids to score.
+ */
+struct QueryRequest {
+    int fd;
+    std::vector<uint64_t> vids;
+    std::chrono::steady_clock::time_point arrival;
+};
+
+/**
+ * Local query endpoint of the serving mode, on a Unix socket.
+ *
+ * A client connects and sends one line, either whitespace separated vertex
+ * ids or "shutdown". Every id is answered with one line holding the id and
+ * its prediction, then the connection is closed. Requests that arrive within
+ * one batching window are taken, and answered, together. A line with a token
+ * that is not a vertex id is answered with a single "error" line instead.
+ *
+ * Every party serves only the vertices it owns, on its own endpoint. An id
+ * owned by another party is answered with "<id> at <party>", the party whose
+ * endpoint to ask, and an id of no vertex with "<id> none".
+ *
+ * One thread accepts the connections and hands them to a reader thread, which
+ * reads all open connections as their data arrives, so a slow client does not
+ * hold up the others.
+ *
+ * Latency is counted from the arrival of a request to its answer.
+ */
+class QueryServer {
+public:
+    explicit QueryServer(const std::string& path) : path_(path) {
+        sockaddr_un addr;
+        if (path.size() >= sizeof(addr.sun_path)) {
+            throw InvalidArgumentException("Socket path too long " + path);
+        }
+        listenFd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listenFd_ < 0) throw FileException(path);
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+        unlink(path.c_str());
+        if (bind(listenFd_, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(listenFd_, SOMAXCONN) != 0) {
+            close(listenFd_);
+            throw FileException(path);
+        }
+        if (pipe(wakeFds_) != 0) {
+            close(listenFd_);
+            throw FileException(path);
+        }
+        start_ = std::chrono::steady_clock::now();
+        readThread_ = std::thread([this]() { readLoop(); });
+        acceptThread_ = std::thread([this]() { acceptLoop(); });
+    }
+
+    ~QueryServer() {
+        isStopped_ = true;
+        // Wakes up the blocking accept.
+        shutdown(listenFd_, SHUT_RDWR);
+        acceptThread_.join();
+        readerWake();
+        readThread_.join();
+        close(listenFd_);
+        close(wakeFds_[0]);
+        close(wakeFds_[1]);
+        unlink(path_.c_str());
+        for (auto& request : pending_) close(request.fd);
+    }
+
+    /**
+     * Wait for one batching window and take the requests that arrived by then.
+     */
+    std::vector<QueryRequest> requestBatchTake(uint32_t windowMs) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait_for(lock, std::chrono::milliseconds(windowMs), [this]() { return isShutdownRequested_.load(); });
+        std::vector<QueryRequest> batch;
+        batch.swap(pending_);
+        if (!batch.empty()) ++batchCount_;
+        return batch;
+    }
+
+    bool isShutdownRequested() const { return isShutdownRequested_; }
+
+    /**
+     * Answer a request with one line per vertex id and close its connection.
+     */
+    void requestDone(QueryRequest& request, const std::vector<std::string>& lines) {
+        replySend(request.fd, lines);
+        request.fd = -1;
+
+        const uint64_t latencyUs = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - request.arrival).count();
+        ++requestCount_;
+        queryCount_ += request.vids.size();
+        latencySumUs_ += latencyUs;
+        latencyMaxUs_ = std::max(latencyMaxUs_, latencyUs);
+    }
+
+    void statsPrint() const {
+        const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+        printf("query server: %lu requests, %lu queries in %lu batches, latency avg %.3lf ms max %.3lf ms, throughput %.1lf queries/s\n",
+                requestCount_, queryCount_, batchCount_,
+                requestCount_ == 0? 0.0 : latencySumUs_ / 1e3 / requestCount_, latencyMaxUs_ / 1e3,
+                elapsed == 0? 0.0 : queryCount_ / elapsed);
+    }
+
+private:
+    /**
+     * A connection the reader thread has not read the whole line of.
+     */
+    struct Connection {
+        int fd;
+        std::string line;
+        std::chrono::steady_clock::time_point deadline;
+    };
+
+    void acceptLoop() {
+        while (!isStopped_) {
+            int fd = accept(listenFd_, nullptr, nullptr);
+            if (fd < 0) {
+                if (isStopped_) break;
+                continue;
+            }
+            {
+                std::lock_guard<std::mutex> lock(acceptedMutex_);
+                accepted_.push_back(fd);
+            }
+            readerWake();
+        }
+    }
+
+    void readerWake() {
+        const char byte = 0;
+        // A full pipe already wakes the reader.
+        if (write(wakeFds_[1], &byte, 1) < 0) return;
+    }
+
+    void readLoop() {
+        std::vector<Connection> conns;
+        while (!isStopped_) {
+            {
+                std::lock_guard<std::mutex> lock(acceptedMutex_);
+                // A client must send its line promptly, its connection is read up to then.
+                const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+                for (const auto fd : accepted_) conns.push_back({fd, std::string(), deadline});
+                accepted_.clear();
+            }
+
+            std::vector<pollfd> pfds(1, pollfd{wakeFds_[0], POLLIN, 0});
+            int timeoutMs = -1;
+            const auto now = std::chrono::steady_clock::now();
+            for (const auto& conn : conns) {
+                pfds.push_back(pollfd{conn.fd, POLLIN, 0});
+                const int64_t leftMs = std::chrono::duration_cast<std::chrono::milliseconds>(conn.deadline - now).count();
+                timeoutMs = std::max<int>(0, (timeoutMs < 0)? leftMs : std::min<int64_t>(timeoutMs, leftMs));
+            }
+            if (poll(pfds.data(), pfds.size(), timeoutMs) < 0) continue;
+
+            char buf[4096];
+            if (pfds[0].revents & POLLIN) {
+                if (read(wakeFds_[0], buf, sizeof(buf)) < 0) continue;
+            }
+            std::vector<Connection> openConns;
+            for (uint64_t k=0; k<conns.size(); ++k) {
+                Connection& conn = conns[k];
+                bool isDone = false;
+                if (pfds[k + 1].revents != 0) {
+                    ssize_t ret = recv(conn.fd, buf, sizeof(buf), 0);
+                    if (ret > 0) {
+                        conn.line.append(buf, ret);
+                    } else {
+                        isDone = true;
+                    }
+                }
+                isDone = isDone || conn.line.find('\n') != std::string::npos
+                        || std::chrono::steady_clock::now() >= conn.deadline;
+                if (isDone) {
+                    requestNew(conn.fd, conn.line.substr(0, conn.line.find('\n')));
+                } else {
+                    openConns.push_back(conn);
+                }
+            }
+            conns.swap(openConns);
+        }
+        for (const auto& conn : conns) close(conn.fd);
+        std::lock_guard<std::mutex> lock(acceptedMutex_);
+        for (const auto fd : accepted_) close(fd);
+        accepted_.clear();
+    }
+
+    /**
+     * Send the lines and close the connection.
+     */
+    static void replySend(int fd, const std::vector<std::string>& lines) {
+        std::string reply;
+        for (const auto& line : lines) reply += line + "\n";
+        size_t sent = 0;
+        while (sent < reply.size()) {
+            ssize_t ret = send(fd, reply.data() + sent, reply.size() - sent, MSG_NOSIGNAL);
+            if (ret <= 0) break; // The client is gone, nothing to do.
+            sent += ret;
+        }
+        close(fd);
+    }
+
+    void requestNew(int fd, const std::string& line) {
+        QueryRequest request = {fd, std::vector<uint64_t>(), std::chrono::steady_clock::now()};
+        std::istringstream iss(line);
+        std::string token;
+        bool isShutdown = false;
+        while (iss >> token) {
+            if (token == "shutdown") {
+                isShutdown = true;
+                break;
+            }
+            char* tokenEnd = nullptr;
+            errno = 0;
+            const uint64_t vid = strtoull(token.c_str(), &tokenEnd, 10);
+            if (*tokenEnd != '\0' || errno != 0 || token[0] == '-') {
+                replySend(fd, {"error invalid vertex id " + token});
+                return;
+            }
+            request.vids.push_back(vid);
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (isShutdown) {
+            isShutdownRequested_ = true;
+            close(fd);
+            cv_.notify_all();
+        } else {
+            pending_.push_back(request);
+        }
+    }
+
+    std::string path_;
+    int listenFd_ = -1;
+    // Self pipe, written to wake the reader thread up.
+    int wakeFds_[2] = {-1, -1};
+    std::thread acceptThread_;
+    std::thread readThread_;
+    std::atomic<bool> isStopped_{false};
+    std::atomic<bool> isShutdownRequested_{false};
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<QueryRequest> pending_;
+
+    // Accepted connections, not taken by the reader thread yet.
+    std::mutex acceptedMutex_;
+    std::vector<int> accepted_;
+
+    std::chrono::steady_clock::time_point start_;
+    uint64_t requestCount_ = 0;
+    uint64_t queryCount_ = 0;
+    uint64_t batchCount_ = 0;
+    uint64_t latencySumUs_ = 0;
+    uint64_t latencyMaxUs_ = 0;
+};
+
+} // namespace GraphGASLite
+
+#endif // QUERY_SERVER_H_
@@ -0,0 +1,63 @@
+#ifndef SECURE_ARGMAX_H_
+#define SECURE_ARGMAX_H_
+
+#include <cstdint>
+#include <vector>
+#include "task.h"
+#include "SCIHarness.h"
+
+namespace GraphGASLite {
+
+/**
+ * Row-wise secure argmax of a share matrix, as a one-hot share matrix in fixed
+ * point, so that revealing it discloses only the class decision.
+ *
+ * Built on the ReLU protocol alone. The row maximum m is reduced pairwise with
+ * max(a, b) = b + ReLU(a - b), in a logarithmic number of rounds, and the
+ * indicator of x >= m is ReLU(x - m + 1) - ReLU(x - m), which is exact as the
+ * shares are integers in the ring. Ties yield more than one hot column.
+ */
+static inline void twoPartySecureArgmax(const ShareVecVec& x, ShareVecVec& oneHot, uint64_t coTid, int party) {
+    const uint64_t rows = x.size();
+    const uint64_t cols = rows == 0? 0 : x[0].size();
+    const bool isClient = (party == sci::ALICE);
+
+    // Pairwise reduction of all rows at once, an odd column is carried over.
+    ShareVecVec m = x;
+    for (uint64_t width = cols; width > 1; width = (width + 1) / 2) {
+        const uint64_t half = width / 2;
+        ShareVecVec diff(rows, ShareVec(half));
+        for (uint64_t i = 0; i < rows; ++i) {
+            for (uint64_t j = 0; j < half; ++j) diff[i][j] = m[i][j] - m[i][half + j];
+        }
+        ShareVecVec relu;
+        sci::twoPartyGCNRelu(diff, relu, coTid, party);
+        for (uint64_t i = 0; i < rows; ++i) {
+            for (uint64_t j = 0; j < half; ++j) m[i][j] = m[i][half + j] + relu[i][j];
+            if (width % 2 == 1) m[i][half] = m[i][width - 1];
+            m[i].resize(width - half);
+        }
+    }
+
+    // Both indicator terms in one call, the shifted ones in the upper columns.
+    ShareVecVec shifted(rows, ShareVec(2 * cols));
+    for (uint64_t i = 0; i < rows; ++i) {
+        for (uint64_t j = 0; j < cols; ++j) {
+            const uint64_t d = x[i][j] - m[i][0];
+            shifted[i][j] = d + (isClient? 1 : 0);
+            shifted[i][cols + j] = d;
+        }
+    }
+    ShareVecVec relu;
+    sci::twoPartyGCNRelu(shifted, relu, coTid, party);
+    oneHot.assign(rows, ShareVec(cols));
+    for (uint64_t i = 0; i < rows; ++i) {
+        for (uint64_t j = 0; j < cols; ++j) {
+            oneHot[i][j] = (relu[i][j] - relu[i][cols + j]) << SCALER_BIT_LENGTH;
+        }
+    }
+}
+
+} // namespace GraphGASLite
+
+#endif // SECURE_ARGMAX_H_
@@ -0,0 +1,108 @@
+#ifndef SEED_SHARE_H_
+#define SEED_SHARE_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+#include "task.h"
+#include "utils/exception.h"
+#include "utils/thread_pool.h"
+#include "Common/Defines.h"
+#include "Crypto/PRNG.h"
+
+namespace GraphGASLite {
+
+/**
+ * Seed-compressed share distribution.
+ *
+ * The share handed to another party is pure randomness, so instead of the
+ * matrix itself only its shape and a PRG seed are sent, and the receiver
+ * expands the same AES-CTR streams locally. Every block of rows has its own
+ * stream, derived from the seed and the block index, so blocks are expanded
+ * in parallel.
+ *
+ * A message is {rows, cols, seed high, seed low}.
+ */
+typedef ShareVec SeedShareMsg;
+
+static const uint64_t SEED_SHARE_BLOCK_ROWS = 1024;
+
+static inline SeedShareMsg newSeedShareMsg(uint64_t rows, uint64_t cols) {
+    std::random_device rd;
+    uint64_t seedHi = ((uint64_t)rd() << 32) | rd();
+    uint64_t seedLo = ((uint64_t)rd() << 32) | rd();
+    return {rows, cols, seedHi, seedLo};
+}
+
+/**
+ * Run func(prng, beginRow, endRow) for every row block of a seed message, with
+ * prng positioned at the start of that block's stream. Blocks run in parallel,
+ * so func must only touch its own rows.
+ */
+template<typename Func>
+static inline void forEachSeedShareBlock(const SeedShareMsg& msg, Func func) {
+    if (msg.size() != 4) {
+        throw InvalidArgumentException("Malformed seed share message");
+    }
+    const uint64_t rows = msg[0];
+    const uint64_t blockNum = (rows + SEED_SHARE_BLOCK_ROWS - 1) / SEED_SHARE_BLOCK_ROWS;
+    parallel_for(0, blockNum, 1, [&msg, &func, rows](uint64_t begin, uint64_t end) {
+        for (uint64_t b = begin; b < end; ++b) {
+            osuCrypto::PRNG prng(osuCrypto::toBlock(msg[2], msg[3] ^ b));
+            func(prng, b * SEED_SHARE_BLOCK_ROWS, std::min(rows, (b + 1) * SEED_SHARE_BLOCK_ROWS));
+        }
+    });
+}
+
+/**
+ * Expand a received seed message into the share matrix it stands for.
+ */
+static inline void expandSeedShare(const SeedShareMsg& msg, ShareVecVec& dst) {
+    if (msg.size() != 4) {
+        throw InvalidArgumentException("Malformed seed share message");
+    }
+    const uint64_t cols = msg[1];
+    dst.resize(msg[0]);
+    forEachSeedShareBlock(msg, [&dst, cols](osuCrypto::PRNG& prng, uint64_t begin, uint64_t end) {
+        for (uint64_t i = begin; i < end; ++i) {
+            dst[i].resize(cols);
+            prng.get(dst[i].data(), cols);
+        }
+    });
+}
+
+/**
+ * Re-share a two-party split so that the other party's share becomes the
+ * expansion of a fresh seed, i.e. own += other - PRG(seed). The other share is
+ * released and the message to send in its place is returned.
+ */
+static inline SeedShareMsg reshareWithSeed(ShareVecVec& own, ShareVecVec& other) {
+    const uint64_t rows = own.size();
+    const uint64_t cols = own.empty()? 0 : own[0].size();
+    if (other.size() != rows) {
+        throw RangeException("Unmatched share shapes");
+    }
+    for (uint64_t i = 0; i < rows; ++i) {
+        if (own[i].size() != cols || other[i].size() != cols) {
+            throw RangeException("Unmatched share shapes");
+        }
+    }
+    SeedShareMsg msg = newSeedShareMsg(rows, cols);
+    forEachSeedShareBlock(msg, [&own, &other, cols](osuCrypto::PRNG& prng, uint64_t begin, uint64_t end) {
+        ShareVec r(cols);
+        for (uint64_t i = begin; i < end; ++i) {
+            prng.get(r.data(), cols);
+            for (uint64_t j = 0; j < cols; ++j) {
+                own[i][j] += other[i][j] - r[j];
+            }
+            ShareVec().swap(other[i]);
+        }
+    });
+    ShareVecVec().swap(other);
+    return msg;
+}
+
+} // namespace GraphGASLite
+
+#endif // SEED_SHARE_H_
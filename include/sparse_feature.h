@@ -0,0 +1,80 @@
+#ifndef SPARSE_FEATURE_H_
+#define SPARSE_FEATURE_H_
+
+#include <cstdint>
+#include <vector>
+#include "task.h"
+#include "TaskUtil.h"
+
+namespace GraphGASLite {
+
+/**
+ * Feature matrix in compressed sparse row (CSR) format.
+ *
+ * Citation-graph features are mostly zeros, so only the nonzero entries are
+ * kept. Loading, normalization and fixed-point encoding of the input layer then
+ * scale with the number of nonzeros rather than with rows * dim.
+ */
+class SparseFeatureMatrix {
+public:
+    explicit SparseFeatureMatrix(uint32_t dim = 0)
+        : dim_(dim), rowPtr_(1, 0)
+    {
+        // Nothing else to do.
+    }
+
+    uint32_t dim() const { return dim_; }
+    void dimIs(uint32_t dim) { dim_ = dim; }
+
+    uint64_t rowCount() const { return rowPtr_.size() - 1; }
+    uint64_t nnz() const { return val_.size(); }
+
+    /**
+     * Append a row given by its nonzero column indices (ascending) and values.
+     */
+    void rowNew(const std::vector<uint32_t>& colIdx, const std::vector<double>& val) {
+        colIdx_.insert(colIdx_.end(), colIdx.begin(), colIdx.end());
+        val_.insert(val_.end(), val.begin(), val.end());
+        rowPtr_.push_back(val_.size());
+    }
+
+    /**
+     * Encode a row as a dense fixed-point vector. Zero entries need no encoding.
+     */
+    void rowEncode(uint64_t row, ShareVec& dst) const {
+        dst.assign(dim_, 0);
+        for (uint64_t k = rowPtr_[row]; k < rowPtr_[row + 1]; ++k) {
+            dst[colIdx_[k]] = CryptoUtil::encodeDoubleAsFixedPoint(val_[k]);
+        }
+    }
+
+    /**
+     * Encode the transpose (dim * rowCount) as dense fixed-point rows, scattering
+     * the nonzeros directly instead of transposing an encoded dense matrix.
+     */
+    void transposeEncode(ShareTensor& dst) const {
+        const uint64_t rows = rowCount();
+        dst.assign(dim_, ShareVec(rows, 0));
+        for (uint64_t r = 0; r < rows; ++r) {
+            for (uint64_t k = rowPtr_[r]; k < rowPtr_[r + 1]; ++k) {
+                dst[colIdx_[k]][r] = CryptoUtil::encodeDoubleAsFixedPoint(val_[k]);
+            }
+        }
+    }
+
+    void clear() {
+        rowPtr_.assign(1, 0);
+        colIdx_.clear();
+        val_.clear();
+    }
+
+private:
+    uint32_t dim_;
+    std::vector<uint64_t> rowPtr_;
+    std::vector<uint32_t> colIdx_;
+    std::vector<double> val_;
+};
+
+} // namespace GraphGASLite
+
+#endif // SPARSE_FEATURE_H_
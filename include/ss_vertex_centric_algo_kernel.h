@@ -4,13 +4,32 @@
 #include "vertex_centric_algo_kernel.h"
 #include "ObliviousMapper.h"
 #include "SCIHarness.h"
+#include "sparse_feature.h"
+#include "execution_plan.h"
+#include "activation_store.h"
+#include "seed_share.h"
+#include "matmul_triple.h"
+#include "gradient_step.h"
+#include "secure_argmax.h"
+#include "metrics.h"
+#include "multi_model.h"
+#include "checkpoint.h"
+#include "query_server.h"
+#include "frontier.h"
+#include "vertex_order.h"
+#include "graph_io_util.h"
+#include "utils/thread_pool.h"
 
 #include <thread>
 #include <chrono>
 #include <algorithm>
+#include <unordered_map>
 
 namespace GraphGASLite {
 
+// Vertices per task of the local per-vertex loops on the work-stealing pool.
+static const uint64_t VERTEX_LOOP_GRAIN = 1024;
+
 template<typename GraphTileType>
 class SSEdgeCentricAlgoKernel : public EdgeCentricAlgoKernel<GraphTileType> {
 public:
@@ -19,8 +38,6 @@ public:
     typedef typename GraphTileType::UpdateType UpdateType;
     typedef typename GraphTileType::MirrorVertexType MirrorVertexType;
 
-    typedef std::map<std::string, ShareTensorVec> TensorVecMap;
-
     struct GraphSummary {
         std::vector<Ptr<VertexType>> localVertexVec;
         std::vector<bool> isLocalVertexBorder;
@@ -28,8 +45,18 @@ public:
         std::vector<std::vector<EdgeWeightType>> localEdgeWeightVecs;
         ShareVecVec localVertexSvv;
         std::vector<ShareVecVec> remoteVertexSvvs;
-        ShareVecVec localVertexSvvBackup;
-        std::vector<ShareVecVec> remoteVertexSvvsBackup;
+        // Immutable first layer input shares, own and the one held for the previous party.
+        // The first layer reads them and writes into the working buffers above.
+        ShareVecVec localInputSvv;
+        ShareVecVec remoteInputSvv;
+        // One-sided input: the owner's plaintext input, its share localInputSvv is the
+        // expansion of the seed localInputMask and the co-party holds the difference.
+        // The dealer of the pair learns the mask, so dealer and co-party together
+        // recover the input.
+        ShareVecVec localPlainInput;
+        SeedShareMsg localInputMask;
+        bool isOneSidedInput = false;
+        SparseFeatureMatrix localFeatureCsr; // Owner's input features, in the order of localVertexVec
 
         std::vector<std::vector<uint64_t>> updateSrcOutDeg;
         std::vector<std::vector<uint64_t>> updateDstInDeg;
@@ -46,27 +73,186 @@ public:
         std::vector<ShareVecVec> remoteUpdateSvvs;
         std::vector<ShareVecVec> localUpdateSvvs;
 
-        std::vector<TensorVecMap> localVertexInterDataTVs;
-        std::vector<TensorVecMap> remoteVertexInterDataTVs;
+        // Typed per-layer activations, own and those held for the previous party.
+        ActivationStore localActivations;
+        ActivationStore remoteActivations;
         std::vector<ShareTensor> localWeight;
         std::vector<ShareTensor> remoteWeight;
         std::vector<DoubleTensor> plainWeight;
+        // Matmul triples of the pair led by this party and of the pair of the previous party.
+        MatMulTripleStore localTriples;
+        MatMulTripleStore remoteTriples;
 
         double learningRate;
+        // Learning rate of every model when several are trained together.
+        std::vector<double> modelLearningRates;
         uint64_t globalNumSamples;
+        // First iteration to run, past the epochs a resumed checkpoint covers, and
+        // one past the last. Kernels continuing a session count on from the previous.
+        uint64_t startIter = 0;
+        uint64_t endIter = 0;
+        // Only the frontier rows of every layer, own and of the previous party, are
+        // computed securely, the others come from the activation cache. See frontier.h.
+        bool isFrontierOnly = false;
+        std::vector<std::vector<uint64_t>> localFrontierRows;
+        std::vector<std::vector<uint64_t>> remoteFrontierRows;
+        // Whether the receptive field of the local vertex is all local, hybrid inference only.
+        std::vector<bool> isLocalField;
+
+        ExecutionPlan plan;
     };
     typedef struct GraphSummary GraphSummary;
 
+    /**
+     * State kept across the kernels run back to back in one engine session: the
+     * graph summary with the preprocessed topology, the input shares and the
+     * weight shares. The first kernel fills it, the following ones continue
+     * with it and skip the startup, i.e. the topology preprocessing, the sharing
+     * and the weight initialization.
+     */
+    struct Session {
+        GraphSummary gs;
+        bool isStarted = false;
+    };
+
 protected:
     using typename BaseAlgoKernel<GraphTileType>::CommSyncType;
     
     void getTwoPartyVertexDataVectorShare(GraphSummary& gs, ShareVecVec& vertexSvv0, ShareVecVec& vertexSvv1) const;
+    /**
+     * One-sided input: the owner keeps its vertex data in the clear (fixed-point encoded),
+     * shares it masked with a seed the dealer of matmul triples can expand as well, and
+     * multiplies it with the weight shares itself. Return false if the kernel does not
+     * support it.
+     */
+    virtual bool getOneSidedVertexDataVector(GraphSummary& gs, ShareVecVec& vertexSvv) const { return false; }
+    /**
+     * Seeded input: encode the vertex data and subtract the expansion of a fresh seed
+     * in one pass, so the co-party's share is never materialized here. Return false
+     * if the kernel does not support it.
+     */
+    virtual bool getSeededVertexDataVectorShare(GraphSummary& gs, ShareVecVec& vertexSvv, SeedShareMsg& msg) const { return false; }
+    /**
+     * Split the vertex data of the given local rows, changed since the input was
+     * shared, into two shares, or with one-sided input put their plaintext in
+     * svv0. Return false if the kernel does not support incremental inference.
+     */
+    virtual bool getVertexDataRowsShare(GraphSummary& gs, const std::vector<uint64_t>& rows, ShareVecVec& svv0, ShareVecVec& svv1) const { return false; }
+    /**
+     * Hybrid inference: predict the vertices of gs.isLocalField in plaintext with
+     * the revealed weights, and fill the activation cache the secure pass takes
+     * its other rows from. Return false if the kernel does not support it.
+     */
+    virtual bool onLocalFieldInference(GraphSummary& gs, const std::vector<DoubleTensor>& plainWeight) const { return false; }
     void mergeTwoPartyVertexDataVectorShare(GraphSummary& gs, ShareVecVec& vertexSvv0, ShareVecVec& vertexSvv1) const;
     bool onIteration(Ptr<GraphTileType>& graph, CommSyncType& cs, GraphSummary& gs, const IterCount& iter) const;
     bool onIteration(Ptr<GraphTileType>& graph, CommSyncType& cs, const IterCount& iter) const {}
     void onPreprocessClient(Ptr<GraphTileType>& graph, CommSyncType& cs, GraphSummary& gs, bool doOMPreprocess = true) const;
-    void onPreprocessServer(std::vector<std::thread>& threads, bool doOMPreprocess = true) const;
-    void runAlgoKernelServer(std::vector<std::thread>& threads, Ptr<GraphTileType>& graph, CommSyncType& cs, GraphSummary& gs) const;
+    /**
+     * Oblivious mapper preprocessing of the pairs this party leads, for the peers
+     * flagged in isPeerChanged, or all peers if it is empty.
+     */
+    void preprocessClientObliviousMapper(GraphSummary& gs, const std::vector<bool>& isPeerChanged = std::vector<bool>()) const;
+    void onPreprocessServer(std::vector<std::thread>& threads, bool doOMPreprocess = true, const std::vector<bool>& isPeerChanged = std::vector<bool>(),
+            uint64_t startIter = 0, uint64_t endIter = INF_ITER_COUNT) const;
+    /**
+     * Apply the edge delta to the preprocessed topology and find the peers whose
+     * position vectors changed, i.e. those that need oblivious mapper
+     * preprocessing again. The changed flags of the pairs led by this party and
+     * by the peers are returned in isPeerChanged and isRemotePeerChanged.
+     */
+    void onEdgeDelta(Ptr<GraphTileType>& graph, CommSyncType& cs, GraphSummary& gs,
+            std::vector<bool>& isPeerChanged, std::vector<bool>& isRemotePeerChanged) const;
+    void topologyDelAll(Ptr<GraphTileType>& graph, GraphSummary& gs) const;
+    void buildExecutionPlan(GraphSummary& gs) const;
+    /**
+     * Deal the matmul triples of all iterations. Every party deals for the pair
+     * of the previous party but one and receives the triples of the pairs it is
+     * part of. With one-sided input the dealer also gets the input mask seed of
+     * the owner, to deal the input triples on it.
+     */
+    void dealMatMulTriples(GraphSummary& gs) const;
+    /**
+     * Share the input vertex data with the co-parties and the initial weights
+     * with the next party.
+     */
+    void shareInputAndWeights(GraphSummary& gs) const;
+    /**
+     * Draw a fresh mask of the one-sided input as own share and put the co-party's
+     * share, the plaintext minus the mask, in masked.
+     *
+     * The co-party still receives the whole masked input once, as many words as
+     * sharing it, what is saved is the input side of every first layer matmul.
+     * The dealer of the pair gets the mask seed, see dealMatMulTriples, so the
+     * input is hidden only as long as dealer and co-party do not collude.
+     */
+    void maskOneSidedInput(GraphSummary& gs, ShareVecVec& masked) const;
+    /**
+     * Agree with all parties on the iteration to resume from, the last one all
+     * of them have a checkpoint of, and set gs.startIter to it. 0 if there is
+     * none or resuming is off.
+     */
+    void coordinateResume(GraphSummary& gs) const;
+    /**
+     * Replace the initial weight shares with those of the agreed checkpoint.
+     */
+    void restoreCheckpoint(GraphSummary& gs) const;
+    /**
+     * Whether a checkpoint is due once the iterations before iter are done.
+     */
+    bool isCheckpointIter(const GraphSummary& gs, uint64_t iter) const;
+    void saveCheckpoint(GraphSummary& gs, uint64_t iter) const;
+    /**
+     * Expand the changed vertices into the frontier of every layer, over the local
+     * edges and through the mirror vertices to their owners, and exchange the
+     * frontier rows with the co-parties.
+     */
+    void computeFrontier(Ptr<GraphTileType>& graph, GraphSummary& gs) const;
+    /**
+     * Share the input rows of the changed vertices again with the co-party.
+     */
+    void applyInputDelta(GraphSummary& gs) const;
+    void exchangeFrontierRows(GraphSummary& gs) const;
+    /**
+     * Hybrid inference: find the local vertices whose whole receptive field is
+     * local, and as frontier the rows the other vertices need from every layer,
+     * over the local edges and through the mirror vertices of the peers.
+     */
+    void classifyReceptiveFields(Ptr<GraphTileType>& graph, GraphSummary& gs) const;
+    /**
+     * Reveal the weights of the pair led by this party to it.
+     */
+    void revealWeights(GraphSummary& gs, std::vector<DoubleTensor>& plainWeight) const;
+    /**
+     * Frontier rows of the layer input in the pair led by this party, or by the
+     * previous party for the server.
+     */
+    const std::vector<uint64_t>& frontierRowsOf(const GraphSummary& gs, uint32_t layer, bool isClient) const {
+        return isClient? gs.localFrontierRows.at(layer) : gs.remoteFrontierRows.at(layer);
+    }
+    /**
+     * Reveal the given rows of the prediction shares of the last forward pass to
+     * this party, and the rows the previous party asks for to it.
+     */
+    void revealPredictionRows(GraphSummary& gs, const std::vector<uint64_t>& rows, DoubleTensor& plain) const;
+    /**
+     * Secure matmul c = a * b with the co-party, on a dealt triple if there is
+     * one of the shape and with the online two-party protocol otherwise.
+     */
+    void secureMatMul(GraphSummary& gs, const ShareTensor& a, const ShareTensor& b, ShareTensor& c, uint64_t coTid, int party) const;
+    /**
+     * Secure matmul with the first layer input of the pair, X or X^T if isTransposed,
+     * as left operand, a being the share of it, or of the given rows of X. With
+     * one-sided input and a dealt triple the owner multiplies its plaintext X with
+     * the weight side itself and only F is opened, otherwise it is secureMatMul.
+     */
+    void secureInputMatMul(GraphSummary& gs, const ShareTensor& a, const ShareTensor& b, ShareTensor& c,
+            bool isTransposed, const std::vector<uint64_t>* rows, uint64_t coTid, int party) const;
+    /**
+     * Every server thread counts its finished iterations in serverProgress, at
+     * index (peer - tileIndex - 1) mod tileNum.
+     */
+    void runAlgoKernelServer(std::vector<std::thread>& threads, Ptr<GraphTileType>& graph, CommSyncType& cs, GraphSummary& gs, progress_t& serverProgress) const;
     void runAlgoKernelServer(std::vector<std::thread>& threads) const {}
     void closeAlgoKernelServer(std::vector<std::thread>& threads) const;
     void operator()(Ptr<GraphTileType>& graph, CommSyncType& cs) const override; // Override
@@ -108,6 +294,7 @@ protected:
     // virtual void writeGatherTaskResult(const std::vector<Task>& task, std::vector<ShareVec>& dst) const = 0;
     virtual struct Task genGatherTask(const ShareVec& vertexData, const ShareVec& update, uint64_t dstId, uint64_t dstTid, bool isDummy=false) const = 0;
     virtual void GatherComp(
+        GraphSummary& gs,
         ShareVecVec& vertexSvv, 
         ShareVecVec& updateSvv, 
         std::vector<bool>& isGatherDstVertexDummy,
@@ -117,6 +304,24 @@ protected:
         uint64_t coTid, 
         int party
     ) const = 0;
+    /**
+     * Gather the updates of all source tiles into vertexSvv. Runs GatherComp per
+     * source by default, kernels may fuse the sources into fewer protocol calls.
+     */
+    virtual void GatherAllComp(
+        GraphSummary& gs,
+        ShareVecVec& vertexSvv, 
+        std::vector<ShareVecVec>& updateSvvs, 
+        std::vector<uint64_t>& localVertexInDeg, 
+        uint64_t iter,
+        uint64_t coTid, 
+        int party
+    ) const {
+        for (uint64_t j=0; j<updateSvvs.size(); ++j) {
+            std::vector<bool>& isGatherDstVertexDummy = (party == sci::ALICE)? gs.isGatherDstVertexDummy[j] : gs.plan.falseVec(vertexSvv.size());
+            GatherComp(gs, vertexSvv, updateSvvs[j], isGatherDstVertexDummy, localVertexInDeg, iter, j, coTid, party);
+        }
+    }
     virtual std::vector<Task> genApplyTaskVec(GraphSummary& gs, uint64_t iter, const std::vector<ShareVec>& vertexDataVec, uint64_t dstTid, bool isClient, bool isDummy=false) const = 0;
     virtual void writeApplyTaskVecResult(GraphSummary& gs, uint64_t iter, const std::vector<Task>& taskVec, std::vector<ShareVec>& dstVec, bool isClient) const = 0;
     virtual void ApplyComp(
@@ -131,10 +336,64 @@ protected:
     ) const = 0;
     void fromScatterTaskvResultToPreMergingTaskv(std::vector<Task>& taskv) const;
     virtual void onAlgoKernelStart(Ptr<GraphTileType>& graph, GraphSummary& gs) const = 0;
+    /**
+     * Fill the kernel-specific parts of the execution plan, called once the vertex
+     * data shares are in place and before the first iteration.
+     */
+    virtual void onExecutionPlanBuild(GraphSummary& gs) const {}
+    /**
+     * Shapes of the secure matmuls of the given iteration in the pair led by this
+     * party, in the order they are run. Only kernels that list them get triples.
+     */
+    virtual std::vector<MatMulShape> getIterMatMulShapes(GraphSummary& gs, uint64_t iter) const { return std::vector<MatMulShape>(); }
+
+public:
+    /**
+     * Edge delta file applied on top of the preprocessed topology, so that only
+     * the peer pairs it affects are preprocessed again. Every party must be given
+     * the same delta.
+     */
+    const string& edgeDeltaFile() const { return edgeDeltaFile_; }
+    void edgeDeltaFileIs(const string& edgeDeltaFile, bool undirected) {
+        edgeDeltaFile_ = edgeDeltaFile;
+        edgeDeltaUndirected_ = undirected;
+    }
+
+    /**
+     * Engine session shared with the other kernels, none to run standalone.
+     */
+    const Ptr<Session>& session() const { return session_; }
+    void sessionIs(const Ptr<Session>& session) { session_ = session; }
+
+    /**
+     * Vertices whose data changed since the previous kernel of the session. When
+     * given, the kernel continues the session as incremental inference: only the
+     * frontier of the changed vertices is recomputed, forward only.
+     */
+    const std::vector<uint64_t>& changedVertices() const { return changedVertices_; }
+    void changedVerticesIs(const std::vector<uint64_t>& changedVertices) {
+        changedVertices_ = changedVertices;
+        isIncremental_ = true;
+    }
+
+    /**
+     * Answer the queries of the local endpoint from the predictions of the last
+     * forward pass run in the session, one batching window after another, until
+     * any party is asked to shut down. Every party serves its own vertices and
+     * names the owner of the others.
+     */
+    void serveQueries(QueryServer& server, uint32_t windowMs) const;
+
+protected:
+    string edgeDeltaFile_;
+    bool edgeDeltaUndirected_;
+    Ptr<Session> session_;
+    std::vector<uint64_t> changedVertices_;
+    bool isIncremental_;
 
 protected:
     SSEdgeCentricAlgoKernel(const string& name)
-        : EdgeCentricAlgoKernel<GraphTileType>(name)
+        : EdgeCentricAlgoKernel<GraphTileType>(name), edgeDeltaUndirected_(false), isIncremental_(false)
     {
         // Nothing else to do.
     }
@@ -143,15 +402,14 @@ protected:
 template<typename GraphTileType>
 void SSEdgeCentricAlgoKernel<GraphTileType>::
 getTwoPartyVertexDataVectorShare(GraphSummary& gs, ShareVecVec& vertexSvv0, ShareVecVec& vertexSvv1) const {
+    // Split straight into the preallocated rows.
+    vertexSvv0.resize(gs.localVertexVec.size());
+    vertexSvv1.resize(gs.localVertexVec.size());
     for (uint64_t i=0; i<gs.localVertexVec.size(); ++i) {
         const auto& v = gs.localVertexVec[i];
         auto& data = v->data();
-        ShareVec cur_sv0;
-        ShareVec cur_sv1;
-        data.intoShareVec(cur_sv0, cur_sv1);
-        vertexSvv0.push_back(cur_sv0);
-        vertexSvv1.push_back(cur_sv1);
-        // if (cur_sv0[0] + cur_sv1[0] == 0) printf(">>>>>> %d\n", i);
+        data.intoShareVec(vertexSvv0[i], vertexSvv1[i]);
+        // if (vertexSvv0[i][0] + vertexSvv1[i][0] == 0) printf(">>>>>> %d\n", i);
     }    
 }
 
@@ -172,9 +430,38 @@ operator()(Ptr<GraphTileType>& graph, CommSyncType& cs) const {
     size_t tileIndex = clientTaskComm.getTileIndex();
     std::cout<<tileIndex<<" "<<"Initialize graph algo kernel"<<std::endl;
 
-    GraphSummary gs;
-    
-    this->onAlgoKernelStart(graph, gs);
+    GraphSummary ownGs;
+    GraphSummary& gs = (session_ != nullptr)? session_->gs : ownGs;
+    const bool isContinued = (session_ != nullptr && session_->isStarted);
+
+    if (isIncremental_ && !isContinued) {
+        throw InvalidArgumentException("Incremental inference needs the cached activations of a session");
+    }
+    if (isIncremental_ && this->maxIters().cnt() > getForwardLayerNum()) {
+        throw InvalidArgumentException("Incremental inference runs the forward layers only");
+    }
+    const bool isHybrid = !isContinued && GNNParam::getGNNParam().hybrid_inference;
+    if (isHybrid && this->maxIters().cnt() > getForwardLayerNum()) {
+        throw InvalidArgumentException("Hybrid inference runs the forward layers only");
+    }
+    if (GNNParam::getGNNParam().plain_input_layer && (!GNNParam::getGNNParam().matmul_triple || tileNum < 3)) {
+        throw InvalidArgumentException("Plaintext input layer needs matmul triples and a third party to deal them");
+    }
+
+    if (!isContinued) {
+        this->onAlgoKernelStart(graph, gs);
+
+        // Before any preprocessing, which only needs to cover the remaining iterations.
+        this->coordinateResume(gs);
+        gs.endIter = this->maxIters().cnt();
+    } else {
+        // Go on at the next epoch start, so the layer schedule starts over and the
+        // iterations keep distinct oblivious mapper preprocessing.
+        const uint64_t epochLayerNum = getForwardLayerNum() + getBackwardLayerNum();
+        gs.startIter = (gs.endIter + epochLayerNum - 1) / epochLayerNum * epochLayerNum;
+        gs.endIter = gs.startIter + this->maxIters().cnt();
+        std::cout<<tileIndex<<" "<<"Continue the session at iteration "<<gs.startIter<<std::endl;
+    }
 
     std::cout<<tileIndex<<" "<<"Begin graph preprocessing"<<std::endl;
     
@@ -183,13 +470,31 @@ operator()(Ptr<GraphTileType>& graph, CommSyncType& cs) const {
 
     bool doPreprocess = !clientTaskComm.getNoPreprocess();
 
-    this->onPreprocessServer(preprocessServerThreads, doPreprocess);
+    if (isContinued) {
+        // The topology is preprocessed, only the new iterations need oblivious mappers.
+        auto t_preprocess = std::chrono::high_resolution_clock::now();
+        this->onPreprocessServer(preprocessServerThreads, doPreprocess, std::vector<bool>(), gs.startIter, gs.endIter);
+        if (doPreprocess) this->preprocessClientObliviousMapper(gs);
+        print_duration(t_preprocess, "preprocess");
+    } else if (!edgeDeltaFile_.empty()) {
+        // Preprocess again only the pairs whose positions the delta changes, the
+        // others keep their stored preprocessing.
+        auto t_preprocess = std::chrono::high_resolution_clock::now();
+        std::vector<bool> isPeerChanged;
+        std::vector<bool> isRemotePeerChanged;
+        this->onEdgeDelta(graph, cs, gs, isPeerChanged, isRemotePeerChanged);
+        this->onPreprocessServer(preprocessServerThreads, true, isRemotePeerChanged, gs.startIter, gs.endIter);
+        this->preprocessClientObliviousMapper(gs, isPeerChanged);
+        print_duration(t_preprocess, "preprocess");
+    } else {
+        this->onPreprocessServer(preprocessServerThreads, doPreprocess, std::vector<bool>(), gs.startIter, gs.endIter);
 
-    auto t_preprocess = std::chrono::high_resolution_clock::now();
+        auto t_preprocess = std::chrono::high_resolution_clock::now();
 
-    this->onPreprocessClient(graph, cs, gs, doPreprocess);
+        this->onPreprocessClient(graph, cs, gs, doPreprocess);
     
-    print_duration(t_preprocess, "preprocess");
+        print_duration(t_preprocess, "preprocess");
+    }
 
     // this->onPreprocessServer(preprocessServerThreads, false);
     // this->onPreprocessClient(graph, cs, gs, false);
@@ -197,54 +502,59 @@ operator()(Ptr<GraphTileType>& graph, CommSyncType& cs) const {
     for (auto& thrd : preprocessServerThreads)
         thrd.join();
 
-    std::cout<<tileIndex<<" "<<"Begin vertex data sharing"<<std::endl;
-    // Share Vertex data
-    ShareVecVec& localVertexSvv = gs.localVertexSvv;
-    ShareVecVec remoteLocalVertexSvv;
-    printf("Here1\n");
-    this->getTwoPartyVertexDataVectorShare(gs, localVertexSvv, remoteLocalVertexSvv);
-    printf("local vertex svv size %d\n", localVertexSvv.size());
-    printf("remote vertex svv size %d\n", remoteLocalVertexSvv.size());
-
-    for (int i=0; i<tileNum; ++i) {
-        if (i != tileIndex)
-            clientTaskComm.sendShareVecVec(remoteLocalVertexSvv, i);
+    if (!isContinued) {
+        this->shareInputAndWeights(gs);
+        if (gs.startIter != 0) this->restoreCheckpoint(gs);
+        if (isHybrid) this->classifyReceptiveFields(graph, gs);
+    } else {
+        gs.isFrontierOnly = isIncremental_;
+        if (isIncremental_) {
+            auto t_frontier = std::chrono::high_resolution_clock::now();
+            this->computeFrontier(graph, gs);
+            this->applyInputDelta(gs);
+            print_duration(t_frontier, "frontier");
+        }
     }
 
-    printf("Here2\n");
-
-    TaskComm& serverTaskComm = TaskComm::getServerInstance();
-    std::vector<ShareVecVec>& remoteVertexSvvs = gs.remoteVertexSvvs;    
-    remoteVertexSvvs.resize(tileNum);
-    for (int i=0; i<tileNum; ++i) {
-        if (i != tileIndex)
-            serverTaskComm.recvShareVecVec(remoteVertexSvvs[i], i);
-        std::cout<<tileIndex<<" Preprocess "<<remoteVertexSvvs[i].size()<<" "<<i<<std::endl;
+    if (GNNParam::getGNNParam().matmul_triple) {
+        auto t_triple = std::chrono::high_resolution_clock::now();
+        this->dealMatMulTriples(gs);
+        print_duration(t_triple, "matmul_triple");
     }
 
-    // Backup sample feature
-    gs.localVertexSvvBackup = gs.localVertexSvv;
-    gs.remoteVertexSvvsBackup = gs.remoteVertexSvvs;
+    if (!isContinued) this->buildExecutionPlan(gs);
 
-    printf("Here3\n");
-
-    clientTaskComm.sendShareTensorVec(gs.remoteWeight, (tileIndex + 1) % tileNum);
-    serverTaskComm.recvShareTensorVec(gs.remoteWeight, (tileIndex + tileNum - 1) % tileNum);
+    if (isHybrid) {
+        auto t_local_field = std::chrono::high_resolution_clock::now();
+        std::vector<DoubleTensor> plainWeight;
+        this->revealWeights(gs, plainWeight);
+        if (!this->onLocalFieldInference(gs, plainWeight)) {
+            throw InvalidArgumentException("Hybrid inference is not supported by " + this->name());
+        }
+        print_duration(t_local_field, "local_field_inference");
+    }
 
     std::cout<<tileIndex<<" "<<"Begin algo kernel iteration"<<std::endl;
 
     std::vector<std::thread> algo_kernel_server_threads;
-    this->runAlgoKernelServer(algo_kernel_server_threads, graph, cs, gs);
+    progress_t serverProgress(tileNum - 1);
+    this->runAlgoKernelServer(algo_kernel_server_threads, graph, cs, gs, serverProgress);
     
-    IterCount iter(0);
+    IterCount iter(gs.startIter);
     bool allConverged = false;
-    while (!allConverged && iter < this->maxIters()) {
+    while (!allConverged && iter.cnt() < gs.endIter) {
         auto t_iteration = std::chrono::high_resolution_clock::now();
         bool converged = this->onIteration(graph, cs, gs, iter);
         print_duration(t_iteration, "iteration");
 
         this->onIterationEnd(graph, iter);
         iter++;
+        // Checkpoints only cover the first kernel of a session. The server threads
+        // update gs.remoteWeight, wait until they are done with the iteration too.
+        if (!isContinued && this->isCheckpointIter(gs, iter.cnt())) {
+            serverProgress.wait(iter.cnt());
+            this->saveCheckpoint(gs, iter.cnt());
+        }
     }
 
     printf(">>H1\n");
@@ -267,15 +577,117 @@ operator()(Ptr<GraphTileType>& graph, CommSyncType& cs) const {
 
     printf(">>H2\n");
     
+    TaskComm& serverTaskComm = TaskComm::getServerInstance();
     serverTaskComm.sendFinish();
     printf(">>H3\n");
     clientTaskComm.recvFinish();
     printf(">>H4\n");
 
+    if (session_ != nullptr) session_->isStarted = true;
+
     // this->onAlgoKernelEnd(graph);
     std::cout<<graph->tid()<<" "<<"Finish algo kernel"<<std::endl;
 }
 
+template<typename GraphTileType>
+void SSEdgeCentricAlgoKernel<GraphTileType>::
+shareInputAndWeights(GraphSummary& gs) const {
+    TaskComm& clientTaskComm = TaskComm::getClientInstance();
+    size_t tileNum = clientTaskComm.getTileNum();
+    size_t tileIndex = clientTaskComm.getTileIndex();
+
+    std::cout<<tileIndex<<" "<<"Begin vertex data sharing"<<std::endl;
+    // Share Vertex data
+    ShareVecVec& localVertexSvv = gs.localInputSvv;
+    ShareVecVec remoteLocalVertexSvv;
+    printf("Here1\n");
+    gs.isOneSidedInput = this->getOneSidedVertexDataVector(gs, gs.localPlainInput);
+    const bool isOneSidedInput = gs.isOneSidedInput;
+    const bool isSeedShare = (GNNParam::getGNNParam().seed_share != 0);
+    SeedShareMsg inputSeedMsg;
+    const bool isSeededInput = !isOneSidedInput && isSeedShare && this->getSeededVertexDataVectorShare(gs, localVertexSvv, inputSeedMsg);
+    if (isOneSidedInput) {
+        // The co-party's share cannot be seeded, the own one is the seeded mask.
+        this->maskOneSidedInput(gs, remoteLocalVertexSvv);
+    } else if (!isSeededInput) {
+        this->getTwoPartyVertexDataVectorShare(gs, localVertexSvv, remoteLocalVertexSvv);
+    }
+    printf("local vertex svv size %d\n", localVertexSvv.size());
+    printf("remote vertex svv size %d\n", remoteLocalVertexSvv.size());
+
+    // Only the co-party needs the input share, the other parties overwrite theirs
+    // with the co-party's first layer output anyway.
+    ShareVecVec coPartyMsg;
+    if (isSeededInput) {
+        coPartyMsg.push_back(inputSeedMsg);
+    } else if (isSeedShare && !isOneSidedInput) {
+        coPartyMsg.push_back(reshareWithSeed(localVertexSvv, remoteLocalVertexSvv));
+    } else {
+        coPartyMsg.swap(remoteLocalVertexSvv);
+    }
+    for (int i=0; i<tileNum; ++i) {
+        if (i == tileIndex) continue;
+        if (i == (tileIndex + 1) % tileNum) {
+            clientTaskComm.sendShareVecVec(coPartyMsg, i);
+        } else {
+            clientTaskComm.sendShareVecVec(ShareVecVec(), i);
+        }
+    }
+    ShareVecVec().swap(coPartyMsg);
+
+    printf("Here2\n");
+
+    TaskComm& serverTaskComm = TaskComm::getServerInstance();
+    std::vector<ShareVecVec>& remoteVertexSvvs = gs.remoteVertexSvvs;    
+    remoteVertexSvvs.resize(tileNum);
+    for (int i=0; i<tileNum; ++i) {
+        if (i != tileIndex)
+            serverTaskComm.recvShareVecVec(remoteVertexSvvs[i], i);
+        if (isSeedShare && !isOneSidedInput && (i + 1) % tileNum == tileIndex) {
+            SeedShareMsg msg;
+            msg.swap(remoteVertexSvvs[i][0]);
+            expandSeedShare(msg, remoteVertexSvvs[i]);
+        }
+        std::cout<<tileIndex<<" Preprocess "<<remoteVertexSvvs[i].size()<<" "<<i<<std::endl;
+    }
+
+    // Keep the input of the previous party, the other peers' buffers are overwritten
+    // with their co-party's output before being read.
+    gs.remoteInputSvv.swap(remoteVertexSvvs[(tileIndex + tileNum - 1) % tileNum]);
+    for (auto& svv : remoteVertexSvvs) ShareVecVec().swap(svv);
+
+    printf("Here3\n");
+
+    if (isSeedShare) {
+        ShareVecVec weightMsgs(gs.localWeight.size());
+        for (size_t l=0; l<gs.localWeight.size(); ++l) {
+            weightMsgs[l] = reshareWithSeed(gs.localWeight[l], gs.remoteWeight[l]);
+        }
+        clientTaskComm.sendShareVecVec(weightMsgs, (tileIndex + 1) % tileNum);
+        serverTaskComm.recvShareVecVec(weightMsgs, (tileIndex + tileNum - 1) % tileNum);
+        gs.remoteWeight.resize(weightMsgs.size());
+        for (size_t l=0; l<weightMsgs.size(); ++l) {
+            expandSeedShare(weightMsgs[l], gs.remoteWeight[l]);
+        }
+    } else {
+        clientTaskComm.sendShareTensorVec(gs.remoteWeight, (tileIndex + 1) % tileNum);
+        serverTaskComm.recvShareTensorVec(gs.remoteWeight, (tileIndex + tileNum - 1) % tileNum);
+    }
+}
+
+template<typename GraphTileType>
+void SSEdgeCentricAlgoKernel<GraphTileType>::
+maskOneSidedInput(GraphSummary& gs, ShareVecVec& masked) const {
+    const ShareVecVec& x = gs.localPlainInput;
+    gs.localInputMask = newSeedShareMsg(x.size(), x.empty()? 0 : x[0].size());
+    expandSeedShare(gs.localInputMask, gs.localInputSvv);
+    masked.resize(x.size());
+    for (uint64_t i=0; i<x.size(); ++i) {
+        masked[i].resize(x[i].size());
+        for (uint64_t j=0; j<x[i].size(); ++j) masked[i][j] = x[i][j] - gs.localInputSvv[i][j];
+    }
+}
+
 template<typename GraphTileType>
 void SSEdgeCentricAlgoKernel<GraphTileType>::
 onPreprocessClient(Ptr<GraphTileType>& graph, CommSyncType& cs, GraphSummary& gs, bool doOMPreprocess) const { 
@@ -346,8 +758,8 @@ onPreprocessClient(Ptr<GraphTileType>& graph, CommSyncType& cs, GraphSummary& gs
     localUpdateSvvs.resize(tileNum);
 
     const uint32_t forwardLayerNum = getForwardLayerNum();
-    gs.localVertexInterDataTVs.resize(forwardLayerNum);
-    gs.remoteVertexInterDataTVs.resize(forwardLayerNum);
+    gs.localActivations.layerCountIs(forwardLayerNum);
+    gs.remoteActivations.layerCountIs(forwardLayerNum);
     gs.localWeight.resize(forwardLayerNum);
     gs.remoteWeight.resize(forwardLayerNum);
 
@@ -463,7 +875,34 @@ onPreprocessClient(Ptr<GraphTileType>& graph, CommSyncType& cs, GraphSummary& gs
         std::sort(idVecs[i].begin(), idVecs[i].end()); // Non-descending order by id.
     }
 
-    // Update src vertex pos vec and isDummy vec construction based on counting sort result
+    // Renumber local vertices for locality. Kernels split samples by position into
+    // train, val and test ranges of the id order, so each range is reordered on its
+    // own and every vertex keeps its split. Mirrors keep the id order, their
+    // positions are exchanged as vertex ids.
+    const GNNParam& gnnParam = GNNParam::getGNNParam();
+    const VertexOrder vertexOrder = vertexOrderOf(gnnParam.vertex_order);
+    if (vertexOrder != VertexOrder::ID) {
+        auto t_vertex_order = std::chrono::high_resolution_clock::now();
+        std::vector<uint64_t>& localIds = idVecs[tileIndex];
+        const uint64_t trainSetSize = (uint64_t)(localIds.size() * gnnParam.train_ratio);
+        const uint64_t valSetSize = (uint64_t)(localIds.size() * gnnParam.val_ratio);
+        orderVertexRange(*graph, localIds, 0, trainSetSize, vertexOrder);
+        orderVertexRange(*graph, localIds, trainSetSize, trainSetSize + valSetSize, vertexOrder);
+        orderVertexRange(*graph, localIds, trainSetSize + valSetSize, localIds.size(), vertexOrder);
+        print_duration(t_vertex_order, "vertex_order");
+    }
+
+    // Update src vertex pos vec and isDummy vec construction based on counting sort result.
+    // The per-vertex vectors are built serially, mirrorVertex() caches its last lookup,
+    // and the per-edge vectors of every tile in parallel from the recorded dst vertices.
+    struct UpdateDst {
+        uint64_t dstId;
+        uint64_t inDeg; // 0 for mirror vertices
+        const std::vector<uint64_t>* srcvv;
+        const std::vector<bool>* isSrcDummyv;
+        const std::vector<EdgeWeightType>* incomingEdgev;
+    };
+    std::vector<std::vector<UpdateDst>> updateDsts(tileNum);
     for (int i=0; i<tileNum; ++i) {
         for (int j=0; j<idVecs[i].size(); ++j) {
             // Get vertex or mirror vertex
@@ -475,33 +914,30 @@ onPreprocessClient(Ptr<GraphTileType>& graph, CommSyncType& cs, GraphSummary& gs
                 isLocalVertexBorder.push_back(v->isBorderVertex());
                 localVertexInDeg.push_back(v->inDeg().cnt());
                 localVertexVec.push_back(v);
-                std::vector<uint64_t>& cur_srcvv = v->getSrcVertexv();
-                std::vector<bool>& cur_isSrcDummyv = v->getIsSrcDummyv();
-                std::vector<EdgeWeightType>& cur_incomingEdgev = v->getIncomingEdgev();
-                updateSrcVertexPos[i].insert(updateSrcVertexPos[i].end(), cur_srcvv.begin(), cur_srcvv.end());
-                updateDstVertexPos[i].insert(updateDstVertexPos[i].end(), cur_srcvv.size(), dstId);
-                for (auto& x : cur_srcvv) updateSrcOutDeg[i].push_back(graph->vertex(x)->outDeg().cnt());
-                for (auto& x : cur_srcvv) updateDstInDeg[i].push_back(v->inDeg().cnt());
-                isUpdateSrcVertexDummy[i].insert(isUpdateSrcVertexDummy[i].end(), cur_isSrcDummyv.begin(), cur_isSrcDummyv.end());
-                localEdgeWeightVecs[i].insert(localEdgeWeightVecs[i].end(), cur_incomingEdgev.begin(), cur_incomingEdgev.end());
-                isGatherDstVertexDummy[i].push_back(cur_isSrcDummyv[0]);
+                updateDsts[i].push_back({dstId, v->inDeg().cnt(), &v->getSrcVertexv(), &v->getIsSrcDummyv(), &v->getIncomingEdgev()});
+                isGatherDstVertexDummy[i].push_back(v->getIsSrcDummyv()[0]);
             } else {
                 auto mv = graph->mirrorVertex(dstId);
                 uint64_t mvTid = this->getVertexTid(dstId);
                 mirrorVertexPos[mvTid].push_back(dstId);
                 mirrorVertexVecs[i].push_back(mv);
-                std::vector<uint64_t>& cur_srcvv = mv->getSrcVertexv();
-                std::vector<bool>& cur_isSrcDummyv = mv->getIsSrcDummyv();
-                std::vector<EdgeWeightType>& cur_incomingEdgev = mv->getIncomingEdgev();
+                updateDsts[i].push_back({dstId, 0, &mv->getSrcVertexv(), &mv->getIsSrcDummyv(), &mv->getIncomingEdgev()});
+            }
+        }
+    }
+    parallel_for(0, tileNum, 1, [&](uint64_t begin, uint64_t end) {
+        for (uint64_t i=begin; i<end; ++i) {
+            for (const auto& dst : updateDsts[i]) {
+                const std::vector<uint64_t>& cur_srcvv = *dst.srcvv;
                 updateSrcVertexPos[i].insert(updateSrcVertexPos[i].end(), cur_srcvv.begin(), cur_srcvv.end());
-                updateDstVertexPos[i].insert(updateDstVertexPos[i].end(), cur_srcvv.size(), dstId);
+                updateDstVertexPos[i].insert(updateDstVertexPos[i].end(), cur_srcvv.size(), dst.dstId);
                 for (auto& x : cur_srcvv) updateSrcOutDeg[i].push_back(graph->vertex(x)->outDeg().cnt());
-                for (auto& x : cur_srcvv) updateDstInDeg[i].push_back(0);
-                isUpdateSrcVertexDummy[i].insert(isUpdateSrcVertexDummy[i].end(), cur_isSrcDummyv.begin(), cur_isSrcDummyv.end());
-                localEdgeWeightVecs[i].insert(localEdgeWeightVecs[i].end(), cur_incomingEdgev.begin(), cur_incomingEdgev.end());
+                updateDstInDeg[i].insert(updateDstInDeg[i].end(), cur_srcvv.size(), dst.inDeg);
+                isUpdateSrcVertexDummy[i].insert(isUpdateSrcVertexDummy[i].end(), dst.isSrcDummyv->begin(), dst.isSrcDummyv->end());
+                localEdgeWeightVecs[i].insert(localEdgeWeightVecs[i].end(), dst.incomingEdgev->begin(), dst.incomingEdgev->end());
             }
         }
-    }
+    });
 
     // Send mirrorVertexPos to the target party (use cs to avoid channel conflicts in TaskComm)
     for (int i=0; i<tileNum; ++i) {
@@ -535,6 +971,24 @@ onPreprocessClient(Ptr<GraphTileType>& graph, CommSyncType& cs, GraphSummary& gs
 
     if (!doOMPreprocess) return;
 
+    this->preprocessClientObliviousMapper(gs);
+}
+
+template<typename GraphTileType>
+void SSEdgeCentricAlgoKernel<GraphTileType>::
+preprocessClientObliviousMapper(GraphSummary& gs, const std::vector<bool>& isPeerChanged) const {
+    TaskComm& clientTaskComm = TaskComm::getClientInstance();
+    size_t tileNum = clientTaskComm.getTileNum();
+    size_t tileIndex = clientTaskComm.getTileIndex();
+    const auto tid = tileIndex;
+    uint64_t maxIters = gs.endIter;
+    uint64_t startIter = gs.startIter;
+    std::vector<uint64_t>& localVertexPos = gs.localVertexPos;
+    std::vector<std::vector<uint64_t>>& updateSrcVertexPos = gs.updateSrcVertexPos;
+    std::vector<std::vector<uint64_t>>& updateDstVertexPos = gs.updateDstVertexPos;
+    std::vector<std::vector<uint64_t>>& mirrorVertexPos = gs.mirrorVertexPos;
+    std::vector<std::vector<uint64_t>>& remoteMirrorVertexPos = gs.remoteMirrorVertexPos;
+
     // uint32_t plainNumPerOperand = getPlainNumPerOperand();
     std::vector<uint32_t> dimensions = getDimensionVec();
 
@@ -543,11 +997,11 @@ onPreprocessClient(Ptr<GraphTileType>& graph, CommSyncType& cs, GraphSummary& gs
     std::cout<<tid<<" "<<"Begin preprocessing oblivious mapper"<<std::endl;
     std::vector<std::thread> threads;
     for (int i=0; i<tileNum; ++i) {
-        if (i != tileIndex) {
-            threads.emplace_back([this, tileIndex, tileNum, i, maxIters, &localVertexPos, &updateSrcVertexPos, &updateDstVertexPos, &mirrorVertexPos, &remoteMirrorVertexPos, dimensions]() {
+        if (i != tileIndex && (isPeerChanged.empty() || isPeerChanged[i])) {
+            threads.emplace_back([this, tileIndex, tileNum, i, maxIters, startIter, &localVertexPos, &updateSrcVertexPos, &updateDstVertexPos, &mirrorVertexPos, &remoteMirrorVertexPos, dimensions]() {
                 uint32_t iter = 0;
                 uint64_t batchSize = 0;
-                for (iter=0; iter<maxIters; iter+=batchSize) {
+                for (iter=startIter; iter<maxIters; iter+=batchSize) {
                     std::cout<<tileIndex<<" "<<"Preprocessing oblivious mapper, iter "<<iter<<std::endl;
                     uint32_t preprocessId = 0;
 
@@ -614,20 +1068,754 @@ onPreprocessClient(Ptr<GraphTileType>& graph, CommSyncType& cs, GraphSummary& gs
 
 template<typename GraphTileType>
 void SSEdgeCentricAlgoKernel<GraphTileType>::
-onPreprocessServer(std::vector<std::thread>& threads, bool doOMPreprocess) const {
+topologyDelAll(Ptr<GraphTileType>& graph, GraphSummary& gs) const {
+    TaskComm& clientTaskComm = TaskComm::getClientInstance();
+    for (auto vIter = graph->vertexIter(); vIter != graph->vertexIterEnd(); ++vIter) {
+        auto v = vIter->second;
+        std::vector<bool>& cur_isSrcDummyv = v->getIsSrcDummyv();
+        // Take back the degree given to the dummy src of a zero incoming degree vertex.
+        if (clientTaskComm.getIsNoDummyEdge() && cur_isSrcDummyv.size() == 1 && cur_isSrcDummyv[0]) {
+            v->inDegDec();
+            v->outDegDec();
+        }
+        v->getSrcVertexv().clear();
+        v->getIncomingEdgev().clear();
+        cur_isSrcDummyv.clear();
+    }
+    for (auto mvIter = graph->mirrorVertexIter(); mvIter != graph->mirrorVertexIterEnd(); ++mvIter) {
+        auto mv = mvIter->second;
+        mv->getSrcVertexv().clear();
+        mv->getIncomingEdgev().clear();
+        mv->getIsSrcDummyv().clear();
+    }
+
+    gs.localVertexVec.clear();
+    gs.isLocalVertexBorder.clear();
+    for (auto& vec : gs.mirrorVertexVecs) vec.clear();
+    gs.localEdgeWeightVecs.clear();
+    gs.updateSrcOutDeg.clear();
+    gs.updateDstInDeg.clear();
+    gs.remoteUpdateDstInDeg.clear();
+    gs.localVertexInDeg.clear();
+    gs.isUpdateSrcVertexDummy.clear();
+    gs.isGatherDstVertexDummy.clear();
+    gs.updateSrcVertexPos.clear();
+    gs.updateDstVertexPos.clear();
+    gs.localVertexPos.clear();
+    gs.mirrorVertexPos.clear();
+    gs.remoteMirrorVertexPos.clear();
+    gs.remoteUpdateSvvs.clear();
+    gs.localUpdateSvvs.clear();
+}
+
+template<typename GraphTileType>
+void SSEdgeCentricAlgoKernel<GraphTileType>::
+onEdgeDelta(Ptr<GraphTileType>& graph, CommSyncType& cs, GraphSummary& gs,
+        std::vector<bool>& isPeerChanged, std::vector<bool>& isRemotePeerChanged) const {
+    TaskComm& clientTaskComm = TaskComm::getClientInstance();
+    TaskComm& serverTaskComm = TaskComm::getServerInstance();
+    size_t tileNum = clientTaskComm.getTileNum();
+    size_t tileIndex = clientTaskComm.getTileIndex();
+
+    // Positions of the topology the stored preprocessing was done for.
+    this->onPreprocessClient(graph, cs, gs, false);
+    std::vector<uint64_t> prevLocalVertexPos;
+    std::vector<std::vector<uint64_t>> prevUpdateSrcVertexPos;
+    std::vector<std::vector<uint64_t>> prevUpdateDstVertexPos;
+    std::vector<std::vector<uint64_t>> prevRemoteMirrorVertexPos;
+    prevLocalVertexPos.swap(gs.localVertexPos);
+    prevUpdateSrcVertexPos.swap(gs.updateSrcVertexPos);
+    prevUpdateDstVertexPos.swap(gs.updateDstVertexPos);
+    prevRemoteMirrorVertexPos.swap(gs.remoteMirrorVertexPos);
+    this->topologyDelAll(graph, gs);
+
+    auto t_edge_delta = std::chrono::high_resolution_clock::now();
+    GraphIOUtil::edgeDeltaFromFile(graph, tileIndex, edgeDeltaFile_, 1, edgeDeltaUndirected_, this->tidMap_);
+    print_duration(t_edge_delta, "edge_delta");
+
+    this->onPreprocessClient(graph, cs, gs, false);
+
+    // Only the tiles the delta touched can have new update src positions, the
+    // positions received from the peers are compared as a whole.
+    const std::set<TileIdx>& deltaTiles = graph->deltaTiles();
+    auto isUpdateSrcChanged = [&](size_t j) {
+        return deltaTiles.count(j) != 0 && gs.updateSrcVertexPos[j] != prevUpdateSrcVertexPos[j];
+    };
+    const bool isLocalChanged = (gs.localVertexPos != prevLocalVertexPos);
+    const bool isSelfChanged = isUpdateSrcChanged(tileIndex)
+            || (deltaTiles.count(tileIndex) != 0 && gs.updateDstVertexPos[tileIndex] != prevUpdateDstVertexPos[tileIndex]);
+    isPeerChanged.assign(tileNum, false);
+    for (int i=0; i<tileNum; ++i) {
+        if (i == tileIndex) continue;
+        isPeerChanged[i] = isLocalChanged || isUpdateSrcChanged(i)
+                || gs.remoteMirrorVertexPos[i] != prevRemoteMirrorVertexPos[i]
+                || (i == (tileIndex + 1) % tileNum && isSelfChanged);
+    }
+    graph->deltaTilesDelAll();
+
+    // Tell every peer whether the pair it serves for this party is preprocessed again.
+    for (int i=0; i<tileNum; ++i) {
+        if (i == tileIndex) continue;
+        clientTaskComm.sendShareVecVec(ShareVecVec(1, ShareVec(1, isPeerChanged[i]? 1 : 0)), i);
+    }
+    isRemotePeerChanged.assign(tileNum, false);
+    for (int i=0; i<tileNum; ++i) {
+        if (i == tileIndex) continue;
+        ShareVecVec msg;
+        serverTaskComm.recvShareVecVec(msg, i);
+        isRemotePeerChanged[i] = (msg[0][0] != 0);
+        printf("peer %d: client pair %s, server pair %s\n", i,
+                isPeerChanged[i]? "changed" : "unchanged", isRemotePeerChanged[i]? "changed" : "unchanged");
+    }
+}
+
+template<typename GraphTileType>
+void SSEdgeCentricAlgoKernel<GraphTileType>::
+dealMatMulTriples(GraphSummary& gs) const {
+    TaskComm& clientTaskComm = TaskComm::getClientInstance();
+    TaskComm& serverTaskComm = TaskComm::getServerInstance();
+    const size_t tileNum = clientTaskComm.getTileNum();
+    const size_t tileIndex = clientTaskComm.getTileIndex();
+    if (tileNum < 3) {
+        printf("Matmul triples need a third party as dealer, use the online matmul.\n");
+        return;
+    }
+    // The pair (c, c + 1) is dealt by c + 2.
+    const size_t dealer = (tileIndex + 2) % tileNum;
+    const size_t dealtClient = (tileIndex + tileNum - 2) % tileNum;
+    const size_t dealtServer = (tileIndex + tileNum - 1) % tileNum;
+
+    ShareVecVec shapeMsg;
+    for (uint64_t iter = gs.startIter; iter < gs.endIter; ++iter) {
+        for (const auto& shape : getIterMatMulShapes(gs, iter)) {
+            shapeMsg.push_back(matMulShapeMsg(shape));
+        }
+    }
+    clientTaskComm.sendShareVecVec(shapeMsg, dealer);
+    serverTaskComm.recvShareVecVec(shapeMsg, dealtClient);
+    // The one-sided input triples are dealt on the client's current input mask.
+    ShareVecVec maskMsg;
+    if (gs.isOneSidedInput) maskMsg.push_back(gs.localInputMask);
+    clientTaskComm.sendShareVecVec(maskMsg, dealer);
+    serverTaskComm.recvShareVecVec(maskMsg, dealtClient);
+    ShareVecVec mask;
+    ShareVecVec maskT;
+
+    // The seeded shares go first, the explicit server shares follow one by one
+    // so that only one product is held at a time.
+    ShareVecVec clientMsg(shapeMsg.size());
+    ShareVecVec serverMsg(shapeMsg.size());
+    std::vector<MatMulTriple> serverTriples(shapeMsg.size());
+    for (size_t t = 0; t < shapeMsg.size(); ++t) {
+        const MatMulShape shape = matMulShapeOf(shapeMsg[t]);
+        clientMsg[t] = matMulTripleMsg(newMatMulTriple(shape));
+        serverTriples[t] = newMatMulTriple(shape);
+        serverMsg[t] = matMulTripleMsg(serverTriples[t]);
+    }
+    clientTaskComm.sendShareVecVec(clientMsg, dealtClient);
+    clientTaskComm.sendShareVecVec(serverMsg, dealtServer);
+    for (size_t t = 0; t < shapeMsg.size(); ++t) {
+        MatMulTriple clientTriple = matMulTripleOf(clientMsg[t]);
+        if (clientTriple.shape.operand == MatMulOperand::Shared) {
+            dealMatMulTriple(clientTriple, serverTriples[t]);
+        } else {
+            if (maskMsg.empty()) throw InvalidArgumentException("One-sided matmul triple without an input mask");
+            if (mask.empty()) expandSeedShare(maskMsg[0], mask);
+            if (clientTriple.shape.operand == MatMulOperand::InputT && maskT.empty()) maskT = transpose(mask);
+            dealOneSidedMatMulTriple((clientTriple.shape.operand == MatMulOperand::Input)? mask : maskT,
+                    clientTriple, serverTriples[t]);
+        }
+        clientTaskComm.sendShareVecVec(serverTriples[t].z, dealtServer);
+        ShareVecVec().swap(serverTriples[t].z);
+    }
+
+    serverTaskComm.recvShareVecVec(clientMsg, dealer);
+    for (const auto& msg : clientMsg) {
+        MatMulTriple triple = matMulTripleOf(msg);
+        gs.localTriples.tripleNew(triple);
+    }
+    const size_t serverDealer = (tileIndex + 1) % tileNum;
+    serverTaskComm.recvShareVecVec(serverMsg, serverDealer);
+    for (const auto& msg : serverMsg) {
+        MatMulTriple triple = matMulTripleOf(msg);
+        serverTaskComm.recvShareVecVec(triple.z, serverDealer);
+        gs.remoteTriples.tripleNew(triple);
+    }
+    printf("%lu matmul triples dealt, %lu and %lu held\n", shapeMsg.size(),
+            gs.localTriples.tripleCount(), gs.remoteTriples.tripleCount());
+}
+
+template<typename GraphTileType>
+void SSEdgeCentricAlgoKernel<GraphTileType>::
+secureMatMul(GraphSummary& gs, const ShareTensor& a, const ShareTensor& b, ShareTensor& c, uint64_t coTid, int party) const {
+    TaskComm& clientTaskComm = TaskComm::getClientInstance();
+    const size_t tileNum = clientTaskComm.getTileNum();
+    const size_t tileIndex = clientTaskComm.getTileIndex();
+    const bool isClient = (party == sci::ALICE);
+    const bool isCoParty = isClient? (coTid == (tileIndex + 1) % tileNum) : ((coTid + 1) % tileNum == tileIndex);
+    MatMulTripleStore& triples = isClient? gs.localTriples : gs.remoteTriples;
+    MatMulTriple triple;
+    if (isCoParty && triples.tripleTake(matMulShapeOf(a, b), triple)) {
+        beaverMatMul(a, b, triple, c, isClient? clientTaskComm : TaskComm::getServerInstance(), coTid, isClient);
+        return;
+    }
+    sci::twoPartyGCNMatMul(a, b, c, coTid, party);
+}
+
+template<typename GraphTileType>
+void SSEdgeCentricAlgoKernel<GraphTileType>::
+secureInputMatMul(GraphSummary& gs, const ShareTensor& a, const ShareTensor& b, ShareTensor& c,
+        bool isTransposed, const std::vector<uint64_t>* rows, uint64_t coTid, int party) const {
+    TaskComm& clientTaskComm = TaskComm::getClientInstance();
+    const size_t tileNum = clientTaskComm.getTileNum();
+    const size_t tileIndex = clientTaskComm.getTileIndex();
+    const bool isClient = (party == sci::ALICE);
+    const bool isCoParty = isClient? (coTid == (tileIndex + 1) % tileNum) : ((coTid + 1) % tileNum == tileIndex);
+    if (!gs.isOneSidedInput || !isCoParty || (isTransposed && rows != nullptr)) {
+        secureMatMul(gs, a, b, c, coTid, party);
+        return;
+    }
+
+    const ShareVecVec& input = isClient? gs.localInputSvv : gs.remoteInputSvv;
+    const uint64_t n = input.size();
+    const uint64_t dim = input.empty()? 0 : input[0].size();
+    const uint64_t cols = b.empty()? 0 : b[0].size();
+    const MatMulShape shape = isTransposed? MatMulShape{dim, n, cols, MatMulOperand::InputT}
+        : MatMulShape{n, dim, cols, MatMulOperand::Input};
+    MatMulTripleStore& triples = isClient? gs.localTriples : gs.remoteTriples;
+    MatMulTriple triple;
+    if (!triples.tripleTake(shape, triple)) {
+        secureMatMul(gs, a, b, c, coTid, party);
+        return;
+    }
+
+    ShareVecVec sub;
+    const ShareVecVec* x = nullptr;
+    if (isClient) {
+        if (isTransposed) {
+            x = &gs.plan.localPlainInputT;
+        } else if (rows != nullptr) {
+            gatherRows(gs.localPlainInput, *rows, sub);
+            x = &sub;
+        } else {
+            x = &gs.localPlainInput;
+        }
+    }
+    oneSidedMatMul(x, a, b, triple, rows, c, isClient? clientTaskComm : TaskComm::getServerInstance(), coTid, isClient);
+}
+
+template<typename GraphTileType>
+void SSEdgeCentricAlgoKernel<GraphTileType>::
+coordinateResume(GraphSummary& gs) const {
+    TaskComm& clientTaskComm = TaskComm::getClientInstance();
+    TaskComm& serverTaskComm = TaskComm::getServerInstance();
+    const size_t tileNum = clientTaskComm.getTileNum();
+    const size_t tileIndex = clientTaskComm.getTileIndex();
+    GNNParam& gnnParam = GNNParam::getGNNParam();
+    gs.startIter = 0;
+    if (!gnnParam.resume) return;
+    if (gnnParam.checkpoint_dir.empty()) {
+        printf("Resume needs a checkpoint_dir, start from scratch.\n");
+        return;
+    }
+
+    // The iterations of the current and the previous checkpoint, 0 if absent or incomplete.
+    ShareVec iters(2, 0);
+    for (int k=0; k<2; ++k) {
+        Checkpoint ckpt;
+        if (readCheckpoint(checkpointPathOf(gnnParam.checkpoint_dir, tileIndex, k == 1), ckpt)
+                && ckpt.tileIndex == tileIndex && ckpt.tileNum == tileNum) {
+            iters[k] = ckpt.iter;
+        }
+    }
+    for (int i=0; i<tileNum; ++i) {
+        if (i != tileIndex) clientTaskComm.sendShareVecVec(ShareVecVec(1, iters), i);
+    }
+    std::vector<ShareVec> peerIters(tileNum, iters);
+    for (int i=0; i<tileNum; ++i) {
+        if (i == tileIndex) continue;
+        ShareVecVec msg;
+        serverTaskComm.recvShareVecVec(msg, i);
+        peerIters[i] = msg.empty()? ShareVec() : msg[0];
+    }
+
+    // The set of common iterations is the same on all parties, so is its maximum.
+    for (const auto candidate : iters) {
+        if (candidate <= gs.startIter) continue;
+        bool isCommon = true;
+        for (const auto& peer : peerIters) {
+            isCommon = isCommon && std::find(peer.begin(), peer.end(), candidate) != peer.end();
+        }
+        if (isCommon) gs.startIter = candidate;
+    }
+    printf("%lu resume from iteration %lu\n", tileIndex, gs.startIter);
+}
+
+template<typename GraphTileType>
+void SSEdgeCentricAlgoKernel<GraphTileType>::
+restoreCheckpoint(GraphSummary& gs) const {
+    const size_t tileIndex = TaskComm::getClientInstance().getTileIndex();
+    GNNParam& gnnParam = GNNParam::getGNNParam();
+    Checkpoint ckpt;
+    bool isFound = false;
+    for (int k=0; k<2 && !isFound; ++k) {
+        isFound = readCheckpoint(checkpointPathOf(gnnParam.checkpoint_dir, tileIndex, k == 1), ckpt) && ckpt.iter == gs.startIter;
+    }
+    if (!isFound) {
+        throw FileException("checkpoint of iteration " + std::to_string(gs.startIter));
+    }
+    if (ckpt.localWeight.size() != gs.localWeight.size() || ckpt.remoteWeight.size() != gs.remoteWeight.size()) {
+        throw RangeException("Checkpoint layers differ from the model");
+    }
+    for (size_t l=0; l<gs.localWeight.size(); ++l) {
+        if (!isSameTensorShape(ckpt.localWeight[l], gs.localWeight[l]) || !isSameTensorShape(ckpt.remoteWeight[l], gs.remoteWeight[l])) {
+            throw RangeException("Checkpoint weight shapes differ from the model");
+        }
+    }
+    gs.localWeight.swap(ckpt.localWeight);
+    gs.remoteWeight.swap(ckpt.remoteWeight);
+}
+
+template<typename GraphTileType>
+bool SSEdgeCentricAlgoKernel<GraphTileType>::
+isCheckpointIter(const GraphSummary& gs, uint64_t iter) const {
+    GNNParam& gnnParam = GNNParam::getGNNParam();
+    if (gnnParam.checkpoint_dir.empty() || gnnParam.checkpoint_interval <= 0) return false;
+    // Only at epoch ends, where no activation is live and the weights are averaged.
+    const uint64_t epochLayerNum = getForwardLayerNum() + getBackwardLayerNum();
+    if (iter % epochLayerNum != 0) return false;
+    return (iter / epochLayerNum) % gnnParam.checkpoint_interval == 0 || iter == gs.endIter;
+}
+
+template<typename GraphTileType>
+void SSEdgeCentricAlgoKernel<GraphTileType>::
+saveCheckpoint(GraphSummary& gs, uint64_t iter) const {
+    TaskComm& clientTaskComm = TaskComm::getClientInstance();
+    GNNParam& gnnParam = GNNParam::getGNNParam();
+    if (!this->isCheckpointIter(gs, iter)) return;
+
+    auto t_checkpoint = std::chrono::high_resolution_clock::now();
+    writeCheckpoint(gnnParam.checkpoint_dir, {clientTaskComm.getTileIndex(), clientTaskComm.getTileNum(), iter, gs.localWeight, gs.remoteWeight});
+    print_duration(t_checkpoint, "checkpoint");
+}
+
+template<typename GraphTileType>
+void SSEdgeCentricAlgoKernel<GraphTileType>::
+computeFrontier(Ptr<GraphTileType>& graph, GraphSummary& gs) const {
+    TaskComm& clientTaskComm = TaskComm::getClientInstance();
+    TaskComm& serverTaskComm = TaskComm::getServerInstance();
+    const size_t tileNum = clientTaskComm.getTileNum();
+    const size_t tileIndex = clientTaskComm.getTileIndex();
+    const uint32_t forwardLayerNum = getForwardLayerNum();
+
+    std::unordered_map<uint64_t, uint64_t> rowOfVid;
+    for (uint64_t i=0; i<gs.localVertexVec.size(); ++i) {
+        rowOfVid[(uint64_t)gs.localVertexVec[i]->vid()] = i;
+    }
+    std::vector<bool> isReached(gs.localVertexVec.size(), false);
+    for (const auto vid : changedVertices_) {
+        auto iter = rowOfVid.find(vid);
+        if (iter != rowOfVid.end()) isReached[iter->second] = true;
+    }
+    auto isSrcReached = [&rowOfVid](const std::vector<bool>& isReached, const std::vector<uint64_t>& srcs, const std::vector<bool>& isDummy) {
+        for (uint64_t k=0; k<srcs.size(); ++k) {
+            if (k < isDummy.size() && isDummy[k]) continue;
+            auto iter = rowOfVid.find(srcs[k]);
+            if (iter != rowOfVid.end() && isReached[iter->second]) return true;
+        }
+        return false;
+    };
+
+    gs.localFrontierRows.assign(forwardLayerNum + 1, std::vector<uint64_t>());
+    for (uint32_t layer=0; ; ++layer) {
+        for (uint64_t i=0; i<isReached.size(); ++i) {
+            if (isReached[i]) gs.localFrontierRows[layer].push_back(i);
+        }
+        if (layer == forwardLayerNum) break;
+
+        // One hop further, the out-neighbors are own vertices or mirrors of the peers'.
+        const std::vector<bool> isPrevReached = isReached;
+        for (uint64_t i=0; i<gs.localVertexVec.size(); ++i) {
+            auto& v = gs.localVertexVec[i];
+            if (!isReached[i] && isSrcReached(isPrevReached, v->getSrcVertexv(), v->getIsSrcDummyv())) isReached[i] = true;
+        }
+        std::vector<ShareVecVec> reachedVids(tileNum, ShareVecVec(1));
+        for (auto mvIter = graph->mirrorVertexIter(); mvIter != graph->mirrorVertexIterEnd(); ++mvIter) {
+            auto mv = mvIter->second;
+            if (isSrcReached(isPrevReached, mv->getSrcVertexv(), mv->getIsSrcDummyv())) {
+                const uint64_t mvid = (uint64_t)mv->vid();
+                reachedVids[this->getVertexTid(mvid)][0].push_back(mvid);
+            }
+        }
+        for (int i=0; i<tileNum; ++i) {
+            if (i != tileIndex) clientTaskComm.sendShareVecVec(reachedVids[i], i);
+        }
+        for (int i=0; i<tileNum; ++i) {
+            if (i == tileIndex) continue;
+            ShareVecVec msg;
+            serverTaskComm.recvShareVecVec(msg, i);
+            for (const auto vid : msg.empty()? ShareVec() : msg[0]) {
+                auto iter = rowOfVid.find(vid);
+                if (iter != rowOfVid.end()) isReached[iter->second] = true;
+            }
+        }
+    }
+
+    this->exchangeFrontierRows(gs);
+    printf("%lu frontier of %lu changed vertices: %lu of %lu rows at the output\n", tileIndex,
+            changedVertices_.size(), gs.localFrontierRows[forwardLayerNum].size(), gs.localVertexVec.size());
+}
+
+template<typename GraphTileType>
+void SSEdgeCentricAlgoKernel<GraphTileType>::
+exchangeFrontierRows(GraphSummary& gs) const {
+    TaskComm& clientTaskComm = TaskComm::getClientInstance();
+    TaskComm& serverTaskComm = TaskComm::getServerInstance();
+    const size_t tileNum = clientTaskComm.getTileNum();
+    const size_t tileIndex = clientTaskComm.getTileIndex();
+    // The co-party computes on the same rows.
+    const uint64_t prevTid = (tileIndex + tileNum - 1) % tileNum;
+    clientTaskComm.sendShareVecVec(gs.localFrontierRows, (tileIndex + 1) % tileNum);
+    serverTaskComm.recvShareVecVec(gs.remoteFrontierRows, prevTid);
+    if (gs.remoteFrontierRows.size() != gs.localFrontierRows.size()) {
+        throw RangeException("Unmatched frontier layers of party " + std::to_string(prevTid));
+    }
+}
+
+template<typename GraphTileType>
+void SSEdgeCentricAlgoKernel<GraphTileType>::
+classifyReceptiveFields(Ptr<GraphTileType>& graph, GraphSummary& gs) const {
+    TaskComm& clientTaskComm = TaskComm::getClientInstance();
+    TaskComm& serverTaskComm = TaskComm::getServerInstance();
+    const size_t tileNum = clientTaskComm.getTileNum();
+    const size_t tileIndex = clientTaskComm.getTileIndex();
+    const uint32_t forwardLayerNum = getForwardLayerNum();
+    const uint64_t n = gs.localVertexVec.size();
+
+    std::unordered_map<uint64_t, uint64_t> rowOfVid;
+    for (uint64_t i=0; i<n; ++i) rowOfVid[(uint64_t)gs.localVertexVec[i]->vid()] = i;
+    std::unordered_map<uint64_t, Ptr<MirrorVertexType>> mirrorOfVid;
+    std::vector<ShareVecVec> mirroredVids(tileNum, ShareVecVec(1));
+    for (auto mvIter = graph->mirrorVertexIter(); mvIter != graph->mirrorVertexIterEnd(); ++mvIter) {
+        auto mv = mvIter->second;
+        const uint64_t mvid = (uint64_t)mv->vid();
+        mirrorOfVid[mvid] = mv;
+        mirroredVids[this->getVertexTid(mvid)][0].push_back(mvid);
+    }
+    // Mark the rows of the local non-dummy sources of a vertex.
+    auto srcRowsMark = [&rowOfVid](const std::vector<uint64_t>& srcs, const std::vector<bool>& isDummy, std::vector<bool>& isMarked) {
+        for (uint64_t k=0; k<srcs.size(); ++k) {
+            if (k < isDummy.size() && isDummy[k]) continue;
+            auto iter = rowOfVid.find(srcs[k]);
+            if (iter != rowOfVid.end()) isMarked[iter->second] = true;
+        }
+    };
+    auto allToAll = [&](const std::vector<ShareVecVec>& msgs, std::vector<ShareVec>& recvVids) {
+        for (int i=0; i<tileNum; ++i) {
+            if (i != tileIndex) clientTaskComm.sendShareVecVec(msgs[i], i);
+        }
+        recvVids.assign(tileNum, ShareVec());
+        for (int i=0; i<tileNum; ++i) {
+            if (i == tileIndex) continue;
+            ShareVecVec msg;
+            serverTaskComm.recvShareVecVec(msg, i);
+            if (!msg.empty()) recvVids[i].swap(msg[0]);
+        }
+    };
+
+    // The vertices the peers mirror have in-neighbors there, the others take
+    // one more layer per local hop to be reached.
+    std::vector<ShareVec> peerMirroredVids;
+    allToAll(mirroredVids, peerMirroredVids);
+    std::vector<bool> isNonLocal(n, false);
+    for (const auto& vids : peerMirroredVids) {
+        for (const auto vid : vids) {
+            auto iter = rowOfVid.find(vid);
+            if (iter != rowOfVid.end()) isNonLocal[iter->second] = true;
+        }
+    }
+    for (uint32_t hop=1; hop<forwardLayerNum; ++hop) {
+        // A vertex is reached if any of its local sources was non-local at the previous hop.
+        std::vector<bool> isReached = isNonLocal;
+        for (uint64_t i=0; i<n; ++i) {
+            auto& v = gs.localVertexVec[i];
+            const auto& srcs = v->getSrcVertexv();
+            const auto& isDummy = v->getIsSrcDummyv();
+            for (uint64_t k=0; k<srcs.size() && !isReached[i]; ++k) {
+                if (k < isDummy.size() && isDummy[k]) continue;
+                auto iter = rowOfVid.find(srcs[k]);
+                if (iter != rowOfVid.end() && isNonLocal[iter->second]) isReached[i] = true;
+            }
+        }
+        isNonLocal.swap(isReached);
+    }
+    gs.isLocalField.assign(n, false);
+    for (uint64_t i=0; i<n; ++i) gs.isLocalField[i] = !isNonLocal[i];
+
+    // The non-local vertices are predicted securely, every layer needs the rows of
+    // the sources of the rows the next one needs.
+    gs.localFrontierRows.assign(forwardLayerNum + 1, std::vector<uint64_t>());
+    std::vector<bool> isNeeded = isNonLocal;
+    for (uint32_t layer=forwardLayerNum; ; --layer) {
+        for (uint64_t i=0; i<n; ++i) {
+            if (isNeeded[i]) gs.localFrontierRows[layer].push_back(i);
+        }
+        if (layer == 0) break;
+
+        std::vector<ShareVecVec> neededVids(tileNum, ShareVecVec(1));
+        std::vector<bool> isPrevNeeded = isNeeded;
+        for (const auto i : gs.localFrontierRows[layer]) {
+            auto& v = gs.localVertexVec[i];
+            srcRowsMark(v->getSrcVertexv(), v->getIsSrcDummyv(), isPrevNeeded);
+        }
+        // Only the peers mirroring a needed vertex hold sources of it.
+        for (int j=0; j<tileNum; ++j) {
+            for (const auto vid : peerMirroredVids[j]) {
+                if (isNeeded[rowOfVid.at(vid)]) neededVids[j][0].push_back(vid);
+            }
+        }
+        std::vector<ShareVec> peerNeededVids;
+        allToAll(neededVids, peerNeededVids);
+        for (const auto& vids : peerNeededVids) {
+            for (const auto vid : vids) {
+                auto iter = mirrorOfVid.find(vid);
+                if (iter != mirrorOfVid.end()) srcRowsMark(iter->second->getSrcVertexv(), iter->second->getIsSrcDummyv(), isPrevNeeded);
+            }
+        }
+        isNeeded.swap(isPrevNeeded);
+    }
+    gs.isFrontierOnly = true;
+    this->exchangeFrontierRows(gs);
+
+    printf("%lu receptive fields: %lu of %lu vertices local, %lu rows of the first layer computed securely\n", tileIndex,
+            n - gs.localFrontierRows[forwardLayerNum].size(), n, gs.localFrontierRows[0].size());
+}
+
+template<typename GraphTileType>
+void SSEdgeCentricAlgoKernel<GraphTileType>::
+revealWeights(GraphSummary& gs, std::vector<DoubleTensor>& plainWeight) const {
+    TaskComm& clientTaskComm = TaskComm::getClientInstance();
+    TaskComm& serverTaskComm = TaskComm::getServerInstance();
+    const size_t tileNum = clientTaskComm.getTileNum();
+    const size_t tileIndex = clientTaskComm.getTileIndex();
+
+    serverTaskComm.sendShareTensorVec(gs.remoteWeight, (tileIndex + tileNum - 1) % tileNum);
+    ShareTensorVec coWeight;
+    clientTaskComm.recvShareTensorVec(coWeight, (tileIndex + 1) % tileNum);
+    if (coWeight.size() != gs.localWeight.size()) throw RangeException("Unmatched revealed weight layers");
+
+    CryptoUtil& cryptoUtil = CryptoUtil::getInstance();
+    plainWeight.resize(gs.localWeight.size());
+    for (size_t l=0; l<gs.localWeight.size(); ++l) {
+        const ShareTensor& w = gs.localWeight[l];
+        if (!isSameTensorShape(w, coWeight[l])) throw RangeException("Unmatched revealed weight shapes");
+        plainWeight[l].assign(w.size(), std::vector<double>());
+        for (size_t i=0; i<w.size(); ++i) {
+            plainWeight[l][i].resize(w[i].size());
+            for (size_t j=0; j<w[i].size(); ++j) {
+                plainWeight[l][i][j] = cryptoUtil.template decodeFixedPointAs<double>(w[i][j] + coWeight[l][i][j]);
+            }
+        }
+    }
+}
+
+template<typename GraphTileType>
+void SSEdgeCentricAlgoKernel<GraphTileType>::
+applyInputDelta(GraphSummary& gs) const {
+    TaskComm& clientTaskComm = TaskComm::getClientInstance();
+    TaskComm& serverTaskComm = TaskComm::getServerInstance();
+    const size_t tileNum = clientTaskComm.getTileNum();
+    const size_t tileIndex = clientTaskComm.getTileIndex();
+    const std::vector<uint64_t>& rows = gs.localFrontierRows[0];
+
+    ShareVecVec svv0;
+    ShareVecVec svv1;
+    if (!this->getVertexDataRowsShare(gs, rows, svv0, svv1)) {
+        throw InvalidArgumentException("Incremental inference is not supported by " + this->name());
+    }
+    // Keep the transposed input of the execution plan in step.
+    auto transposeInto = [](const ShareVecVec& sub, const std::vector<uint64_t>& rows, ShareTensor& xT) {
+        for (uint64_t k=0; k<rows.size(); ++k) {
+            for (uint64_t j=0; j<sub[k].size() && j<xT.size(); ++j) xT[j][rows[k]] = sub[k][j];
+        }
+    };
+
+    if (gs.isOneSidedInput) {
+        // svv0 holds the new plaintext rows. Under the old mask the co-party could
+        // tell which rows changed and by how much, so the whole input is masked anew.
+        scatterRows(svv0, rows, gs.localPlainInput);
+        transposeInto(svv0, rows, gs.plan.localPlainInputT);
+        this->maskOneSidedInput(gs, svv1);
+        clientTaskComm.sendShareVecVec(svv1, (tileIndex + 1) % tileNum);
+        ShareVecVec().swap(svv1);
+        serverTaskComm.recvShareVecVec(gs.remoteInputSvv, (tileIndex + tileNum - 1) % tileNum);
+        gs.plan.localInputT = transpose(gs.localInputSvv);
+        gs.plan.remoteInputT = transpose(gs.remoteInputSvv);
+        return;
+    }
+
+    scatterRows(svv0, rows, gs.localInputSvv);
+    clientTaskComm.sendShareVecVec(svv1, (tileIndex + 1) % tileNum);
+    ShareVecVec().swap(svv1);
+    serverTaskComm.recvShareVecVec(svv1, (tileIndex + tileNum - 1) % tileNum);
+    scatterRows(svv1, gs.remoteFrontierRows[0], gs.remoteInputSvv);
+
+    transposeInto(svv0, rows, gs.plan.localInputT);
+    transposeInto(svv1, gs.remoteFrontierRows[0], gs.plan.remoteInputT);
+}
+
+template<typename GraphTileType>
+void SSEdgeCentricAlgoKernel<GraphTileType>::
+revealPredictionRows(GraphSummary& gs, const std::vector<uint64_t>& rows, DoubleTensor& plain) const {
+    TaskComm& clientTaskComm = TaskComm::getClientInstance();
+    TaskComm& serverTaskComm = TaskComm::getServerInstance();
+    const size_t tileNum = clientTaskComm.getTileNum();
+    const size_t tileIndex = clientTaskComm.getTileIndex();
+    const uint64_t nextTid = (tileIndex + 1) % tileNum;
+    const uint64_t prevTid = (tileIndex + tileNum - 1) % tileNum;
+    const uint32_t layer = getForwardLayerNum() - 1;
+
+    clientTaskComm.sendShareVecVec(ShareVecVec(1, ShareVec(rows.begin(), rows.end())), nextTid);
+
+    // Only the rows of its own vertices are revealed to the previous party.
+    ShareVecVec peerRows;
+    serverTaskComm.recvShareVecVec(peerRows, prevTid);
+    const ShareTensor& remoteP = gs.remoteActivations.tensor(layer, ActivationKind::P);
+    ShareVecVec peerShares;
+    for (const auto row : peerRows.empty()? ShareVec() : peerRows[0]) {
+        if (row >= remoteP.size()) throw RangeException("Prediction row " + std::to_string(row));
+        peerShares.push_back(remoteP[row]);
+    }
+    serverTaskComm.sendShareVecVec(peerShares, prevTid);
+
+    ShareVecVec coShares;
+    clientTaskComm.recvShareVecVec(coShares, nextTid);
+    if (coShares.size() != rows.size()) throw RangeException("Unmatched prediction rows");
+    const ShareTensor& localP = gs.localActivations.tensor(layer, ActivationKind::P);
+    CryptoUtil& cryptoUtil = CryptoUtil::getInstance();
+    plain.assign(rows.size(), std::vector<double>());
+    for (uint64_t k=0; k<rows.size(); ++k) {
+        const ShareVec& share = localP[rows[k]];
+        plain[k].resize(share.size());
+        for (uint64_t j=0; j<share.size(); ++j) {
+            plain[k][j] = cryptoUtil.template decodeFixedPointAs<double>(share[j] + coShares[k][j]);
+        }
+    }
+}
+
+template<typename GraphTileType>
+void SSEdgeCentricAlgoKernel<GraphTileType>::
+serveQueries(QueryServer& server, uint32_t windowMs) const {
+    TaskComm& clientTaskComm = TaskComm::getClientInstance();
+    TaskComm& serverTaskComm = TaskComm::getServerInstance();
+    const size_t tileNum = clientTaskComm.getTileNum();
+    const size_t tileIndex = clientTaskComm.getTileIndex();
+    if (session_ == nullptr || !session_->isStarted) {
+        throw InvalidArgumentException("Serving needs the predictions of a finished session");
+    }
+    GraphSummary& gs = session_->gs;
+    const uint32_t layer = getForwardLayerNum() - 1;
+
+    std::unordered_map<uint64_t, uint64_t> rowOfVid;
+    const uint64_t rowNum = gs.localActivations.tensor(layer, ActivationKind::P).size();
+    for (uint64_t i=0; i<gs.localVertexVec.size() && i<rowNum; ++i) {
+        rowOfVid[(uint64_t)gs.localVertexVec[i]->vid()] = i;
+    }
+    printf("%lu serve %lu vertices\n", tileIndex, rowOfVid.size());
+
+    bool isShutdown = false;
+    while (!isShutdown) {
+        std::vector<QueryRequest> batch = server.requestBatchTake(windowMs);
+
+        // The rows of the batch, each once however many requests ask for it.
+        std::vector<uint64_t> rows;
+        std::unordered_map<uint64_t, uint64_t> posOfRow;
+        for (const auto& request : batch) {
+            for (const auto vid : request.vids) {
+                auto iter = rowOfVid.find(vid);
+                if (iter != rowOfVid.end() && posOfRow.emplace(iter->second, rows.size()).second) {
+                    rows.push_back(iter->second);
+                }
+            }
+        }
+
+        // Every party takes part in every round, so all stop in the same one and
+        // all skip the reveal of a round no party has rows in.
+        isShutdown = server.isShutdownRequested();
+        bool hasRows = !rows.empty();
+        for (int i=0; i<tileNum; ++i) {
+            if (i != tileIndex) clientTaskComm.sendShareVecVec(ShareVecVec(1, ShareVec{isShutdown, hasRows}), i);
+        }
+        for (int i=0; i<tileNum; ++i) {
+            if (i == tileIndex) continue;
+            ShareVecVec msg;
+            serverTaskComm.recvShareVecVec(msg, i);
+            if (msg.empty() || msg[0].size() != 2) throw RangeException("Malformed serving round message");
+            isShutdown = isShutdown || msg[0][0] != 0;
+            hasRows = hasRows || msg[0][1] != 0;
+        }
+
+        DoubleTensor plain;
+        if (hasRows) this->revealPredictionRows(gs, rows, plain);
+
+        for (auto& request : batch) {
+            std::vector<std::string> lines;
+            for (const auto vid : request.vids) {
+                std::string line = std::to_string(vid);
+                auto iter = rowOfVid.find(vid);
+                if (iter == rowOfVid.end()) {
+                    // Point the client to the owner, see query_server.h.
+                    auto tidIter = this->tidMap_.find(vid);
+                    line += (tidIter == this->tidMap_.end())? " none" : " at " + std::to_string((uint64_t)tidIter->second);
+                } else {
+                    for (const auto value : plain[posOfRow[iter->second]]) line += " " + std::to_string(value);
+                }
+                lines.push_back(line);
+            }
+            server.requestDone(request, lines);
+        }
+    }
+}
+
+template<typename GraphTileType>
+void SSEdgeCentricAlgoKernel<GraphTileType>::
+buildExecutionPlan(GraphSummary& gs) const {
+    TaskComm& clientTaskComm = TaskComm::getClientInstance();
+    size_t tileNum = clientTaskComm.getTileNum();
+    ExecutionPlan& plan = gs.plan;
+
+    plan.localGatherCond.resize(tileNum);
+    for (int j=0; j<tileNum; ++j) {
+        const std::vector<bool>& isDummy = gs.isGatherDstVertexDummy[j];
+        plan.localGatherCond[j].resize(isDummy.size());
+        for (uint64_t m=0; m<isDummy.size(); ++m) plan.localGatherCond[j][m] = !isDummy[m];
+    }
+
+    const uint32_t epochLayerNum = getForwardLayerNum() + getBackwardLayerNum();
+    plan.plainNumPerOperand.resize(epochLayerNum);
+    for (uint32_t layer=0; layer<epochLayerNum; ++layer) {
+        plan.plainNumPerOperand[layer] = getPlainNumPerOperand(layer);
+    }
+
+    this->onExecutionPlanBuild(gs);
+}
+
+template<typename GraphTileType>
+void SSEdgeCentricAlgoKernel<GraphTileType>::
+onPreprocessServer(std::vector<std::thread>& threads, bool doOMPreprocess, const std::vector<bool>& isPeerChanged, uint64_t startIter, uint64_t endIter) const {
     if (!doOMPreprocess) return;
 	TaskComm& serverTaskComm = TaskComm::getServerInstance();
 	size_t tileNum = serverTaskComm.getTileNum();
 	size_t tileIndex = serverTaskComm.getTileIndex();
-    uint64_t maxIters = this->maxIters().cnt();
+    uint64_t maxIters = std::min<uint64_t>(endIter, startIter + this->maxIters().cnt());
     std::vector<uint32_t> dimensions = getDimensionVec();
 
 	for (int i = 0; i < tileNum; i++) {
-		if (i != tileIndex) {
-			threads.emplace_back([this, i, &serverTaskComm, dimensions, tileIndex, tileNum, maxIters]() {
+		if (i != tileIndex && (isPeerChanged.empty() || isPeerChanged[i])) {
+			threads.emplace_back([this, i, &serverTaskComm, dimensions, tileIndex, tileNum, maxIters, startIter]() {
                 uint32_t iter = 0;
                 uint64_t batchSize = 0;
-                for (iter=0; iter<maxIters; iter+=batchSize) {
+                for (iter=startIter; iter<maxIters; iter+=batchSize) {
                     uint32_t preprocessId = 0;
 
                     // Oblivious Mapper
@@ -687,12 +1875,12 @@ onIteration(Ptr<GraphTileType>& graph, CommSyncType& cs, GraphSummary& gs, const
     size_t tileNum = clientTaskComm.getTileNum();
     size_t tileIndex = clientTaskComm.getTileIndex();
 
-    uint32_t plainNumPerOperand = getPlainNumPerOperand(iter.cnt());
+    uint32_t plainNumPerOperand = gs.plan.plainNumPerOperandOf(iter.cnt());
 
     const uint32_t forwardLayerNum = getForwardLayerNum();
     const uint32_t backwardLayerNum = getBackwardLayerNum();
     const uint32_t epochLayerNum = forwardLayerNum + backwardLayerNum;
-    if (iter % epochLayerNum == 0) gs.localVertexSvv = gs.localVertexSvvBackup; // Go back to the first layer
+    const bool isFirstLayer = (iter % epochLayerNum == 0);
 
     std::cout<<tid<<" "<<"Begin Scatter task generation"<<std::endl;
     
@@ -701,7 +1889,7 @@ onIteration(Ptr<GraphTileType>& graph, CommSyncType& cs, GraphSummary& gs, const
     bar_t barrier(tileNum - 1);
     for (int i=0; i<tileNum; ++i) {
         if (i != tileIndex) {
-            threads.emplace_back([this, i, tileIndex, tileNum, forwardLayerNum, backwardLayerNum, epochLayerNum, plainNumPerOperand, &gs, &updateSrcs, &clientTaskComm, &serverTaskComm, &iter, &barrier, &graph](){
+            threads.emplace_back([this, i, tileIndex, tileNum, forwardLayerNum, backwardLayerNum, epochLayerNum, plainNumPerOperand, isFirstLayer, &gs, &updateSrcs, &clientTaskComm, &serverTaskComm, &iter, &barrier, &graph](){
 
                 uint32_t preprocessId = 0;
 
@@ -733,9 +1921,10 @@ onIteration(Ptr<GraphTileType>& graph, CommSyncType& cs, GraphSummary& gs, const
 
                 if (i == (tileIndex + 1) % tileNum) {
                     auto t_PreScatterComp = std::chrono::high_resolution_clock::now();
+                    // The first layer starts over from the input, no need to restore it per epoch.
                     PreScatterComp(
                         gs,
-                        gs.localVertexSvv, 
+                        isFirstLayer? gs.localInputSvv : gs.localVertexSvv, 
                         gs.localVertexInDeg, 
                         gs.localVertexSvv,
                         iter.cnt(),
@@ -870,14 +2059,8 @@ onIteration(Ptr<GraphTileType>& graph, CommSyncType& cs, GraphSummary& gs, const
                             printf("Client Unmatched update num and vertex num during cooperation! %lld %d tile num %d j = %d\n", gatherTaskNum, gs.localUpdateSvvs[j].size(), tileNum, j);
                             exit(-1);
                         }
-
-                        GatherComp(gs.localVertexSvv, gs.localUpdateSvvs[j], gs.isGatherDstVertexDummy[j], gs.localVertexInDeg, iter.cnt(), j, i, sci::ALICE);
-
-                        // if (j == 1 && i == 0)
-                        //     for (uint64_t m=0; m<gatherTaskNum; ++m) {
-                        //         std::cout<<"2Here "<<m<<" "<<gs.localVertexPos[m]<<" "<<gs.localVertexSvv[m][0]<<" "<<gs.localVertexSvv[m][1]<<" "<<gs.isGatherDstVertexDummy[j][m]<<std::endl;
-                        //     }
                     }
+                    GatherAllComp(gs, gs.localVertexSvv, gs.localUpdateSvvs, gs.localVertexInDeg, iter.cnt(), i, sci::ALICE);
                     print_duration(t_Gather_computation, "Gather_computation");
 
                     auto t_Apply_computation = std::chrono::high_resolution_clock::now();
@@ -910,7 +2093,7 @@ onIteration(Ptr<GraphTileType>& graph, CommSyncType& cs, GraphSummary& gs, const
 }
 
 template<typename GraphTileType>
-void SSEdgeCentricAlgoKernel<GraphTileType>::runAlgoKernelServer(std::vector<std::thread>& threads, Ptr<GraphTileType>& graph, CommSyncType& cs, GraphSummary& gs) const {
+void SSEdgeCentricAlgoKernel<GraphTileType>::runAlgoKernelServer(std::vector<std::thread>& threads, Ptr<GraphTileType>& graph, CommSyncType& cs, GraphSummary& gs, progress_t& serverProgress) const {
 	TaskComm& clientTaskComm = TaskComm::getClientInstance();
     TaskComm& serverTaskComm = TaskComm::getServerInstance();
 	size_t tileNum = serverTaskComm.getTileNum();
@@ -925,24 +2108,25 @@ void SSEdgeCentricAlgoKernel<GraphTileType>::runAlgoKernelServer(std::vector<std
     bar_t barrier(tileNum - 1);
 	for (int i = 0; i < tileNum; i++) {
 		if (i != tileIndex) {
-			threads.emplace_back([this, i, &serverTaskComm, &clientTaskComm, &cs, &gs, &barrier, &graph, tileIndex, tileNum, maxIters, forwardLayerNum, backwardLayerNum, epochLayerNum]() {
+			threads.emplace_back([this, i, &serverTaskComm, &clientTaskComm, &cs, &gs, &barrier, &serverProgress, &graph, tileIndex, tileNum, maxIters, forwardLayerNum, backwardLayerNum, epochLayerNum]() {
 
-                uint64_t iter = 0;
+                uint64_t iter = gs.startIter;
+                const size_t progressIndex = (i + tileNum - tileIndex - 1) % tileNum;
                 TaskqHandlerConfig& thc = serverTaskComm.getTaskqHandlerConfig(i);
                 thc.sendOperand = false;
                 thc.mergeResult = false;
                 thc.sendTaskqDigest = false;
                 std::vector<Task>& taskv = serverTaskComm.getTaskv(i);
-                while (iter < maxIters) { // On iteration
+                std::vector<uint64_t> zeroPosVec;
+                while (iter < gs.endIter) { // On iteration
                     // set_up_mpc_channel(false, i);
-                    if (iter %  epochLayerNum == 0) gs.remoteVertexSvvs[i] = gs.remoteVertexSvvsBackup[i]; // Go back to the first layer
-
                     // At the first layer of backward pass, we only do apply.
                     if (iter % epochLayerNum != 0 && (iter % epochLayerNum) % forwardLayerNum == 0) {
                         printf("At the first layer of backward pass (iter %lu), we only do apply.\n", iter);
                         if (tileIndex != (i + 1) % tileNum) {
                             cs.recvShareVecVec(gs.remoteVertexSvvs[i], (i + 1) % tileNum, tileIndex);
                             iter++;
+                            serverProgress.countIs(progressIndex, iter);
                             continue;
                         } else {
                             std::cout<<"Compute Gather Taskv, "<<tileIndex<<" Server, "<<"iter: "<<iter<<" "<<i<<std::endl;
@@ -950,12 +2134,11 @@ void SSEdgeCentricAlgoKernel<GraphTileType>::runAlgoKernelServer(std::vector<std
 
                             // Apply
                             ShareVecVec curResult;
-                            std::vector<uint64_t> zeroDeg(gs.remoteVertexSvvs[i].size(), 0);
                             ApplyComp(
                                 gs, 
                                 iter, 
                                 gs.remoteVertexSvvs[i], 
-                                zeroDeg,
+                                gs.plan.zeroVec(gs.remoteVertexSvvs[i].size()),
                                 curResult, 
                                 tileIndex,
                                 i, 
@@ -975,6 +2158,7 @@ void SSEdgeCentricAlgoKernel<GraphTileType>::runAlgoKernelServer(std::vector<std
                         }
                         
                         iter++;
+                        serverProgress.countIs(progressIndex, iter);
                         continue;
                     }
 
@@ -982,11 +2166,11 @@ void SSEdgeCentricAlgoKernel<GraphTileType>::runAlgoKernelServer(std::vector<std
                         cs.recvShareVecVec(gs.remoteVertexSvvs[i], (i + 1) % tileNum, tileIndex);
                     } else {
                         auto t_PreScatterComp = std::chrono::high_resolution_clock::now();
-                        std::vector<uint64_t> zeroDeg(gs.remoteVertexSvvs[i].size(), 0);
+                        const ShareVecVec& preScatterSrc = (iter % epochLayerNum == 0)? gs.remoteInputSvv : gs.remoteVertexSvvs[i];
                         PreScatterComp(
                             gs,
-                            gs.remoteVertexSvvs[i], 
-                            zeroDeg, 
+                            preScatterSrc, 
+                            gs.plan.zeroVec(preScatterSrc.size()), 
                             gs.remoteVertexSvvs[i],
                             iter,
                             i, 
@@ -1023,7 +2207,7 @@ void SSEdgeCentricAlgoKernel<GraphTileType>::runAlgoKernelServer(std::vector<std
                     //     std::cout<<std::endl;
                     // }
 
-                    auto serverComputeUpdate = [this, &gs, &thc, &serverTaskComm, &taskv, &graph, i, tileIndex](ShareVecVec& updateSrc, ShareVecVec& duplicatedUpdateSvv, bool dstIsLocal) {
+                    auto serverComputeUpdate = [this, &gs, &thc, &serverTaskComm, &taskv, &graph, &zeroPosVec, i, tileIndex](ShareVecVec& updateSrc, ShareVecVec& duplicatedUpdateSvv, bool dstIsLocal) {
                         // set_up_mpc_channel(false, i);
                         // Scatter
                         thc.rotation = 0;
@@ -1035,7 +2219,7 @@ void SSEdgeCentricAlgoKernel<GraphTileType>::runAlgoKernelServer(std::vector<std
                         //         std::cout<<" "<<updateSrc[j][0]<<" "<<updateSrc[j][1]<<std::endl;
                         //     }                        
                         // }
-                        std::vector<uint64_t> zeroDeg(scatterTaskNum, 0);
+                        std::vector<uint64_t>& zeroDeg = gs.plan.zeroVec(scatterTaskNum);
                         duplicatedUpdateSvv.clear();
                         if (dstIsLocal) { // The dst is local to the src subgraph
                             this->ScatterComp(updateSrc, zeroDeg, zeroDeg, duplicatedUpdateSvv, i, sci::BOB);
@@ -1044,7 +2228,7 @@ void SSEdgeCentricAlgoKernel<GraphTileType>::runAlgoKernelServer(std::vector<std
                         }
 
                         // Pre-merge
-                        std::vector<uint64_t> zeroPosVec(scatterTaskNum, 0);
+                        zeroPosVec.assign(scatterTaskNum, 0);
                         this->UpdatePreMergeComp(duplicatedUpdateSvv, zeroPosVec, i, sci::BOB);
 
                         // close_mpc_channel(false, i);
@@ -1121,10 +2305,6 @@ void SSEdgeCentricAlgoKernel<GraphTileType>::runAlgoKernelServer(std::vector<std
                                 taskv.push_back(this->genGatherTask(gs.remoteVertexSvvs[i][m], remoteUpdateSvvs[j][m], -1, i));
                             }
 
-                            std::vector<bool> zeroIsDummy(gatherTaskNum, false);
-                            std::vector<uint64_t> zeroDeg(gatherTaskNum, 0);
-                            GatherComp(gs.remoteVertexSvvs[i], remoteUpdateSvvs[j], zeroIsDummy, zeroDeg, iter, j, i, sci::BOB);
-
                             // if (j == 1 && i == 1) {
                             //     // uint64_t m=2718;
                             //     // std::cout<<"2THere "<<m<<" "<<gs.remoteVertexSvvs[i][m][0]<<" "<<gs.remoteVertexSvvs[i][m][1]<<std::endl;
@@ -1133,15 +2313,15 @@ void SSEdgeCentricAlgoKernel<GraphTileType>::runAlgoKernelServer(std::vector<std
                             //         std::cout<<"2THere "<<m<<" "<<gs.remoteVertexSvvs[i][m][0]<<" "<<gs.remoteVertexSvvs[i][m][1]<<std::endl;
                             // } 
                         }
+                        GatherAllComp(gs, gs.remoteVertexSvvs[i], remoteUpdateSvvs, gs.plan.zeroVec(gs.remoteVertexSvvs[i].size()), iter, i, sci::BOB);
 
                         // Apply
                         ShareVecVec curResult;
-                        std::vector<uint64_t> zeroDeg(gs.remoteVertexSvvs[i].size(), 0);
                         ApplyComp(
                             gs, 
                             iter, 
                             gs.remoteVertexSvvs[i], 
-                            zeroDeg,
+                            gs.plan.zeroVec(gs.remoteVertexSvvs[i].size()),
                             curResult, 
                             tileIndex,
                             i, 
@@ -1181,6 +2361,7 @@ void SSEdgeCentricAlgoKernel<GraphTileType>::runAlgoKernelServer(std::vector<std
                     // close_mpc_channel(false, i);
 
                     iter++;
+                    serverProgress.countIs(progressIndex, iter);
                 }
 
 			});
@@ -2,11 +2,14 @@
 #define TASK_H_
 
 #include <cstdint>
+#include <cstdlib>
 #include <queue>
 #include <vector>
 #include <fstream>
 #include <iostream>
 #include <string>
+#include <sstream>
+#include <stdexcept>
 
 enum TASK_TYPE {
     ADD_UINT,
@@ -89,12 +92,32 @@ public:
     int num_labels; // The number of labels (classes)
     int input_dim; // The input dimension
     int hidden_dim; // The hidden dimension
+    std::string hidden_dims; // Comma separated widths of the hidden layers, num_layers - 1 of them, empty for hidden_dim for all
     int num_samples; // The global number of samples
     int num_edges;
     double learning_rate; // The learning rate
     double train_ratio;
     double val_ratio;
     double test_ratio;
+    int plain_input_layer = 0; // Whether the feature owner feeds its plaintext features into the first layer (1) or secret shares them (0), needs matmul_triple and three parties
+    int sparse_feature = 0; // Whether input features are kept in sparse (nonzero-only) form
+    int seed_share = 0; // Whether initial shares are sent as PRG seeds (1) or as full matrices (0)
+    std::string activation_spill_dir; // Directory for the activation scratch files, empty to keep all activations in memory
+    std::string vertex_order = "id"; // Local vertex order, one of id, degree, rcm
+    int matmul_triple = 0; // Whether matmuls use Beaver triples dealt by a third party ahead of the iterations (needs at least 3 parties)
+    std::string inference_output = "prob"; // Output of the inference pass, one of prob (softmax), logits, argmax
+    int eval_interval = 1; // Evaluate the training every this many epochs and at the last one, 0 to never
+    std::string eval_metrics = "accuracy"; // Comma separated metrics, of loss, accuracy, border_accuracy, or all
+    int num_models = 1; // The number of models of identical shapes trained together in one session
+    std::string model_learning_rates; // Comma separated learning rates of the models, empty for learning_rate for all
+    std::string checkpoint_dir; // Directory for the training checkpoints, empty to never checkpoint
+    int checkpoint_interval = 1; // Checkpoint every this many epochs
+    int resume = 0; // Whether to resume from the last checkpoint all parties have (1) or start from scratch (0)
+    int score_after_train = 0; // Whether to run a forward scoring pass with the trained weights in the same session
+    std::string serve_socket; // Unix socket path prefix to serve prediction queries on after the run, empty to not serve
+    int serve_window_ms = 10; // Batching window of the served queries in milliseconds
+    std::string feature_delta_file; // Vertex list with the new features of changed vertices to infer incrementally after the run, empty to not
+    int hybrid_inference = 0; // Whether inference predicts the vertices whose receptive field is all local in plaintext (1) or all securely (0)
 
     // Define a public static method to get the singleton instance
     static GNNParam& getGNNParam() {
@@ -119,6 +142,26 @@ public:
             // train_ratio: <value>
             // val_ratio: <value>
             // test_ratio: <value>
+            // hidden_dims: <value> (optional)
+            // plain_input_layer: <value> (optional)
+            // sparse_feature: <value> (optional)
+            // seed_share: <value> (optional)
+            // activation_spill_dir: <value> (optional)
+            // vertex_order: <value> (optional)
+            // matmul_triple: <value> (optional)
+            // inference_output: <value> (optional)
+            // eval_interval: <value> (optional)
+            // eval_metrics: <value> (optional)
+            // num_models: <value> (optional)
+            // model_learning_rates: <value> (optional)
+            // checkpoint_dir: <value> (optional)
+            // checkpoint_interval: <value> (optional)
+            // resume: <value> (optional)
+            // score_after_train: <value> (optional)
+            // serve_socket: <value> (optional)
+            // serve_window_ms: <value> (optional)
+            // feature_delta_file: <value> (optional)
+            // hybrid_inference: <value> (optional)
             // Each line has a parameter name followed by a colon and a value
             // The values are separated by whitespace
             std::string param; // A string to store the parameter name
@@ -140,6 +183,8 @@ public:
                     fin >> input_dim;
                 } else if (param == "hidden_dim") {
                     fin >> hidden_dim;
+                } else if (param == "hidden_dims") {
+                    fin >> hidden_dims;
                 } else if (param == "num_samples") {
                     fin >> num_samples;
                 } else if (param == "num_edges") {
@@ -152,6 +197,44 @@ public:
                     fin >> val_ratio;
                 } else if (param == "test_ratio") {
                     fin >> test_ratio;
+                } else if (param == "plain_input_layer") {
+                    fin >> plain_input_layer;
+                } else if (param == "sparse_feature") {
+                    fin >> sparse_feature;
+                } else if (param == "seed_share") {
+                    fin >> seed_share;
+                } else if (param == "activation_spill_dir") {
+                    fin >> activation_spill_dir;
+                } else if (param == "vertex_order") {
+                    fin >> vertex_order;
+                } else if (param == "matmul_triple") {
+                    fin >> matmul_triple;
+                } else if (param == "inference_output") {
+                    fin >> inference_output;
+                } else if (param == "eval_interval") {
+                    fin >> eval_interval;
+                } else if (param == "eval_metrics") {
+                    fin >> eval_metrics;
+                } else if (param == "num_models") {
+                    fin >> num_models;
+                } else if (param == "model_learning_rates") {
+                    fin >> model_learning_rates;
+                } else if (param == "checkpoint_dir") {
+                    fin >> checkpoint_dir;
+                } else if (param == "checkpoint_interval") {
+                    fin >> checkpoint_interval;
+                } else if (param == "resume") {
+                    fin >> resume;
+                } else if (param == "score_after_train") {
+                    fin >> score_after_train;
+                } else if (param == "serve_socket") {
+                    fin >> serve_socket;
+                } else if (param == "serve_window_ms") {
+                    fin >> serve_window_ms;
+                } else if (param == "feature_delta_file") {
+                    fin >> feature_delta_file;
+                } else if (param == "hybrid_inference") {
+                    fin >> hybrid_inference;
                 } else {
                     // Print an error message
                     std::cerr << "Unknown parameter: " << param << std::endl;
@@ -167,6 +250,34 @@ public:
             std::cerr << "Failed to open the file: " << file_name << std::endl;
         }
     }
+
+    // The widths of the layer inputs and of the output, num_layers + 1 of them
+    std::vector<uint32_t> getLayerDims() const {
+        std::vector<uint32_t> dims = {(uint32_t)input_dim};
+        bool isValid = (num_layers >= 1);
+        std::stringstream ss(hidden_dims);
+        std::string dim;
+        while (isValid && std::getline(ss, dim, ',')) {
+            if (dim.empty()) continue;
+            size_t pos = 0;
+            unsigned long value = 0;
+            try {
+                value = std::stoul(dim, &pos);
+            } catch (const std::exception&) {
+                pos = 0;
+            }
+            isValid = (pos == dim.size() && value > 0 && value <= UINT32_MAX);
+            dims.push_back((uint32_t)value);
+        }
+        if (isValid && dims.size() == 1 && num_layers > 1) dims.insert(dims.end(), num_layers - 1, (uint32_t)hidden_dim);
+        dims.push_back(num_labels);
+        if (!isValid || dims.size() != (size_t)num_layers + 1) {
+            // Print an error message
+            std::cerr << "Invalid hidden_dims: expected " << num_layers - 1 << " positive hidden dims for " << num_layers << " layers, got " << hidden_dims << std::endl;
+            exit(-1);
+        }
+        return dims;
+    }
 };
 
 struct CipherEntry {
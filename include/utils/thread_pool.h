@@ -1,9 +1,20 @@
 #ifndef UTILS_THREAD_POOL_H_
 #define UTILS_THREAD_POOL_H_
 /**
- * Thread pool.
+ * Thread pools.
+ *
+ * ThreadPool pins every task to one worker. WorkStealingPool balances skewed
+ * work: each worker keeps its own Chase-Lev deque, pushes and pops at its
+ * bottom, and idle workers steal from the top of the others.
  */
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <exception>
+#include <memory>
 #include <queue>
+#include <stdexcept>
+#include <vector>
 #include "log.h"
 #include "threads.h"
 
@@ -148,6 +159,370 @@ class ThreadPool {
         }
 };
 
+/**
+ * Chase-Lev work-stealing deque of pointers (Le et al., PPoPP 2013).
+ *
+ * Only the owner pushes and pops, at the bottom, lock-free. Any thread may
+ * steal, at the top. The array grows by doubling, the old arrays are kept
+ * until the deque is destructed since thieves may still read them.
+ */
+template<typename T>
+class ChaseLevDeque {
+    public:
+        explicit ChaseLevDeque(int64_t capacity = 256) : top_(0), bottom_(0) {
+            arrays_.emplace_back(new Array(capacity));
+            array_.store(arrays_.back().get(), std::memory_order_relaxed);
+        }
+
+        // No copy or move, thieves hold references
+        ChaseLevDeque(const ChaseLevDeque&) = delete;
+        ChaseLevDeque& operator=(const ChaseLevDeque&) = delete;
+
+        // Owner only
+        void push(T* item) {
+            int64_t b = bottom_.load(std::memory_order_relaxed);
+            int64_t t = top_.load(std::memory_order_acquire);
+            Array* a = array_.load(std::memory_order_relaxed);
+            if (b - t > a->capacity - 1) a = grow(a, b, t);
+            a->put(b, item);
+            std::atomic_thread_fence(std::memory_order_release);
+            bottom_.store(b + 1, std::memory_order_relaxed);
+        }
+
+        // Owner only, nullptr if empty
+        T* pop() {
+            int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+            Array* a = array_.load(std::memory_order_relaxed);
+            bottom_.store(b, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t t = top_.load(std::memory_order_relaxed);
+            if (t > b) {
+                bottom_.store(b + 1, std::memory_order_relaxed);
+                return nullptr;
+            }
+            T* item = a->get(b);
+            if (t == b) {
+                // The last item, race the thieves for it.
+                if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                    item = nullptr;
+                }
+                bottom_.store(b + 1, std::memory_order_relaxed);
+            }
+            return item;
+        }
+
+        // Any thread, nullptr if empty or lost a race
+        T* steal() {
+            int64_t t = top_.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t b = bottom_.load(std::memory_order_acquire);
+            if (t >= b) return nullptr;
+            Array* a = array_.load(std::memory_order_acquire);
+            T* item = a->get(t);
+            if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                return nullptr;
+            }
+            return item;
+        }
+
+        bool empty() const {
+            return bottom_.load(std::memory_order_relaxed) <= top_.load(std::memory_order_relaxed);
+        }
+
+    private:
+        struct Array {
+            explicit Array(int64_t cap) : capacity(cap), items(new std::atomic<T*>[cap]) {}
+            T* get(int64_t i) const { return items[i & (capacity - 1)].load(std::memory_order_relaxed); }
+            void put(int64_t i, T* item) { items[i & (capacity - 1)].store(item, std::memory_order_relaxed); }
+
+            const int64_t capacity; // A power of two
+            std::unique_ptr<std::atomic<T*>[]> items;
+        };
+
+        Array* grow(Array* a, int64_t b, int64_t t) {
+            Array* bigger = new Array(2 * a->capacity);
+            for (int64_t i = t; i < b; i++) bigger->put(i, a->get(i));
+            arrays_.emplace_back(bigger);
+            array_.store(bigger, std::memory_order_release);
+            return bigger;
+        }
+
+        std::atomic<int64_t> top_;
+        std::atomic<int64_t> bottom_;
+        std::atomic<Array*> array_;
+        std::vector<std::unique_ptr<Array>> arrays_; // Owner only
+};
+
+class WorkStealingPool {
+    public:
+        typedef uint32_t tid_t;
+
+        explicit WorkStealingPool(uint32_t num_workers) :
+            num_workers_(num_workers == 0 ? 1 : num_workers), num_injected_(0),
+            stop_(false), epoch_(0), num_sleeping_(0) {
+
+            for (tid_t tid = 0; tid < num_workers_; tid++) {
+                deques_.emplace_back(new ChaseLevDeque<TaskType>());
+            }
+            for (tid_t tid = 0; tid < num_workers_; tid++) {
+                workers_.emplace_back(&WorkStealingPool::worker_func, this, tid);
+            }
+        }
+
+        ~WorkStealingPool() {
+            mutex_begin(uqlk, sleep_lk_);
+            stop_ = true;
+            mutex_end();
+            sleep_cv_.notify_all();
+            for (auto& w : workers_) {
+                w.join();
+            }
+            // Drop what was never run.
+            for (auto& d : deques_) {
+                while (TaskType* task = d->steal()) delete task;
+            }
+            for (auto* task : injected_) delete task;
+        }
+
+        // No copy or move, workers hold this
+        WorkStealingPool(const WorkStealingPool&) = delete;
+        WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+        /**
+         * The pool shared by the local phases, one worker per hardware thread.
+         */
+        static WorkStealingPool& instance() {
+            static WorkStealingPool pool(std::max(1u, std::thread::hardware_concurrency()));
+            return pool;
+        }
+
+        uint32_t num_workers() const { return num_workers_; }
+
+        /**
+         * Submit a task. A worker of this pool pushes it onto its own deque,
+         * other threads onto the shared injection queue.
+         */
+        void submit(const TaskType& task) {
+            if (!task) {
+                throw std::runtime_error("WorkStealingPool: submit empty task!");
+            }
+            TaskType* item = new TaskType(task);
+            const Worker& self = current_worker();
+            if (self.pool == this) {
+                deques_[self.tid]->push(item);
+            } else {
+                mutex_begin(uqlk, inject_lk_);
+                injected_.push_back(item);
+                num_injected_.fetch_add(1, std::memory_order_release);
+                mutex_end();
+            }
+            wake_one();
+        }
+
+        /**
+         * Run one pending task on the calling thread, if any. Threads waiting for
+         * tasks of this pool help with it instead of blocking.
+         */
+        bool run_one() {
+            const Worker& self = current_worker();
+            TaskType* task = next_task(self.pool == this ? self.tid : num_workers_);
+            if (task == nullptr) return false;
+            run_task(task);
+            return true;
+        }
+
+    private:
+        struct Worker {
+            WorkStealingPool* pool;
+            tid_t tid;
+        };
+
+        static Worker& current_worker() {
+            static thread_local Worker self = {nullptr, 0};
+            return self;
+        }
+
+        static void run_task(TaskType* task) {
+            std::unique_ptr<TaskType> owned(task);
+            (*owned)();
+        }
+
+        // The own deque first, then the injection queue, then steal from a
+        // victim chosen at random. tid is num_workers_ for non-workers.
+        TaskType* next_task(tid_t tid) {
+            if (tid < num_workers_) {
+                if (TaskType* task = deques_[tid]->pop()) return task;
+            }
+            if (num_injected_.load(std::memory_order_acquire) != 0) {
+                mutex_begin(uqlk, inject_lk_);
+                if (!injected_.empty()) {
+                    TaskType* task = injected_.front();
+                    injected_.pop_front();
+                    num_injected_.fetch_sub(1, std::memory_order_relaxed);
+                    return task;
+                }
+                mutex_end();
+            }
+            static thread_local uint64_t seed = std::hash<std::thread::id>()(std::this_thread::get_id()) | 1;
+            seed ^= seed << 13;
+            seed ^= seed >> 7;
+            seed ^= seed << 17;
+            const tid_t first = seed % num_workers_;
+            for (tid_t k = 0; k < num_workers_; k++) {
+                const tid_t victim = (first + k) % num_workers_;
+                if (victim == tid) continue;
+                if (TaskType* task = deques_[victim]->steal()) return task;
+            }
+            return nullptr;
+        }
+
+        void wake_one() {
+            // Paired with the epoch check of a worker going to sleep, so either
+            // it sees the new epoch or this sees it sleeping.
+            epoch_.fetch_add(1, std::memory_order_seq_cst);
+            if (num_sleeping_.load(std::memory_order_seq_cst) == 0) return;
+            mutex_begin(uqlk, sleep_lk_);
+            mutex_end();
+            sleep_cv_.notify_one();
+        }
+
+        void worker_func(tid_t tid) {
+            current_worker() = {this, tid};
+            while (true) {
+                const uint64_t epoch = epoch_.load(std::memory_order_seq_cst);
+                TaskType* task = next_task(tid);
+                if (task != nullptr) {
+                    run_task(task);
+                    continue;
+                }
+                mutex_begin(uqlk, sleep_lk_);
+                if (stop_) return;
+                num_sleeping_.fetch_add(1, std::memory_order_seq_cst);
+                sleep_cv_.wait(uqlk, [this, epoch]{
+                    return stop_ || epoch_.load(std::memory_order_seq_cst) != epoch;
+                });
+                num_sleeping_.fetch_sub(1, std::memory_order_seq_cst);
+                mutex_end();
+            }
+        }
+
+    private:
+        uint32_t num_workers_;
+        std::vector<thread_t> workers_;
+        std::vector<std::unique_ptr<ChaseLevDeque<TaskType>>> deques_;
+
+        // Tasks submitted from outside the pool
+        lock_t inject_lk_;
+        std::deque<TaskType*> injected_;
+        std::atomic<uint64_t> num_injected_;
+
+        // Idle workers sleep until a task is submitted
+        lock_t sleep_lk_;
+        cond_t sleep_cv_;
+        bool stop_;
+        std::atomic<uint64_t> epoch_;
+        std::atomic<uint32_t> num_sleeping_;
+};
+
+/**
+ * A set of tasks on a WorkStealingPool to wait for together. Tasks may run
+ * more tasks in the group. The waiting thread runs pending tasks meanwhile, so
+ * waiting inside a task does not tie up its worker, and sleeps when there are
+ * none until a task of the group finishes or runs another. The first exception
+ * a task throws is rethrown by wait().
+ */
+class TaskGroup {
+    public:
+        explicit TaskGroup(WorkStealingPool& pool = WorkStealingPool::instance()) :
+            pool_(pool), num_pending_(0), num_run_(0) {}
+
+        ~TaskGroup() {
+            // Tasks may still refer to the group.
+            join();
+        }
+
+        // No copy or move, tasks refer to the group
+        TaskGroup(const TaskGroup&) = delete;
+        TaskGroup& operator=(const TaskGroup&) = delete;
+
+        void run(const TaskType& task) {
+            mutex_begin(uqlk, pending_lk_);
+            num_pending_++;
+            mutex_end();
+            pool_.submit([this, task]{
+                try {
+                    task();
+                } catch (...) {
+                    mutex_begin(uqlk, error_lk_);
+                    if (!error_) error_ = std::current_exception();
+                    mutex_end();
+                }
+                // Notify under the lock, the group may be gone once it is released.
+                mutex_begin(uqlk, pending_lk_);
+                if (--num_pending_ == 0) pending_cv_.notify_all();
+                mutex_end();
+            });
+            // Only once submitted, so a woken waiter finds the task.
+            mutex_begin(uqlk, pending_lk_);
+            num_run_++;
+            pending_cv_.notify_all();
+            mutex_end();
+        }
+
+        void wait() {
+            join();
+            std::exception_ptr error;
+            mutex_begin(uqlk, error_lk_);
+            std::swap(error, error_);
+            mutex_end();
+            if (error) std::rethrow_exception(error);
+        }
+
+    private:
+        void join() {
+            while (true) {
+                if (pool_.run_one()) continue;
+                mutex_begin(uqlk, pending_lk_);
+                if (num_pending_ == 0) return;
+                const uint64_t num_run = num_run_;
+                pending_cv_.wait(uqlk, [this, num_run]{ return num_pending_ == 0 || num_run_ != num_run; });
+                mutex_end();
+            }
+        }
+
+        WorkStealingPool& pool_;
+        // Tasks not finished, and tasks run so far
+        lock_t pending_lk_;
+        cond_t pending_cv_;
+        uint64_t num_pending_;
+        uint64_t num_run_;
+        lock_t error_lk_;
+        std::exception_ptr error_;
+};
+
+/**
+ * Call func(lo, hi) on disjoint subranges of [begin, end) of at most grain
+ * indices, in parallel. Ranges are split in halves as tasks, so idle workers
+ * steal the large remaining halves first.
+ */
+template<typename Func>
+void parallel_for(uint64_t begin, uint64_t end, uint64_t grain, const Func& func,
+        WorkStealingPool& pool = WorkStealingPool::instance()) {
+    if (begin >= end) return;
+    if (grain == 0) grain = 1;
+    TaskGroup group(pool);
+    std::function<void(uint64_t, uint64_t)> split = [&group, &split, &func, grain](uint64_t lo, uint64_t hi) {
+        while (hi - lo > grain) {
+            const uint64_t mid = lo + (hi - lo) / 2;
+            group.run([&split, mid, hi]{ split(mid, hi); });
+            hi = mid;
+        }
+        func(lo, hi);
+    };
+    group.run([&split, begin, end]{ split(begin, end); });
+    group.wait();
+}
+
 }
 
 #endif // UTILS_THREAD_POOL_H_
@@ -10,13 +10,18 @@
 #include <mutex>
 #include <thread>
 #include <functional>
+#include <algorithm>
+#include <cstdint>
+#include <vector>
 
 class barrier;
+class progress;
 
 using thread_t = std::thread;
 using lock_t = std::mutex;
 using cond_t = std::condition_variable;
 using bar_t = barrier;
+using progress_t = progress;
 
 
 /* Threads */
@@ -108,5 +113,50 @@ class barrier {
         std::size_t barCount_;
 };
 
+
+/* Progress */
+class progress {
+    public:
+        /**
+         * Construct the progress of a group of threads, all at 0.
+         *
+         * @param threadCount   The number of threads tracked.
+         */
+        explicit progress(const std::size_t threadCount)
+            : counts_(threadCount, 0)
+        {
+            // Nothing else to do.
+        }
+
+        /**
+         * Set the progress of a thread.
+         *
+         * @param idx       The index of the thread, less than the thread count.
+         * @param count     The new progress, not less than the current one.
+         */
+        void countIs(const std::size_t idx, const uint64_t count) {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                counts_[idx] = count;
+            }
+            cv_.notify_all();
+        }
+
+        /**
+         * Wait until all threads have progressed to at least the given count.
+         */
+        void wait(const uint64_t count) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this, count]{
+                    return std::all_of(counts_.begin(), counts_.end(), [count](uint64_t c){ return c >= count; });
+                    });
+        }
+
+    private:
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        std::vector<uint64_t> counts_;
+};
+
 #endif // UTILS_THREADS_H_
 
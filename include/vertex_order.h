@@ -0,0 +1,112 @@
+#ifndef VERTEX_ORDER_H_
+#define VERTEX_ORDER_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "utils/exception.h"
+
+namespace GraphGASLite {
+
+/**
+ * Order of the dense local vertex indices assigned at preprocessing.
+ *
+ * ID keeps ascending vertex ids. DEGREE puts high in-degree vertices first, so
+ * the hot rows of the gather and scale loops are packed together. RCM is the
+ * reverse Cuthill-McKee order of the local subgraph, which keeps neighbors
+ * close and therefore the position vectors fed to the oblivious mapper nearly
+ * monotonic.
+ */
+enum class VertexOrder {
+    ID,
+    DEGREE,
+    RCM,
+};
+
+static inline VertexOrder vertexOrderOf(const std::string& name) {
+    if (name == "id") return VertexOrder::ID;
+    if (name == "degree") return VertexOrder::DEGREE;
+    if (name == "rcm") return VertexOrder::RCM;
+    throw InvalidArgumentException("Unknown vertex order " + name);
+}
+
+/**
+ * Reorder the id-sorted local vertex ids in [begin, end) in place. Only edges
+ * between vertices of the range are considered for RCM.
+ */
+template<typename GraphTileType>
+void orderVertexRange(GraphTileType& graph, std::vector<uint64_t>& ids,
+        uint64_t begin, uint64_t end, VertexOrder order) {
+    if (order == VertexOrder::ID || end - begin < 2) return;
+    auto first = ids.begin() + begin;
+    auto last = ids.begin() + end;
+
+    if (order == VertexOrder::DEGREE) {
+        std::stable_sort(first, last, [&graph](uint64_t a, uint64_t b) {
+            return graph.vertex(a)->inDeg().cnt() > graph.vertex(b)->inDeg().cnt();
+        });
+        return;
+    }
+
+    // Undirected adjacency of the range, by offset in the range.
+    const uint64_t n = end - begin;
+    std::unordered_map<uint64_t, uint64_t> offsetOf;
+    offsetOf.reserve(n);
+    for (uint64_t k = 0; k < n; ++k) offsetOf[first[k]] = k;
+    std::vector<std::vector<uint64_t>> adj(n);
+    for (uint64_t k = 0; k < n; ++k) {
+        auto v = graph.vertex(first[k]);
+        const std::vector<uint64_t>& srcv = v->getSrcVertexv();
+        const std::vector<bool>& isDummyv = v->getIsSrcDummyv();
+        for (uint64_t t = 0; t < srcv.size(); ++t) {
+            if (isDummyv[t] || srcv[t] == first[k]) continue;
+            auto it = offsetOf.find(srcv[t]);
+            if (it == offsetOf.end()) continue;
+            adj[k].push_back(it->second);
+            adj[it->second].push_back(k);
+        }
+    }
+    for (auto& nbrs : adj) {
+        std::sort(nbrs.begin(), nbrs.end());
+        nbrs.erase(std::unique(nbrs.begin(), nbrs.end()), nbrs.end());
+    }
+    auto byDegree = [&adj](uint64_t a, uint64_t b) {
+        return adj[a].size() != adj[b].size()? adj[a].size() < adj[b].size() : a < b;
+    };
+
+    // Every component starts from its lowest degree vertex.
+    std::vector<uint64_t> starts(n);
+    for (uint64_t k = 0; k < n; ++k) starts[k] = k;
+    std::sort(starts.begin(), starts.end(), byDegree);
+
+    std::vector<bool> visited(n, false);
+    std::vector<uint64_t> bfs;
+    bfs.reserve(n);
+    std::vector<uint64_t> frontier;
+    for (const auto start : starts) {
+        if (visited[start]) continue;
+        visited[start] = true;
+        bfs.push_back(start);
+        for (uint64_t head = bfs.size() - 1; head < bfs.size(); ++head) {
+            frontier.clear();
+            for (const auto u : adj[bfs[head]]) {
+                if (!visited[u]) {
+                    visited[u] = true;
+                    frontier.push_back(u);
+                }
+            }
+            std::sort(frontier.begin(), frontier.end(), byDegree);
+            bfs.insert(bfs.end(), frontier.begin(), frontier.end());
+        }
+    }
+
+    std::vector<uint64_t> ordered(n);
+    for (uint64_t k = 0; k < n; ++k) ordered[k] = first[bfs[n - 1 - k]];
+    std::copy(ordered.begin(), ordered.end(), first);
+}
+
+} // namespace GraphGASLite
+
+#endif // VERTEX_ORDER_H_
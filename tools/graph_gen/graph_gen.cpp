@@ -0,0 +1,361 @@
+/**
+ * Synthetic graph generator for the GCN harness.
+ *
+ * Writes an R-MAT graph in the harness text formats, so that scaling runs do not
+ * depend on the small Planetoid datasets:
+ *
+ *   <name>.edge.preprocessed           <src> <dst>
+ *   <name>.vertex.preprocessed         <vid> <feature> ... <feature> <label>
+ *   <name>.part.preprocessed.<N>p      <vid> <party>
+ *   <name>_config.txt                  GNNParam configuration
+ *
+ * Vertices are assigned to parties round-robin (vid % N), as tools/data_transform.py
+ * does. Each edge draws its source and destination local indices from an R-MAT
+ * distribution, so degrees are power-law within every party, and crosses to a
+ * uniformly chosen other party with the given inter-party ratio.
+ *
+ * Output is produced in chunks with an independent random stream each, formatted
+ * by a pool of threads and written in order, so the result only depends on the
+ * seed and not on the thread count.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+namespace {
+
+const uint64_t EDGE_CHUNK_SIZE = 1 << 20;
+const uint64_t VERTEX_CHUNK_SIZE = 1 << 12;
+
+struct GenParam {
+    uint64_t numVertices = 0;
+    uint64_t avgDegree = 16;
+    uint32_t numParts = 2;
+    double interRatio = 0.4;
+    uint32_t inputDim = 64;
+    uint32_t numLabels = 8;
+    double featureDensity = 1.0;
+    double rmatA = 0.57;
+    double rmatB = 0.19;
+    double rmatC = 0.19;
+    uint32_t threadCount = 0;
+    uint64_t seed = 1;
+    uint32_t numLayers = 2;
+    uint32_t hiddenDim = 16;
+    double learningRate = 0.1;
+    double trainRatio = 0.6;
+    double valRatio = 0.2;
+    std::string outputDir;
+    std::string name;
+};
+
+void printHelp(const char* prog) {
+    std::cerr << "Usage: " << prog << " [options] <output dir> <name>" << std::endl
+        << std::endl
+        << "Options:" << std::endl
+        << "\t-n <vertices>   number of vertices (required)" << std::endl
+        << "\t-e <degree>     average out-degree, default 16" << std::endl
+        << "\t-p <parties>    number of parties, default 2" << std::endl
+        << "\t-x <ratio>      inter-party edge ratio, default 0.4" << std::endl
+        << "\t-d <dim>        input feature dimension, default 64" << std::endl
+        << "\t-l <labels>     number of labels, default 8" << std::endl
+        << "\t-f <density>    feature density, 1 for dense, default 1" << std::endl
+        << "\t-a <a,b,c>      R-MAT quadrant probabilities, default 0.57,0.19,0.19" << std::endl
+        << "\t-t <threads>    generator threads, default all cores" << std::endl
+        << "\t-s <seed>       random seed, default 1" << std::endl
+        << "\t-L <layers>     num_layers written to the config, default 2" << std::endl
+        << "\t-H <dim>        hidden_dim written to the config, default 16" << std::endl
+        << "\t-h              print this help" << std::endl;
+}
+
+int parseArgs(int argc, char** argv, GenParam& param) {
+    int ch;
+    while ((ch = getopt(argc, argv, "n:e:p:x:d:l:f:a:t:s:L:H:h")) != -1) {
+        switch (ch) {
+            case 'n':
+                std::stringstream(optarg) >> param.numVertices;
+                break;
+            case 'e':
+                std::stringstream(optarg) >> param.avgDegree;
+                break;
+            case 'p':
+                std::stringstream(optarg) >> param.numParts;
+                break;
+            case 'x':
+                std::stringstream(optarg) >> param.interRatio;
+                break;
+            case 'd':
+                std::stringstream(optarg) >> param.inputDim;
+                break;
+            case 'l':
+                std::stringstream(optarg) >> param.numLabels;
+                break;
+            case 'f':
+                std::stringstream(optarg) >> param.featureDensity;
+                break;
+            case 'a': {
+                char comma;
+                std::stringstream(optarg) >> param.rmatA >> comma >> param.rmatB >> comma >> param.rmatC;
+                break;
+            }
+            case 't':
+                std::stringstream(optarg) >> param.threadCount;
+                break;
+            case 's':
+                std::stringstream(optarg) >> param.seed;
+                break;
+            case 'L':
+                std::stringstream(optarg) >> param.numLayers;
+                break;
+            case 'H':
+                std::stringstream(optarg) >> param.hiddenDim;
+                break;
+            case 'h':
+            default:
+                return -1;
+        }
+    }
+    if (argc - optind != 2) return -1;
+    param.outputDir = argv[optind];
+    param.name = argv[optind + 1];
+
+    if (param.numVertices == 0 || param.numParts == 0 || param.numLabels == 0) {
+        std::cerr << "Vertex, party and label numbers must be positive." << std::endl;
+        return -1;
+    }
+    if (param.numVertices < 2 * param.numParts) {
+        std::cerr << "Every party needs at least two vertices." << std::endl;
+        return -1;
+    }
+    if (param.interRatio < 0 || param.interRatio > 1 || (param.numParts == 1 && param.interRatio > 0)) {
+        std::cerr << "Invalid inter-party edge ratio." << std::endl;
+        return -1;
+    }
+    if (param.rmatA < 0 || param.rmatB < 0 || param.rmatC < 0 || param.rmatA + param.rmatB + param.rmatC > 1) {
+        std::cerr << "Invalid R-MAT probabilities." << std::endl;
+        return -1;
+    }
+    if (param.threadCount == 0) {
+        param.threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    return 0;
+}
+
+/**
+ * Independent random stream of a chunk.
+ */
+std::mt19937_64 chunkRng(uint64_t seed, uint64_t stream, uint64_t chunk) {
+    std::seed_seq seq{seed, stream, chunk};
+    return std::mt19937_64(seq);
+}
+
+uint64_t partSize(const GenParam& param, uint32_t part) {
+    return param.numVertices / param.numParts + (part < param.numVertices % param.numParts? 1 : 0);
+}
+
+/**
+ * Format chunks [0, chunkNum) with formatChunk(chunk, out) on the thread pool and
+ * append them to the file in chunk order.
+ */
+template<typename Func>
+void writeChunks(const std::string& fileName, uint64_t chunkNum, uint32_t threadCount, Func formatChunk) {
+    std::ofstream fout(fileName, std::ofstream::out | std::ofstream::binary);
+    if (!fout.is_open()) {
+        std::cerr << "Cannot open " << fileName << std::endl;
+        exit(-1);
+    }
+    std::vector<std::string> buffers(threadCount);
+    for (uint64_t round = 0; round < chunkNum; round += threadCount) {
+        const uint64_t roundSize = std::min<uint64_t>(threadCount, chunkNum - round);
+        std::vector<std::thread> threads;
+        for (uint64_t t = 0; t < roundSize; ++t) {
+            threads.emplace_back([&buffers, &formatChunk, round, t]() {
+                buffers[t].clear();
+                formatChunk(round + t, buffers[t]);
+            });
+        }
+        for (auto& thrd : threads) thrd.join();
+        for (uint64_t t = 0; t < roundSize; ++t) fout.write(buffers[t].data(), buffers[t].size());
+    }
+    if (!fout) {
+        std::cerr << "Failed to write " << fileName << std::endl;
+        exit(-1);
+    }
+}
+
+void appendUint(std::string& out, uint64_t x) {
+    char buf[24];
+    int len = snprintf(buf, sizeof(buf), "%" PRIu64, x);
+    out.append(buf, len);
+}
+
+/**
+ * Draw a cell of a 2^scale square R-MAT matrix, rejecting cells outside of
+ * rows x cols.
+ */
+void rmatCell(std::mt19937_64& rng, const GenParam& param, uint32_t scale, uint64_t rows, uint64_t cols,
+        uint64_t& row, uint64_t& col) {
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    const double d = 1 - param.rmatA - param.rmatB - param.rmatC;
+    do {
+        row = 0;
+        col = 0;
+        for (uint32_t bit = 0; bit < scale; ++bit) {
+            // Perturb every level a little so the degree distribution is smooth.
+            double a = param.rmatA * (0.95 + 0.1 * uniform(rng));
+            double b = param.rmatB * (0.95 + 0.1 * uniform(rng));
+            double c = param.rmatC * (0.95 + 0.1 * uniform(rng));
+            const double x = uniform(rng) * (a + b + c + d);
+            if (x < a) continue;
+            if (x < a + b) {
+                col |= (1ULL << bit);
+            } else if (x < a + b + c) {
+                row |= (1ULL << bit);
+            } else {
+                row |= (1ULL << bit);
+                col |= (1ULL << bit);
+            }
+        }
+    } while (row >= rows || col >= cols);
+}
+
+struct RMATEdge {
+    uint64_t src;
+    uint64_t dst;
+};
+
+/**
+ * Draw an edge. Source and destination local indices come from one R-MAT cell,
+ * the destination is moved to another party with the inter-party ratio.
+ */
+RMATEdge rmatEdge(std::mt19937_64& rng, const GenParam& param, uint32_t scale) {
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::uniform_int_distribution<uint32_t> partDist(0, param.numParts - 1);
+    const uint32_t srcPart = partDist(rng);
+    uint32_t dstPart = srcPart;
+    if (param.numParts > 1 && uniform(rng) < param.interRatio) {
+        std::uniform_int_distribution<uint32_t> otherDist(1, param.numParts - 1);
+        dstPart = (srcPart + otherDist(rng)) % param.numParts;
+    }
+    uint64_t srcIdx = 0;
+    uint64_t dstIdx = 0;
+    do {
+        rmatCell(rng, param, scale, partSize(param, srcPart), partSize(param, dstPart), srcIdx, dstIdx);
+    } while (srcPart == dstPart && srcIdx == dstIdx);
+    return {srcIdx * param.numParts + srcPart, dstIdx * param.numParts + dstPart};
+}
+
+void writeConfig(const GenParam& param, uint64_t numEdges) {
+    const std::string fileName = param.outputDir + "/" + param.name + "_config.txt";
+    std::ofstream fout(fileName);
+    if (!fout.is_open()) {
+        std::cerr << "Cannot open " << fileName << std::endl;
+        exit(-1);
+    }
+    // The reader expects whitespace between the name and the colon.
+    fout << "num_layers : " << param.numLayers << std::endl
+        << "num_labels : " << param.numLabels << std::endl
+        << "input_dim : " << param.inputDim << std::endl
+        << "hidden_dim : " << param.hiddenDim << std::endl
+        << "num_samples : " << param.numVertices << std::endl
+        << "num_edges : " << numEdges << std::endl
+        << "learning_rate : " << param.learningRate << std::endl
+        << "train_ratio : " << param.trainRatio << std::endl
+        << "val_ratio : " << param.valRatio << std::endl
+        << "test_ratio : " << 1 - param.trainRatio - param.valRatio << std::endl
+        << "sparse_feature : " << (param.featureDensity < 1.0? 1 : 0) << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    GenParam param;
+    if (parseArgs(argc, argv, param) != 0) {
+        printHelp(argv[0]);
+        return -1;
+    }
+
+    const std::string prefix = param.outputDir + "/" + param.name;
+    const uint64_t numEdges = param.numVertices * param.avgDegree;
+    uint32_t scale = 0;
+    while ((1ULL << scale) < partSize(param, 0)) ++scale;
+
+    // Topology.
+    std::atomic<uint64_t> interEdges(0);
+    const uint64_t edgeChunkNum = (numEdges + EDGE_CHUNK_SIZE - 1) / EDGE_CHUNK_SIZE;
+    writeChunks(prefix + ".edge.preprocessed", edgeChunkNum, param.threadCount,
+            [&param, &interEdges, numEdges, scale](uint64_t chunk, std::string& out) {
+        std::mt19937_64 rng = chunkRng(param.seed, 0, chunk);
+        const uint64_t end = std::min(numEdges, (chunk + 1) * EDGE_CHUNK_SIZE);
+        uint64_t inter = 0;
+        for (uint64_t e = chunk * EDGE_CHUNK_SIZE; e < end; ++e) {
+            const RMATEdge edge = rmatEdge(rng, param, scale);
+            if (edge.src % param.numParts != edge.dst % param.numParts) ++inter;
+            appendUint(out, edge.src);
+            out.push_back(' ');
+            appendUint(out, edge.dst);
+            out.push_back('\n');
+        }
+        interEdges += inter;
+    });
+
+    // Partition.
+    const uint64_t vertexChunkNum = (param.numVertices + VERTEX_CHUNK_SIZE - 1) / VERTEX_CHUNK_SIZE;
+    writeChunks(prefix + ".part.preprocessed." + std::to_string(param.numParts) + "p", vertexChunkNum, param.threadCount,
+            [&param](uint64_t chunk, std::string& out) {
+        const uint64_t end = std::min(param.numVertices, (chunk + 1) * VERTEX_CHUNK_SIZE);
+        for (uint64_t v = chunk * VERTEX_CHUNK_SIZE; v < end; ++v) {
+            appendUint(out, v);
+            out.push_back('\t');
+            appendUint(out, v % param.numParts);
+            out.push_back('\n');
+        }
+    });
+
+    // Features and labels. Every label lifts its own subset of dimensions, so the
+    // labels are learnable from the features.
+    writeChunks(prefix + ".vertex.preprocessed", vertexChunkNum, param.threadCount,
+            [&param](uint64_t chunk, std::string& out) {
+        std::mt19937_64 rng = chunkRng(param.seed, 1, chunk);
+        std::uniform_real_distribution<double> uniform(0.0, 1.0);
+        std::uniform_int_distribution<uint32_t> labelDist(0, param.numLabels - 1);
+        const uint64_t end = std::min(param.numVertices, (chunk + 1) * VERTEX_CHUNK_SIZE);
+        char buf[32];
+        for (uint64_t v = chunk * VERTEX_CHUNK_SIZE; v < end; ++v) {
+            const uint32_t label = labelDist(rng);
+            appendUint(out, v);
+            for (uint32_t j = 0; j < param.inputDim; ++j) {
+                const bool isSignal = (j % param.numLabels == label);
+                double x = 0;
+                if (isSignal || uniform(rng) < param.featureDensity) x = uniform(rng);
+                if (isSignal) x += 1.0;
+                if (x == 0) {
+                    out.append(" 0");
+                } else {
+                    int len = snprintf(buf, sizeof(buf), " %f", x);
+                    out.append(buf, len);
+                }
+            }
+            out.push_back(' ');
+            appendUint(out, label);
+            out.push_back('\n');
+        }
+    });
+
+    writeConfig(param, numEdges);
+
+    printf("vertices %" PRIu64 ", edges %" PRIu64 ", parties %u, inter-party edge ratio %lf\n",
+            param.numVertices, numEdges, param.numParts, numEdges == 0? 0.0 : (double)interEdges / numEdges);
+    return 0;
+}
@@ -0,0 +1,312 @@
+/**
+ * Microbenchmark of the local vertex orders of include/vertex_order.h.
+ *
+ * Generates an R-MAT graph of one party, renumbers its vertices with every
+ * requested order as onPreprocessClient does, and times the local phases the
+ * order is meant to speed up, on plain ring elements and without SCI:
+ *
+ *   order       orderVertexRange over all vertices
+ *   positions   the per-edge source and destination position vectors, mapped
+ *               to dense local indices as the oblivious mapper input
+ *   gather      row sums of the source rows into the destination rows
+ *   scale       fixed point row scaling by pow(inDeg + 1, -0.5)
+ *
+ * The R-MAT ids are shuffled before, as R-MAT packs the hubs at low ids, which
+ * real datasets do not. Also reported is the mean distance between the source
+ * positions of consecutive edges, the locality the gather loop sees.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "vertex_order.h"
+
+namespace {
+
+const uint32_t SCALER_BIT_LENGTH = 20;
+
+struct BenchParam {
+    uint64_t numVertices = 0;
+    uint64_t avgDegree = 16;
+    uint32_t dim = 16;
+    double rmatA = 0.57;
+    double rmatB = 0.19;
+    double rmatC = 0.19;
+    uint32_t repeat = 5;
+    uint64_t seed = 1;
+    std::string orders = "id,degree,rcm";
+};
+
+/**
+ * The part of the graph tile interface orderVertexRange reads.
+ */
+class BenchVertex {
+public:
+    struct Degree {
+        uint64_t value;
+        uint64_t cnt() const { return value; }
+    };
+
+    Degree inDeg() const { return {inDeg_}; }
+    std::vector<uint64_t>& getSrcVertexv() { return srcv_; }
+    std::vector<bool>& getIsSrcDummyv() { return isSrcDummyv_; }
+
+    void srcNew(uint64_t src) {
+        srcv_.push_back(src);
+        isSrcDummyv_.push_back(false);
+        ++inDeg_;
+    }
+
+    /**
+     * A vertex without in-edges gets a dummy self edge, as at graph loading.
+     */
+    void dummySrcIs(uint64_t self) {
+        if (!srcv_.empty()) return;
+        srcv_.push_back(self);
+        isSrcDummyv_.push_back(true);
+    }
+
+private:
+    std::vector<uint64_t> srcv_;
+    std::vector<bool> isSrcDummyv_;
+    uint64_t inDeg_ = 0;
+};
+
+class BenchGraph {
+public:
+    explicit BenchGraph(uint64_t numVertices) : vertices_(numVertices) {}
+
+    BenchVertex* vertex(uint64_t vid) { return &vertices_[vid]; }
+    uint64_t vertexCount() const { return vertices_.size(); }
+
+private:
+    std::vector<BenchVertex> vertices_;
+};
+
+void printHelp(const char* prog) {
+    std::cerr << "Usage: " << prog << " [options]" << std::endl
+        << std::endl
+        << "Options:" << std::endl
+        << "\t-n <vertices>   number of vertices (required)" << std::endl
+        << "\t-e <degree>     average in-degree, default 16" << std::endl
+        << "\t-d <dim>        row dimension of the gather and scale, default 16" << std::endl
+        << "\t-a <a,b,c>      R-MAT quadrant probabilities, default 0.57,0.19,0.19" << std::endl
+        << "\t-o <orders>     comma separated orders, default id,degree,rcm" << std::endl
+        << "\t-r <repeat>     timed runs per phase, the best is reported, default 5" << std::endl
+        << "\t-s <seed>       random seed, default 1" << std::endl
+        << "\t-h              print this help" << std::endl;
+}
+
+int parseArgs(int argc, char** argv, BenchParam& param) {
+    int ch;
+    while ((ch = getopt(argc, argv, "n:e:d:a:o:r:s:h")) != -1) {
+        switch (ch) {
+            case 'n':
+                std::stringstream(optarg) >> param.numVertices;
+                break;
+            case 'e':
+                std::stringstream(optarg) >> param.avgDegree;
+                break;
+            case 'd':
+                std::stringstream(optarg) >> param.dim;
+                break;
+            case 'a': {
+                char comma;
+                std::stringstream(optarg) >> param.rmatA >> comma >> param.rmatB >> comma >> param.rmatC;
+                break;
+            }
+            case 'o':
+                param.orders = optarg;
+                break;
+            case 'r':
+                std::stringstream(optarg) >> param.repeat;
+                break;
+            case 's':
+                std::stringstream(optarg) >> param.seed;
+                break;
+            case 'h':
+            default:
+                return -1;
+        }
+    }
+    if (argc != optind) return -1;
+
+    if (param.numVertices < 2 || param.dim == 0 || param.repeat == 0) {
+        std::cerr << "Need at least two vertices, a positive dimension and repeat count." << std::endl;
+        return -1;
+    }
+    if (param.rmatA < 0 || param.rmatB < 0 || param.rmatC < 0 || param.rmatA + param.rmatB + param.rmatC > 1) {
+        std::cerr << "Invalid R-MAT probabilities." << std::endl;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * R-MAT edges over shuffled vertex ids, without self loops.
+ */
+void generateGraph(const BenchParam& param, BenchGraph& graph) {
+    std::mt19937_64 rng(param.seed);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    const uint64_t n = param.numVertices;
+    uint32_t scale = 0;
+    while ((1ULL << scale) < n) ++scale;
+
+    std::vector<uint64_t> vidOf(n);
+    std::iota(vidOf.begin(), vidOf.end(), 0);
+    std::shuffle(vidOf.begin(), vidOf.end(), rng);
+
+    const uint64_t numEdges = n * param.avgDegree;
+    for (uint64_t e = 0; e < numEdges; ++e) {
+        uint64_t src = 0;
+        uint64_t dst = 0;
+        do {
+            src = 0;
+            dst = 0;
+            for (uint32_t level = 0; level < scale; ++level) {
+                const double r = uniform(rng);
+                const uint64_t bit = 1ULL << (scale - 1 - level);
+                if (r < param.rmatA) {
+                } else if (r < param.rmatA + param.rmatB) {
+                    dst |= bit;
+                } else if (r < param.rmatA + param.rmatB + param.rmatC) {
+                    src |= bit;
+                } else {
+                    src |= bit;
+                    dst |= bit;
+                }
+            }
+        } while (src >= n || dst >= n || src == dst);
+        graph.vertex(vidOf[dst])->srcNew(vidOf[src]);
+    }
+    for (uint64_t vid = 0; vid < n; ++vid) graph.vertex(vid)->dummySrcIs(vid);
+}
+
+template<typename Func>
+double bestMillis(uint32_t repeat, Func func) {
+    double best = 0;
+    for (uint32_t r = 0; r < repeat; ++r) {
+        auto start = std::chrono::high_resolution_clock::now();
+        func();
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+        if (r == 0 || elapsed.count() < best) best = elapsed.count();
+    }
+    return best;
+}
+
+struct OrderResult {
+    double orderMs;
+    double positionsMs;
+    double gatherMs;
+    double scaleMs;
+    double meanSrcGap;
+};
+
+OrderResult runOrder(const BenchParam& param, BenchGraph& graph, GraphGASLite::VertexOrder order) {
+    const uint64_t n = graph.vertexCount();
+    OrderResult result;
+
+    std::vector<uint64_t> ids(n);
+    result.orderMs = bestMillis(param.repeat, [&graph, &ids, n, order]() {
+        std::iota(ids.begin(), ids.end(), 0);
+        GraphGASLite::orderVertexRange(graph, ids, 0, n, order);
+    });
+
+    // Edges in destination order, source and destination as dense local indices.
+    std::vector<uint64_t> indexOf(n);
+    std::vector<uint64_t> srcPos;
+    std::vector<uint64_t> dstPos;
+    result.positionsMs = bestMillis(param.repeat, [&graph, &ids, &indexOf, &srcPos, &dstPos, n]() {
+        srcPos.clear();
+        dstPos.clear();
+        for (uint64_t j = 0; j < n; ++j) indexOf[ids[j]] = j;
+        for (uint64_t j = 0; j < n; ++j) {
+            const std::vector<uint64_t>& srcv = graph.vertex(ids[j])->getSrcVertexv();
+            for (const auto src : srcv) srcPos.push_back(indexOf[src]);
+            dstPos.insert(dstPos.end(), srcv.size(), j);
+        }
+    });
+
+    std::mt19937_64 rng(param.seed + 1);
+    std::vector<std::vector<uint64_t>> rows(n, std::vector<uint64_t>(param.dim));
+    for (auto& row : rows) {
+        for (auto& x : row) x = rng();
+    }
+    std::vector<std::vector<uint64_t>> sums(n, std::vector<uint64_t>(param.dim));
+    const uint32_t dim = param.dim;
+    result.gatherMs = bestMillis(param.repeat, [&rows, &sums, &srcPos, &dstPos, dim]() {
+        for (auto& row : sums) std::fill(row.begin(), row.end(), 0);
+        for (uint64_t e = 0; e < srcPos.size(); ++e) {
+            const uint64_t* src = rows[srcPos[e]].data();
+            uint64_t* dst = sums[dstPos[e]].data();
+            for (uint32_t k = 0; k < dim; ++k) dst[k] += src[k];
+        }
+    });
+
+    std::vector<uint64_t> normalizer(n);
+    for (uint64_t j = 0; j < n; ++j) {
+        const double inDeg = (double)graph.vertex(ids[j])->inDeg().cnt();
+        normalizer[j] = (uint64_t)std::llround(std::pow(inDeg + 1.0, -0.5) * (1ULL << SCALER_BIT_LENGTH));
+    }
+    result.scaleMs = bestMillis(param.repeat, [&sums, &normalizer, n, dim]() {
+        for (uint64_t j = 0; j < n; ++j) {
+            uint64_t* row = sums[j].data();
+            for (uint32_t k = 0; k < dim; ++k) {
+                row[k] = (uint64_t)((int64_t)(row[k] * normalizer[j]) >> SCALER_BIT_LENGTH);
+            }
+        }
+    });
+
+    double gap = 0;
+    for (uint64_t e = 1; e < srcPos.size(); ++e) {
+        gap += (srcPos[e] > srcPos[e - 1])? srcPos[e] - srcPos[e - 1] : srcPos[e - 1] - srcPos[e];
+    }
+    result.meanSrcGap = (srcPos.size() < 2)? 0.0 : gap / (srcPos.size() - 1);
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    BenchParam param;
+    if (parseArgs(argc, argv, param) != 0) {
+        printHelp(argv[0]);
+        return -1;
+    }
+
+    std::vector<std::string> names;
+    std::stringstream ss(param.orders);
+    std::string name;
+    while (std::getline(ss, name, ',')) {
+        if (!name.empty()) names.push_back(name);
+    }
+    std::vector<GraphGASLite::VertexOrder> orders;
+    try {
+        for (const auto& orderName : names) orders.push_back(GraphGASLite::vertexOrderOf(orderName));
+    } catch (const InvalidArgumentException& e) {
+        std::cerr << e.what() << std::endl;
+        return -1;
+    }
+
+    BenchGraph graph(param.numVertices);
+    generateGraph(param, graph);
+    printf("vertices %" PRIu64 ", edges %" PRIu64 ", dim %u, best of %u runs\n",
+            param.numVertices, param.numVertices * param.avgDegree, param.dim, param.repeat);
+    printf("%-8s %12s %12s %12s %12s %14s\n", "order", "order ms", "positions ms", "gather ms", "scale ms", "mean src gap");
+    for (size_t k = 0; k < orders.size(); ++k) {
+        const OrderResult result = runOrder(param, graph, orders[k]);
+        printf("%-8s %12.2f %12.2f %12.2f %12.2f %14.1f\n", names[k].c_str(),
+                result.orderMs, result.positionsMs, result.gatherMs, result.scaleMs, result.meanSrcGap);
+    }
+    return 0;
+}